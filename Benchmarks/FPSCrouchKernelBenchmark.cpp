@@ -0,0 +1,231 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+/*First, so the kernel is built with nothing included before it*/
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSTransitionScenario.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+/**
+ * FPSCrouchKernel without the engine, the same transitions as fps.Movement.CrouchKernelBenchmark run through Step one character at a time
+ * and through StepBatch over packed arrays. Each iteration runs every transition from its start to its target, items are transitions, e.g.
+ * FPSCrouchKernelBenchmark --benchmark_filter=StepBatch
+ */
+namespace FPSCrouchKernelBenchmark
+{
+	using namespace FPSCrouchKernel;
+
+	static const float MinDeltaTime = 1.f / 120.f;
+	static const float MaxDeltaTime = 1.f / 30.f;
+
+	/*Two transitions that end this close are the same*/
+	static const float MaxMismatch = 1.e-4f;
+
+	/*The default AFPSCharacterBase, a 34 by 88 capsule crouching to 60 in 2 seconds and going prone to 34 in 1, see FFPSMovementProfile*/
+	static FStanceMetrics MakeMetrics()
+	{
+		FStanceMetrics Metrics;
+		Metrics.StandingHalfHeight = 88.f;
+		Metrics.CrouchedHalfHeight = 60.f;
+		Metrics.PronedHalfHeight = 34.f;
+		Metrics.MinHalfHeight = 34.f;
+		Metrics.CrouchedEyeHeight = 50.f;
+		Metrics.PronedEyeHeight = 20.f;
+		Metrics.CrouchInterpSpeed = (Metrics.StandingHalfHeight - Metrics.CrouchedHalfHeight) / 2.f;
+		Metrics.ProneInterpSpeed = (Metrics.CrouchedHalfHeight - Metrics.PronedHalfHeight) / 1.f;
+		Metrics.EyeHeightSlope = (64.f - Metrics.CrouchedEyeHeight) / (Metrics.StandingHalfHeight - Metrics.CrouchedHalfHeight);
+		Metrics.InvProneHeightRange = 1.f / (Metrics.CrouchedHalfHeight - Metrics.PronedHalfHeight);
+		return Metrics;
+	}
+
+	struct FTransitions
+	{
+		std::vector<float> StartHeights;
+		std::vector<float> TargetHeights;
+		std::vector<float> DeltaTimes;
+
+		/*Enough frames for the slowest transition to finish*/
+		int NumFrames;
+	};
+
+	/*Half crouching and half standing up, some starting part of the way there like an interrupted transition, each at its own frame rate*/
+	static FTransitions MakeTransitions(const FStanceMetrics& Metrics, int Count)
+	{
+		std::mt19937 Stream(0);
+		std::uniform_real_distribution<float> Alpha(0.f, 1.f);
+		std::uniform_real_distribution<float> DeltaTime(MinDeltaTime, MaxDeltaTime);
+
+		FTransitions Transitions;
+		Transitions.StartHeights.resize(Count);
+		Transitions.TargetHeights.resize(Count);
+		Transitions.DeltaTimes.resize(Count);
+		for (int i = 0; i < Count; ++i)
+		{
+			const bool bCrouch = (i & 1) == 0;
+			const float From = bCrouch ? Metrics.StandingHalfHeight : Metrics.CrouchedHalfHeight;
+			const float To = bCrouch ? Metrics.CrouchedHalfHeight : Metrics.StandingHalfHeight;
+			Transitions.TargetHeights[i] = To;
+			Transitions.StartHeights[i] = (i % 4 < 2) ? From : From + (To - From) * Alpha(Stream);
+			Transitions.DeltaTimes[i] = DeltaTime(Stream);
+		}
+
+		const float HeightRange = Metrics.StandingHalfHeight - Metrics.CrouchedHalfHeight;
+		Transitions.NumFrames = (int)std::ceil(HeightRange / (Metrics.CrouchInterpSpeed * MinDeltaTime)) + 1;
+		return Transitions;
+	}
+
+	/*Every transition to its target with Step, one character at a time*/
+	static void RunStep(const FStanceMetrics& Metrics, const FTransitions& Transitions, std::vector<FStanceState>& States)
+	{
+		const int Count = (int)States.size();
+		for (int i = 0; i < Count; ++i)
+		{
+			States[i].HalfHeight = Transitions.StartHeights[i];
+		}
+
+		for (int Frame = 0; Frame < Transitions.NumFrames; ++Frame)
+		{
+			for (int i = 0; i < Count; ++i)
+			{
+				Step(Metrics, States[i], Transitions.TargetHeights[i], Transitions.DeltaTimes[i]);
+			}
+		}
+	}
+
+	static void BM_Step(benchmark::State& BenchmarkState)
+	{
+		const FStanceMetrics Metrics = MakeMetrics();
+		const int Count = (int)BenchmarkState.range(0);
+		const FTransitions Transitions = MakeTransitions(Metrics, Count);
+		std::vector<FStanceState> States(Count, FStanceState{ 0.f, 0.f });
+
+		for (auto Iteration : BenchmarkState)
+		{
+			(void)Iteration;
+			RunStep(Metrics, Transitions, States);
+			benchmark::DoNotOptimize(States.data());
+			benchmark::ClobberMemory();
+		}
+
+		for (int i = 0; i < Count; ++i)
+		{
+			if (States[i].HalfHeight != Transitions.TargetHeights[i])
+			{
+				BenchmarkState.SkipWithError("Step didn't finish every transition");
+				break;
+			}
+		}
+
+		BenchmarkState.SetItemsProcessed(BenchmarkState.iterations() * Count);
+		BenchmarkState.counters["Frames"] = (double)Transitions.NumFrames;
+	}
+
+	/*The per character values all come from the same class here, FFPSCrouchTransitionManager mixes classes*/
+	static void BM_StepBatch(benchmark::State& BenchmarkState)
+	{
+		const FStanceMetrics Metrics = MakeMetrics();
+		const int Count = (int)BenchmarkState.range(0);
+		const FTransitions Transitions = MakeTransitions(Metrics, Count);
+
+		std::vector<float> Heights(Count), EyeHeights(Count);
+		const std::vector<float> MinHeights(Count, Metrics.MinHalfHeight);
+		const std::vector<float> InterpSpeeds(Count, Metrics.CrouchInterpSpeed);
+		const std::vector<float> CrouchedHalfHeights(Count, Metrics.CrouchedHalfHeight);
+		const std::vector<float> CrouchedEyeHeights(Count, Metrics.CrouchedEyeHeight);
+		const std::vector<float> EyeHeightSlopes(Count, Metrics.EyeHeightSlope);
+
+		FTransitionBatch Batch;
+		Batch.Heights = Heights.data();
+		Batch.EyeHeights = EyeHeights.data();
+		Batch.TargetHeights = Transitions.TargetHeights.data();
+		Batch.MinHeights = MinHeights.data();
+		Batch.InterpSpeeds = InterpSpeeds.data();
+		Batch.CrouchedHalfHeights = CrouchedHalfHeights.data();
+		Batch.CrouchedEyeHeights = CrouchedEyeHeights.data();
+		Batch.EyeHeightSlopes = EyeHeightSlopes.data();
+		Batch.DeltaTimes = Transitions.DeltaTimes.data();
+		Batch.Count = Count;
+
+		for (auto Iteration : BenchmarkState)
+		{
+			(void)Iteration;
+			Heights = Transitions.StartHeights;
+			for (int Frame = 0; Frame < Transitions.NumFrames; ++Frame)
+			{
+				StepBatch(Batch);
+			}
+			benchmark::DoNotOptimize(Heights.data());
+			benchmark::ClobberMemory();
+		}
+
+		/*The batch has to end where the characters stepped one at a time do*/
+		std::vector<FStanceState> States(Count, FStanceState{ 0.f, 0.f });
+		RunStep(Metrics, Transitions, States);
+		for (int i = 0; i < Count; ++i)
+		{
+			if (std::fabs(States[i].HalfHeight - Heights[i]) > MaxMismatch || std::fabs(States[i].EyeHeight - EyeHeights[i]) > MaxMismatch)
+			{
+				BenchmarkState.SkipWithError("StepBatch doesn't match Step");
+				break;
+			}
+		}
+
+		BenchmarkState.SetItemsProcessed(BenchmarkState.iterations() * Count);
+		BenchmarkState.counters["Frames"] = (double)Transitions.NumFrames;
+	}
+
+	/*One step of the quantized capsule height and UFPSCharacterMovementComponent::MaxClientCapsuleHeightError*/
+	static const float DriftError = (88.f - 34.f) / 255.f;
+	static const float CorrectionError = 4.f;
+
+	/**
+	 * The FPSTransitionScenario scenarios through the frame stepped and the timeline transitions on a client at the first argument in Hz
+	 * and on a server at the second. Each iteration is one scenario, the counters are the server moves whose height differs from the client by a quantization step (drifts)
+	 * or by more than the correction error, and the largest difference. FPS.Movement.Stance.TransitionTickRate tests the timeline in the engine.
+	 */
+	static void BM_TransitionTickRate(benchmark::State& BenchmarkState)
+	{
+		using namespace FPSTransitionScenario;
+
+		const FStanceMetrics Metrics = MakeMetrics();
+		const int ClientRate = (int)BenchmarkState.range(0);
+		const int ServerRate = (int)BenchmarkState.range(1);
+
+		FRandom Random = { 0 };
+		FScenario Scenario;
+		FResult Stepped = { 0.f, 0, 0, 0 };
+		FResult Timed = { 0.f, 0, 0, 0 };
+
+		for (auto Iteration : BenchmarkState)
+		{
+			(void)Iteration;
+			MakeScenario(Metrics, ClientRate, Random, Scenario);
+			RunScenario(EStepMode::Frame, Metrics, Scenario, ClientRate, ServerRate, DriftError, CorrectionError, Stepped);
+			RunScenario(EStepMode::Timeline, Metrics, Scenario, ClientRate, ServerRate, DriftError, CorrectionError, Timed);
+		}
+
+		if (Timed.NumDrifts > 0)
+		{
+			BenchmarkState.SkipWithError("The timeline drifted between the tick rates");
+		}
+
+		BenchmarkState.counters["ServerMoves"] = (double)Timed.NumServerMoves;
+		BenchmarkState.counters["SteppedDrifts"] = (double)Stepped.NumDrifts;
+		BenchmarkState.counters["SteppedCorrections"] = (double)Stepped.NumCorrections;
+		BenchmarkState.counters["SteppedMaxError"] = Stepped.MaxError;
+		BenchmarkState.counters["TimelineDrifts"] = (double)Timed.NumDrifts;
+		BenchmarkState.counters["TimelineCorrections"] = (double)Timed.NumCorrections;
+		BenchmarkState.counters["TimelineMaxError"] = Timed.MaxError;
+	}
+}
+
+BENCHMARK(FPSCrouchKernelBenchmark::BM_Step)->Arg(16)->Arg(128)->Arg(512)->Arg(4096);
+BENCHMARK(FPSCrouchKernelBenchmark::BM_StepBatch)->Arg(16)->Arg(128)->Arg(512)->Arg(4096);
+
+BENCHMARK(FPSCrouchKernelBenchmark::BM_TransitionTickRate)->Args({ 144, 30 })->Args({ 120, 60 })->Args({ 60, 60 })->Args({ 240, 20 })->Iterations(1000);
+
+BENCHMARK_MAIN();
@@ -3,6 +3,8 @@
 #include "FPSCharacterBase.h"
 #include "FPSGame.h"
 #include "FPSCharacterMovementComponent.h"
+#include "FPSCrouchKernel.h"
+#include "FPSMovementProfile.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Utility/FPSHitBoxesManager.h"
@@ -18,7 +20,11 @@ AFPSCharacterBase::AFPSCharacterBase(const FObjectInitializer& ObjectInitializer
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 	BaseEyeHeight = 64.0f;
+	DefaultEyeHeight = BaseEyeHeight;
 	CrouchedEyeHeight = 50.0f;
+	PronedEyeHeight = 20.0f;
+	bIsProne = false;
+	ProxyStance = FPSProxyStance::ProgressMask;
 
 	/*use bUseControllerDesiredRotation in movement component instead*/
 	bUseControllerRotationPitch = false;
@@ -33,6 +39,9 @@ AFPSCharacterBase::AFPSCharacterBase(const FObjectInitializer& ObjectInitializer
 		CameraComponent->bUsePawnControlRotation = true;
 	}
 
+	/*Cast once, everything that needs the FPS movement component uses this*/
+	FPSMovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
+
 	/*Net Settings*/
 	//NetUpdateFrequency = 128.0f;
 	//MinNetUpdateFrequency = 32.0f;
@@ -42,12 +51,17 @@ void AFPSCharacterBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME_CONDITION(AFPSCharacterBase, bIsSprinting, COND_SimulatedOnly);
+	DOREPLIFETIME_CONDITION(AFPSCharacterBase, bIsProne, COND_SimulatedOnly);
+	DOREPLIFETIME_CONDITION(AFPSCharacterBase, ProxyStance, COND_SimulatedOnly);
 }
 
 void AFPSCharacterBase::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	/*A blueprint can replace the movement component after the constructor*/
+	FPSMovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
+
 	/*Set the default values for the characterhalfheight and eye height*/
 	if (CameraComponent)
 	{
@@ -77,25 +91,70 @@ void AFPSCharacterBase::BeginPlay()
 
 void AFPSCharacterBase::OnRep_IsCrouched()
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (MovementComponent)
+	if (FPSMovementComponent)
 	{
 		if (bIsCrouched)
 		{
-			MovementComponent->bWantsToCrouch = true;
+			FPSMovementComponent->bWantsToCrouch = true;
 		}
 		else
 		{
-			MovementComponent->bWantsToCrouch = false;
+			FPSMovementComponent->bWantsToCrouch = false;
 		}
-		MovementComponent->bCheckCrouch = true;
-		MovementComponent->bNetworkUpdateReceived = true;
+		FPSMovementComponent->bNetworkUpdateReceived = true;
+		FPSMovementComponent->OnProxyCrouchReplicated();
 	}
 }
 
 void AFPSCharacterBase::OnRep_IsSprinting()
 {
+	if (FPSMovementComponent)
+	{
+		FPSMovementComponent->OnProxySprintReplicated();
+	}
+}
+
+void AFPSCharacterBase::OnRep_IsProne()
+{
+	if (FPSMovementComponent)
+	{
+		FPSMovementComponent->bWantsToProne = bIsProne;
+		FPSMovementComponent->bNetworkUpdateReceived = true;
+		FPSMovementComponent->OnProxyProneReplicated();
+	}
+}
+
+void AFPSCharacterBase::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
 
+	const bool bReplicateProxyStance = FPSMovementComponent && FPSMovementComponent->bReplicateProxyStance;
+	DOREPLIFETIME_ACTIVE_OVERRIDE(ACharacter, bIsCrouched, !bReplicateProxyStance);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AFPSCharacterBase, bIsSprinting, !bReplicateProxyStance);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AFPSCharacterBase, ProxyStance, bReplicateProxyStance);
+}
+
+void AFPSCharacterBase::OnRep_ProxyStance()
+{
+	/*Same as the separate properties arriving, then the progress moves the transition they started*/
+	const bool bNewSprinting = (ProxyStance & FPSProxyStance::SprintingBit) != 0;
+	if (bIsSprinting != bNewSprinting)
+	{
+		bIsSprinting = bNewSprinting;
+		OnRep_IsSprinting();
+	}
+
+	const bool bNewCrouched = (ProxyStance & FPSProxyStance::CrouchedBit) != 0;
+	if (bIsCrouched != bNewCrouched)
+	{
+		bIsCrouched = bNewCrouched;
+		OnRep_IsCrouched();
+	}
+
+	if (FPSMovementComponent)
+	{
+		FPSMovementComponent->OnProxyStanceProgressReplicated(FPSProxyStance::UnpackProgress(ProxyStance));
+	}
 }
 
 // Called every frame
@@ -116,6 +175,7 @@ void AFPSCharacterBase::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 	PlayerInputComponent->BindAction("Jump", IE_Released, this, &AFPSCharacterBase::StopJumping);
 
 	PlayerInputComponent->BindAction("Crouch", IE_Pressed, this, &AFPSCharacterBase::ToggleCrouch);
+	PlayerInputComponent->BindAction("Prone", IE_Pressed, this, &AFPSCharacterBase::ToggleProne);
 	
 	PlayerInputComponent->BindAxis("MoveForward", this, &AFPSCharacterBase::MoveForward);
 	PlayerInputComponent->BindAxis("MoveRight", this, &AFPSCharacterBase::MoveRight);
@@ -154,52 +214,75 @@ void AFPSCharacterBase::MoveRight(float AxisValue)
 
 void AFPSCharacterBase::StartSprint()
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (MovementComponent)
-		MovementComponent->bWantsToSprint = true;
+	FFPSInputEdgeScope InputEdge(FPSMovementComponent);
+	if (FPSMovementComponent)
+		FPSMovementComponent->bWantsToSprint = true;
 }
 
 void AFPSCharacterBase::StopSprint()
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (MovementComponent)
-		MovementComponent->bWantsToSprint = false;
+	FFPSInputEdgeScope InputEdge(FPSMovementComponent);
+	if (FPSMovementComponent)
+		FPSMovementComponent->bWantsToSprint = false;
+}
+
+void AFPSCharacterBase::ToggleProne()
+{
+	FFPSInputEdgeScope InputEdge(FPSMovementComponent);
+	if (FPSMovementComponent)
+		FPSMovementComponent->bWantsToProne = !FPSMovementComponent->bWantsToProne;
 }
 
 void AFPSCharacterBase::RecalculateBaseEyeHeight()
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (!MovementComponent || !CameraComponent)
+	if (!FPSMovementComponent || !CameraComponent)
 	{
 		return;
 	}
 
+	/*Replays only move the camera for the final state, see ShouldDeferCosmeticUpdates*/
+	if (FPSMovementComponent->ShouldDeferCosmeticUpdates())
+	{
+		FPSMovementComponent->DeferEyeHeightUpdate();
+		return;
+	}
+
 	/*Need to move it a bit further down because the actual capsule and the character height will be different,
 	 *so need to adjust the height when setting the relative location
 	 */
 	const float ComponentScale = GetCapsuleComponent()->GetShapeScale();
 	const float OldUnscaledHalfHeight = GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
-	float HalfHeightAdjust = (OldUnscaledHalfHeight - MovementComponent->InternalCapsuleHeight);
-	float ScaledHalfHeightAdjust = HalfHeightAdjust * ComponentScale;
+	const FPSCrouchKernel::FCapsuleAdjust Adjust = FPSCrouchKernel::GetCapsuleAdjust(OldUnscaledHalfHeight, FPSMovementComponent->InternalCapsuleHeight, ComponentScale);
 
-	//UE_LOG(LogTemp, Warning, TEXT("Base Eye Height = %f, Adjusted = %f"), BaseEyeHeight, BaseEyeHeight - ScaledHalfHeightAdjust);
-	float NewRelativeLoc = MovementComponent->bCrouchMaintainsBaseLocation ? (BaseEyeHeight - ScaledHalfHeightAdjust) : BaseEyeHeight;
+	//UE_LOG(LogTemp, Warning, TEXT("Base Eye Height = %f, Adjusted = %f"), BaseEyeHeight, BaseEyeHeight - Adjust.ScaledHalfHeightAdjust);
+	const float NewRelativeLoc = FPSCrouchKernel::GetCameraZ(BaseEyeHeight, Adjust.ScaledHalfHeightAdjust, FPSMovementComponent->bCrouchMaintainsBaseLocation);
 	CameraComponent->SetRelativeLocation(FVector(0.0f, 0.0f, NewRelativeLoc));
 }
 
 void AFPSCharacterBase::CapsuleAdjusted(float HalfHeightAdjust, float ScaledHalfHeightAdjust)
 {
+	if (FPSMovementComponent && FPSMovementComponent->ShouldDeferCosmeticUpdates())
+	{
+		FPSMovementComponent->DeferCapsuleAdjusted(HalfHeightAdjust, ScaledHalfHeightAdjust);
+		return;
+	}
+
 	RecalculateBaseEyeHeight();
 
-	const ACharacter* DefaultChar = GetDefault<ACharacter>(GetClass());
-	if (GetMesh() && DefaultChar->GetMesh())
+	if (!FPSMovementComponent || !FPSMovementComponent->HasValidData())
 	{
-		GetMesh()->RelativeLocation.Z = DefaultChar->GetMesh()->RelativeLocation.Z + HalfHeightAdjust;
+		return;
+	}
+
+	const FFPSMovementProfile& Profile = FPSMovementComponent->GetMovementProfile();
+	if (GetMesh() && Profile.bHasMesh)
+	{
+		GetMesh()->RelativeLocation.Z = FPSCrouchKernel::GetMeshZ(Profile.DefaultMeshZ, HalfHeightAdjust);
 		BaseTranslationOffset.Z = GetMesh()->RelativeLocation.Z;
 	}
 	else
 	{
-		BaseTranslationOffset.Z = DefaultChar->GetBaseTranslationOffset().Z + HalfHeightAdjust;
+		BaseTranslationOffset.Z = FPSCrouchKernel::GetMeshZ(Profile.DefaultBaseTranslationZ, HalfHeightAdjust);
 	}
 }
 
@@ -210,7 +293,15 @@ bool AFPSCharacterBase::CanCrouch()
 
 void AFPSCharacterBase::ToggleCrouch()
 {
-	if (GetCharacterMovement()->bWantsToCrouch)
+	FFPSInputEdgeScope InputEdge(FPSMovementComponent);
+
+	/*Crouch from prone gets up to crouched*/
+	if (FPSMovementComponent && FPSMovementComponent->bWantsToProne)
+	{
+		FPSMovementComponent->bWantsToProne = false;
+		Crouch();
+	}
+	else if (GetCharacterMovement()->bWantsToCrouch)
 	{
 		UnCrouch();
 	}
@@ -222,16 +313,15 @@ void AFPSCharacterBase::ToggleCrouch()
 
 void AFPSCharacterBase::Crouch(bool bClientSimulation /*= false*/)
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (MovementComponent)
+	if (FPSMovementComponent)
 	{
 		if (CanCrouch())
 		{
-			MovementComponent->bWantsToCrouch = true;
-			//MovementComponent->bCheckCrouch = true;
+			FPSMovementComponent->bWantsToCrouch = true;
+			//FPSMovementComponent->bCheckCrouch = true;
 		}
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-		else if (!MovementComponent->CanEverCrouch())
+		else if (!FPSMovementComponent->CanEverCrouch())
 		{
 			UE_LOG(LogFPSCharacter, Log, TEXT("%s is trying to crouch, but crouching is disabled on this character! (check CharacterMovement NavAgentSettings)"), *GetName());
 		}
@@ -241,10 +331,14 @@ void AFPSCharacterBase::Crouch(bool bClientSimulation /*= false*/)
 
 void AFPSCharacterBase::UnCrouch(bool bClientSimulation /*= false*/)
 {
-	UFPSCharacterMovementComponent* MovementComponent = Cast<UFPSCharacterMovementComponent>(GetCharacterMovement());
-	if (MovementComponent)
+	if (FPSMovementComponent)
 	{
-		MovementComponent->bWantsToCrouch = false;
-		//MovementComponent->bCheckCrouch = true;
+		FPSMovementComponent->bWantsToCrouch = false;
+		//FPSMovementComponent->bCheckCrouch = true;
 	}
 }
+
+bool AFPSCharacterBase::CanJumpInternal_Implementation() const
+{
+	return !bIsProne && Super::CanJumpInternal_Implementation();
+}
@@ -8,13 +8,40 @@
 #include "Components/CapsuleComponent.h"
 #include "Components/PrimitiveComponent.h"
 #include "Player/FPSCharacterBase.h"
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSCrouchTransitionManager.h"
+#include "Player/FPSMovementProfile.h"
+#include "Player/FPSMovementStateTable.h"
+#include "Player/FPSMovementStats.h"
+#include "Player/FPSSprintKernel.h"
 
 #include "DrawDebugHelpers.h"
+#include "HAL/IConsoleManager.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPSCharacterMovement, Log, All);
 
+/*Blockers watched by the uncrouch clearance cache, a blocked uncrouch with more isn't remembered*/
+static const int32 MaxUnCrouchClearanceBlockers = 4;
+
+/*Slower than this counts as stationary for EFPSNetUpdateRate::Idle*/
+static const float MaxIdleNetUpdateSpeed = 10.f;
+
+static TAutoConsoleVariable<int32> CVarAdaptiveNetUpdate(
+	TEXT("fps.Movement.AdaptiveNetUpdate"),
+	1,
+	TEXT("Let the movement of characters with bAdaptiveNetUpdateFrequency set their net update frequency\n")
+	TEXT("0: off, the class NetUpdateFrequency, 1: on"));
+
+static TAutoConsoleVariable<int32> CVarInputEdges(
+	TEXT("fps.Movement.InputEdges"),
+	1,
+	TEXT("Record the sprint, crouch and prone input of characters with bUseInputEdges as edges carried by their moves\n")
+	TEXT("0: off, the wants are sampled once per move, 1: on"));
+
+using namespace FPSMovementStateTable;
+
 /**
- * Character stats
+ * Character stats, see FPSMovementStats.h
  */
 
 // Defines for build configs
@@ -28,16 +55,83 @@ UFPSCharacterMovementComponent::UFPSCharacterMovementComponent(const FObjectInit
 	: Super(ObjectInitializer)
 {
 	CurrentTransition = None;
+	TransitionTimeline = { 0.0f, 0.0f };
+	TransitionClock = 0.0f;
+	ProxyTransitionIndex = INDEX_NONE;
 
 	NavAgentProps.bCanCrouch = true;
 	CrouchedHalfHeight = 60.0f;
 	CrouchTime = 2.0f;
+	PronedHalfHeight = 34.0f;
+	ProneTime = 1.0f;
+	bWantsToProne = false;
+	bCanVault = true;
+	MinVaultHeight = 50.0f;
+	MaxVaultHeight = 130.0f;
+	VaultTime = 0.5f;
+	VaultHeightCurve = nullptr;
+	VaultCurveSampleMode = EFPSCurveSampleMode::LookupTable;
+	VaultProbeInterval = 0.1f;
+	VaultProbeTolerance = 10.0f;
+	VaultElapsed = 0.0f;
+	VaultStartLocation = FVector::ZeroVector;
+	VaultEndLocation = FVector::ZeroVector;
+	bVaultStarted = false;
+	bVaultStartedByMove = false;
+	NumLedgeQueries = 0;
+	bHasVaultWallHit = false;
+	VaultProbeTimer = 0.0f;
+	PendingHalfHeightAdjust = 0.0f;
+	PendingScaledHalfHeightAdjust = 0.0f;
+	bPendingEyeHeightUpdate = false;
+	bPendingCapsuleAdjusted = false;
+	bPendingOverlapUpdate = false;
+	ProxyTransitionSnapDistance = 5000.0f;
+	ProxyTransitionReducedRateDistance = 1500.0f;
+	ProxyTransitionReducedRateInterval = 0.1f;
+	bReplicateProxyStance = false;
+	MaxClientCapsuleHeightError = 4.0f;
+	bClientMoveStateMismatch = false;
+	MoveStateCorrectionTimeStamp = 0.0f;
+	LastCorrectionTimeStamp = 0.0f;
+	bApplyMoveStateCorrection = false;
+	bMoveStateCorrected = false;
+	ProxySprintSmoothLocationTime = 0.06f;
+	ProxyDefaultSmoothLocationTime = NetworkSimulatedSmoothLocationTime;
+	bAdaptiveNetUpdateFrequency = false;
+	IdleNetUpdateFrequency = 10.0f;
+	ActiveNetUpdateFrequency = 120.0f;
+	DefaultNetUpdateFrequency = 100.0f;
+	DefaultMinNetUpdateFrequency = 2.0f;
+	NetUpdateRate = EFPSNetUpdateRate::Default;
+	LastNetUpdateStance = 0;
+	bUseInputEdges = false;
+	RecordedInputEdgeHead = 0;
+	NumRecordedInputEdges = 0;
+	RecordedInputStartWants = 0;
+	bAsyncUnCrouchCheck = false;
+	bUseUnCrouchClearanceCache = false;
+	UnCrouchClearanceTolerance = 2.0f;
+	bUnCrouchBlocked = false;
+	bUnCrouchDeferred = false;
+	bUnCrouchDeferredByMove = false;
+	UnCrouchOverlapHalfHeight = 0.0f;
 
 	bCanSprint = true;
 	MaxSprintTime = -1.0f;
+	SprintCooldownTime = 1.5f;
+	SprintRecoveryTime = 4.0f;
+	SprintRestartStamina = 0.25f;
+	StaminaClock = 0.0f;
+	StaminaMarkTime = 0.0f;
+	StaminaAtMark = 0.0f;
+	bStaminaDraining = false;
+	bStaminaExhausted = false;
 	MaxSprintSpeed = 800.0f;
 	MaxWalkSpeedProne = 300.0f;
 	SprintSideMultiplier = 0.1f;
+	SprintCurveSampleMode = EFPSCurveSampleMode::LookupTable;
+	SprintCurveMaxError = 0.01f;
 	
 	static ConstructorHelpers::FObjectFinder<UCurveFloat> SprintAccelerationCurveClass(TEXT("CurveFloat'/Game/Player/BP_SprintAccCurve.BP_SprintAccCurve'"));
 	if (SprintAccelerationCurveClass.Object != NULL)
@@ -48,6 +142,14 @@ UFPSCharacterMovementComponent::UFPSCharacterMovementComponent(const FObjectInit
 
 float UFPSCharacterMovementComponent::GetMaxSpeed() const
 {
+	return MovementSnapshot.bValid ? MovementSnapshot.MaxSpeed : CalcMaxSpeed();
+}
+
+float UFPSCharacterMovementComponent::CalcMaxSpeed() const
+{
+	if (IsProne())
+		return MaxWalkSpeedProne;
+
 	float MaxSpeed = Super::GetMaxSpeed();
 	if (IsSprinting())
 		MaxSpeed = MaxSprintSpeed;
@@ -55,284 +157,1767 @@ float UFPSCharacterMovementComponent::GetMaxSpeed() const
 	return MaxSpeed;
 }
 
+float UFPSCharacterMovementComponent::GetMaxBrakingDeceleration() const
+{
+	return IsProne() ? BrakingDecelerationWalking : Super::GetMaxBrakingDeceleration();
+}
+
+bool UFPSCharacterMovementComponent::IsMovingOnGround() const
+{
+	return Super::IsMovingOnGround() || IsProne();
+}
+
+void UFPSCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == CMOVE_Prone)
+	{
+		PhysProne(deltaTime, Iterations);
+		return;
+	}
+
+	if (CustomMovementMode == CMOVE_Vault)
+	{
+		PhysVault(deltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UFPSCharacterMovementComponent::PhysProne(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_PhysProne);
+
+	/*IsMovingOnGround() is true while prone, so PhysWalking keeps the mode unless it starts falling*/
+	PhysWalking(deltaTime, Iterations);
+}
+
+void UFPSCharacterMovementComponent::PhysVault(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_PhysVault);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	/*Placed on the curve by the time, nothing carries over from the last frame but the elapsed time*/
+	VaultElapsed = FMath::Min(VaultElapsed + deltaTime, VaultTime);
+	const float Alpha = VaultElapsed / VaultTime;
+	float HeightAlpha;
+	if (VaultHeightCurve)
+	{
+		HeightAlpha = VaultCurveSampler.IsBakedFrom(VaultHeightCurve) ? VaultCurveSampler.Evaluate(Alpha) : VaultHeightCurve->GetFloatValue(Alpha);
+	}
+	else
+	{
+		HeightAlpha = FMath::InterpEaseOut(0.f, 1.f, FMath::Min(Alpha * 2.f, 1.f), 2.f);
+	}
+
+	/*Up against the wall first, over the ledge in the second half*/
+	const float ForwardAlpha = FMath::Clamp(Alpha * 2.f - 1.f, 0.f, 1.f);
+	const FVector Target(
+		FMath::Lerp(VaultStartLocation.X, VaultEndLocation.X, ForwardAlpha),
+		FMath::Lerp(VaultStartLocation.Y, VaultEndLocation.Y, ForwardAlpha),
+		FMath::Lerp(VaultStartLocation.Z, VaultEndLocation.Z, HeightAlpha));
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(Target - OldLocation, UpdatedComponent->GetComponentQuat(), true, Hit);
+	Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
+
+	/*Something got in the way, drop from here*/
+	if (Hit.IsValidBlockingHit())
+	{
+		Velocity = FVector::ZeroVector;
+		SetMovementMode(MOVE_Falling);
+		return;
+	}
+
+	if (VaultElapsed >= VaultTime)
+	{
+		Velocity.Z = 0.f;
+		SetMovementMode(MOVE_Walking);
+	}
+}
+
+void UFPSCharacterMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+	InvalidateMovementSnapshot();
+
+	if (IsProne())
+	{
+		/*Same as entering MOVE_Walking, PhysWalking needs the floor*/
+		Velocity.Z = 0.f;
+		bCrouchMaintainsBaseLocation = true;
+		FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false);
+		AdjustFloorHeight();
+		SetBaseFromFloor(CurrentFloor);
+	}
+}
+
+bool UFPSCharacterMovementComponent::DoJump(bool bReplayingMoves)
+{
+	bVaultStarted = false;
+	if (!bCanVault || !HasValidData() || !IsMovingOnGround())
+	{
+		return Super::DoJump(bReplayingMoves);
+	}
+
+	/*Replays have the vault of the move restored by PrepMoveFor, the server tests the one the client sent*/
+	if (IsDecisionFromMove())
+	{
+		if (!bVaultStartedByMove)
+		{
+			return Super::DoJump(bReplayingMoves);
+		}
+
+		if (bClientUpdating)
+		{
+			StartVault(VaultEndLocation);
+			return true;
+		}
+	}
+
+	FVector EndLocation;
+	const bool bIntoWall = bHasVaultWallHit && (Acceleration | VaultWallHit.ImpactNormal) < 0.f && IsMovingForward();
+	if (bIntoWall && FindLedge(VaultWallHit, EndLocation))
+	{
+		StartVault(EndLocation);
+		return true;
+	}
+
+	return Super::DoJump(bReplayingMoves);
+}
+
+void UFPSCharacterMovementComponent::StartVault(const FVector& EndLocation)
+{
+	INC_DWORD_STAT(STAT_FPSMovement_VaultsStarted);
+
+	VaultStartLocation = UpdatedComponent->GetComponentLocation();
+	VaultEndLocation = EndLocation;
+	VaultElapsed = 0.f;
+	bVaultStarted = true;
+	bHasVaultWallHit = false;
+	SetMovementMode(MOVE_Custom, CMOVE_Vault);
+}
+
+bool UFPSCharacterMovementComponent::CanVault() const
+{
+	return bCanVault && LedgeCache.bValid && LedgeCache.bCanVault && IsMovingOnGround() && IsLedgeCached();
+}
+
+void UFPSCharacterMovementComponent::HandleImpact(const FHitResult& Hit, float TimeSlice, const FVector& MoveDelta)
+{
+	Super::HandleImpact(Hit, TimeSlice, MoveDelta);
+
+	/*Only walls, anything that could be walked on or is overhead isn't vaulted*/
+	if (bCanVault && IsMovingOnGround() && FMath::Abs(Hit.ImpactNormal.Z) < 0.1f)
+	{
+		VaultWallHit = Hit;
+		bHasVaultWallHit = true;
+	}
+}
+
+bool UFPSCharacterMovementComponent::IsLedgeCached() const
+{
+	/*Distance to where it was probed, a grid would probe again right away when the character is next to a cell edge*/
+	const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+	return FVector::DistSquared(PawnLocation, LedgeCache.Location) <= FMath::Square(VaultProbeTolerance)
+		&& CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() == LedgeCache.HalfHeight;
+}
+
+bool UFPSCharacterMovementComponent::FindLedge(const FHitResult& WallHit, FVector& OutEndLocation)
+{
+	UPrimitiveComponent* Wall = WallHit.Component.Get();
+	if (LedgeCache.bValid && Wall && LedgeCache.Wall == Wall && IsLedgeCached() && Wall->GetComponentTransform().Equals(LedgeCache.WallTransform))
+	{
+		INC_DWORD_STAT(STAT_FPSMovement_LedgeCacheHits);
+		OutEndLocation = LedgeCache.EndLocation;
+		return LedgeCache.bCanVault;
+	}
+
+	INC_DWORD_STAT(STAT_FPSMovement_LedgeCacheMisses);
+	const bool bFoundLedge = ProbeLedge(WallHit, OutEndLocation);
+
+	LedgeCache.Location = UpdatedComponent->GetComponentLocation();
+	LedgeCache.HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	LedgeCache.Wall = Wall;
+	LedgeCache.WallTransform = Wall ? Wall->GetComponentTransform() : FTransform::Identity;
+	LedgeCache.EndLocation = OutEndLocation;
+	LedgeCache.bCanVault = bFoundLedge;
+	LedgeCache.bValid = Wall != nullptr;
+
+	return bFoundLedge;
+}
+
+bool UFPSCharacterMovementComponent::ProbeLedge(const FHitResult& WallHit, FVector& OutEndLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_LedgeProbe);
+
+	const FVector WallNormal = WallHit.ImpactNormal.GetSafeNormal2D();
+	if (WallNormal.IsZero())
+	{
+		return false;
+	}
+
+	float PawnRadius, PawnHalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+	const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+	const float FeetZ = PawnLocation.Z - PawnHalfHeight;
+	const ECollisionChannel CollisionChannel = UpdatedComponent->GetCollisionObjectType();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(VaultTrace), false, CharacterOwner);
+	FCollisionResponseParams ResponseParam;
+	InitCollisionParams(QueryParams, ResponseParam);
+
+	/*Down onto the top of the wall, a bit past the edge so the capsule fits on it*/
+	const FVector LedgePoint = FVector(WallHit.ImpactPoint.X, WallHit.ImpactPoint.Y, 0.f) - WallNormal * (PawnRadius * 1.25f);
+	const FCollisionShape ProbeShape = FCollisionShape::MakeSphere(PawnRadius * 0.5f);
+	const FVector ProbeStart(LedgePoint.X, LedgePoint.Y, FeetZ + MaxVaultHeight + ProbeShape.GetSphereRadius());
+	const FVector ProbeEnd(LedgePoint.X, LedgePoint.Y, FeetZ + MinVaultHeight + ProbeShape.GetSphereRadius());
+
+	FHitResult LedgeHit;
+	++NumLedgeQueries;
+	INC_DWORD_STAT(STAT_FPSMovement_LedgeQueries);
+	if (!GetWorld()->SweepSingleByChannel(LedgeHit, ProbeStart, ProbeEnd, FQuat::Identity, CollisionChannel, ProbeShape, QueryParams, ResponseParam)
+		|| LedgeHit.bStartPenetrating || !IsWalkable(LedgeHit))
+	{
+		return false;
+	}
+
+	/*Room to stand on it with the current capsule*/
+	const FVector EndLocation(LedgePoint.X, LedgePoint.Y, LedgeHit.ImpactPoint.Z + PawnHalfHeight + MIN_FLOOR_DIST);
+	++NumLedgeQueries;
+	INC_DWORD_STAT(STAT_FPSMovement_LedgeQueries);
+	if (GetWorld()->OverlapBlockingTestByChannel(EndLocation, FQuat::Identity, CollisionChannel, GetPawnCapsuleCollisionShape(SHRINK_None), QueryParams, ResponseParam))
+	{
+		return false;
+	}
+
+	OutEndLocation = EndLocation;
+	return true;
+}
+
+void UFPSCharacterMovementComponent::BakeVaultHeightCurve()
+{
+	VaultCurveSampler.Bake(VaultHeightCurve, VaultCurveSampleMode, SprintCurveMaxError);
+}
+
 float UFPSCharacterMovementComponent::GetMaxAcceleration() const
 {
 	float CurrentMaxAccel = Super::GetMaxAcceleration();
-	if (IsSprinting() && SprintAccelerationCurve)
+	const UCurveFloat* SprintCurve = MovementSnapshot.bValid ? MovementSnapshot.SprintCurve : (IsSprinting() ? SprintAccelerationCurve : nullptr);
+	if (SprintCurve)
 	{
+		/*GetMaxSpeed() comes from the snapshot during the move*/
+		const float MaxSpeed = GetMaxSpeed();
 		float CurrentSpeed = Velocity.Size();
-		float SprintMultiplier = SprintAccelerationCurve->GetFloatValue(CurrentSpeed / GetMaxSpeed());
+		float SpeedRatio = (MaxSpeed > 0.f) ? CurrentSpeed / MaxSpeed : 0.f;
+		float SprintMultiplier = SprintCurveSampler.IsBakedFrom(SprintCurve) ? SprintCurveSampler.Evaluate(SpeedRatio) : SprintCurve->GetFloatValue(SpeedRatio);
 
 		CurrentMaxAccel *= SprintMultiplier;
 	}
 	return CurrentMaxAccel;
 }
 
-void UFPSCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+void UFPSCharacterMovementComponent::UpdateMovementSnapshot()
 {
-	//UE_LOG(LogTemp, Warning, TEXT("current state: %d bWantsToCrouch %d"), CurrentTransition.GetValue(), bWantsToCrouch);
-	//Super::UpdateCharacterStateBeforeMovement(DeltaSeconds); //no need to do it here since the crouch is checked below,
-	// Check for a change in crouch state. Players toggle crouch by changing bWantsToCrouch.
-	const bool bIsCrouching = IsCrouching();
-	const bool bIsSprinting = IsSprinting();
-	const bool bPressedJump = CharacterOwner->bPressedJump;
+	MovementSnapshot.bValid = false;
+	MovementSnapshot.bIsSprinting = IsSprinting();
+	MovementSnapshot.MaxSpeed = CalcMaxSpeed();
+	MovementSnapshot.SprintCurve = MovementSnapshot.bIsSprinting ? SprintAccelerationCurve : nullptr;
+	MovementSnapshot.bValid = true;
+}
 
-	if (bPressedJump && (CurrentTransition != None || bIsCrouching))
+void UFPSCharacterMovementComponent::DeferEyeHeightUpdate()
+{
+	INC_DWORD_STAT(STAT_FPSMovement_CosmeticUpdatesDeferred);
+	bPendingEyeHeightUpdate = true;
+}
+
+void UFPSCharacterMovementComponent::DeferCapsuleAdjusted(float HalfHeightAdjust, float ScaledHalfHeightAdjust)
+{
+	INC_DWORD_STAT(STAT_FPSMovement_CosmeticUpdatesDeferred);
+	PendingHalfHeightAdjust = HalfHeightAdjust;
+	PendingScaledHalfHeightAdjust = ScaledHalfHeightAdjust;
+	bPendingCapsuleAdjusted = true;
+}
+
+void UFPSCharacterMovementComponent::FlushCosmeticUpdates()
+{
+	if (!HasValidData())
 	{
-		CharacterOwner->bPressedJump = false;
-		bWantsToCrouch = false;
-		bCheckCrouch = true;
+		bPendingEyeHeightUpdate = bPendingCapsuleAdjusted = bPendingOverlapUpdate = false;
+		return;
 	}
 
-	bool bIsMovingForward = IsMovingForward();
-	if (bIsSprinting && (!bWantsToSprint || !IsMovingOnGround() || !bIsMovingForward || !bCanSprint || bWantsToCrouch))
+	/*CapsuleAdjusted updates the camera as well, both read the final state so the order of the skipped updates doesn't matter*/
+	if (bPendingCapsuleAdjusted)
 	{
-		FPSCharacterOwner->bIsSprinting = false;
+		FPSCharacterOwner->CapsuleAdjusted(PendingHalfHeightAdjust, PendingScaledHalfHeightAdjust);
+	}
+	else if (bPendingEyeHeightUpdate)
+	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+	}
+
+	if (bPendingOverlapUpdate)
+	{
+		CharacterOwner->GetCapsuleComponent()->UpdateOverlaps();
+	}
+
+	bPendingEyeHeightUpdate = bPendingCapsuleAdjusted = bPendingOverlapUpdate = false;
+}
+
+bool UFPSCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_CorrectionReplay);
 
-		if (bWantsToCrouch)
-			bWantsToSprint = false;
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	INC_DWORD_STAT_BY(STAT_FPSMovement_ReplayedMoves, (ClientData && ClientData->bUpdatePosition) ? ClientData->SavedMoves.Num() : 0);
+
+	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+	FlushCosmeticUpdates();
+
+	/*Nothing was replayed, the corrected move was the last one*/
+	if (bApplyMoveStateCorrection)
+	{
+		ApplyMoveStateCorrection();
 	}
-	else if (bIsMovingForward && bWantsToSprint && IsMovingOnGround() && bCanSprint) //#TODO check if CanSprint()
+	bMoveStateCorrected = false;
+
+	/*The replay ends with the wants of the last saved move, the input recorded since then is still waiting for the next move*/
+	if (NumRecordedInputEdges > 0)
 	{
-		/*Comment out these 2 lines if you want the player to be able to run while crouched and prone*/
-		bWantsToCrouch = false;
+		ApplyInputWants(RecordedInputEdges[(RecordedInputEdgeHead + NumRecordedInputEdges - 1) % FPSInputEdge::MaxEdges].Wants);
+	}
+
+	return bResult;
+}
+
+void UFPSCharacterMovementComponent::PerformMovement(float DeltaTime)
+{
+	if (MoveInputEdges.Num() > 0)
+	{
+		/*Taken first so nothing in the move sees them again*/
+		const FFPSInputEdgeArray Edges = MoveTemp(MoveInputEdges);
+		MoveInputEdges.Reset();
 
-		if (CurrentTransition == None && !bIsCrouching)
-			FPSCharacterOwner->bIsSprinting = true;
+		/*Every edge but the last only goes through the state update so a press and release in the same move still starts and stops what it did,
+		 *the move itself runs once with the last wants. The client and the server apply them the same way*/
+		for (int32 i = 0; i < Edges.Num() - 1; ++i)
+		{
+			ApplyInputWants(Edges[i].Wants);
+			if (HasValidData() && MovementMode != MOVE_None)
+			{
+				UpdateCharacterStateBeforeMovement(0.f);
+			}
+		}
+		ApplyInputWants(Edges.Last().Wants);
 	}
 
-	if (CanCrouchInCurrentState() && bWantsToCrouch && !(bIsCrouching && CurrentTransition == None))
+	Super::PerformMovement(DeltaTime);
+
+	/*Between moves GetMaxSpeed and GetMaxAcceleration go back to the state, anything can change it before the next update*/
+	InvalidateMovementSnapshot();
+}
+
+void UFPSCharacterMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	FFPSMovementCharacterScope CharacterScope(this, CharacterOwner ? CharacterOwner->Role.GetValue() : ROLE_None);
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+
+void UFPSCharacterMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
+{
+	FFPSMovementCharacterScope CharacterScope(this, ROLE_Authority);
+
+	/*A replay on the client has the input edges of the saved move from PrepMoveFor, the server only takes them from the move data*/
+	if (CharacterOwner && CharacterOwner->Role == ROLE_Authority)
 	{
-		Crouch(false, DeltaSeconds);
+		MoveInputEdges.Reset();
 	}
-	//we want to carry on with prone if we press crouch and we can't crouch at this time i.e. we are trying to crouch from prone position
-	else if (!CanCrouchInCurrentState() || bWantsToSprint ||  (!bWantsToCrouch && (bIsCrouching || CurrentTransition != None)))
+
+	/*The move data that came with this move*/
+	for (const FFPSNetMoveData& MoveData : PendingNetMoveData)
 	{
-		UnCrouch(false, DeltaSeconds);
+		if (MoveData.TimeStamp != ClientTimeStamp)
+		{
+			continue;
+		}
+
+		if (MoveData.InputEdges.Num() > 0)
+		{
+			/*Played on top of the start wants from the compressed flags*/
+			MoveInputEdges = MoveData.InputEdges;
+		}
+
+		/*Both run the same timeline, the server keeps its own height and only corrects the client once the drift is too large*/
+		if (MoveData.bHasCapsuleHeight && CurrentTransition != None && HasValidData()
+			&& MoveData.QuantizedCapsuleHeight != QuantizeCapsuleHeight(InternalCapsuleHeight)
+			&& FMath::Abs(DequantizeCapsuleHeight(MoveData.QuantizedCapsuleHeight) - InternalCapsuleHeight) > MaxClientCapsuleHeightError)
+		{
+			INC_DWORD_STAT(STAT_FPSMovement_NetMoveDataRejected);
+			bClientMoveStateMismatch = true;
+		}
 	}
-	//#TODO CHECK FOR PRONE
+
+	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
 }
 
-bool UFPSCharacterMovementComponent::IsMovingForward()
+void UFPSCharacterMovementComponent::CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove)
 {
-	//float DirectionDot = FVector::DotProduct(PawnOwner->GetActorForwardVector().GetSafeNormal2D(), Acceleration.GetSafeNormal2D());
-	//bool IsMovingForward = (DirectionDot > 0.2f) ? true : false;
+	FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	if (!ClientData || !NewMove)
+	{
+		Super::CallServerMove(NewMove, OldMove);
+		return;
+	}
 
-	AController* PawnController = PawnOwner->Controller;
-	if (!PawnController)
+	const FSavedMove_Character_FPS* LastAckedMove = static_cast<const FSavedMove_Character_FPS*>(ClientData->LastAckedMove.Get());
+	const FSavedMove_Character* PendingMove = ClientData->PendingMove.Get();
+	InputEdgeCounters.NumServerMoves += OldMove ? 2 : 1;
+
+	FFPSNetMoveData MoveData, PendingMoveData, OldMoveData;
+	const bool bHasMoveData = MakeNetMoveData(*static_cast<const FSavedMove_Character_FPS*>(NewMove), LastAckedMove, MoveData);
+	const bool bHasPendingMoveData = PendingMove && MakeNetMoveData(*static_cast<const FSavedMove_Character_FPS*>(PendingMove), LastAckedMove, PendingMoveData);
+	const bool bHasOldMoveData = OldMove && MakeNetMoveData(*static_cast<const FSavedMove_Character_FPS*>(OldMove), LastAckedMove, OldMoveData);
+
+	/*Nothing the server can't derive, the moves go out as usual*/
+	if (!bHasMoveData && !bHasPendingMoveData && !bHasOldMoveData)
+	{
+		Super::CallServerMove(NewMove, OldMove);
+		return;
+	}
+
+	/*The same as the engine CallServerMove with the move data in the ServerMove*/
+	uint32 ClientYawPitchINT = 0;
+	uint8 ClientRollBYTE = 0;
+	NewMove->GetPackedAngles(ClientYawPitchINT, ClientRollBYTE);
+
+	UPrimitiveComponent* ClientMovementBase = NewMove->EndBase.Get();
+	const FName ClientBaseBone = NewMove->EndBoneName;
+	const FVector SendLocation = MovementBaseUtility::UseRelativeLocation(ClientMovementBase) ? NewMove->SavedRelativeLocation : NewMove->SavedLocation;
+
+	/*An old move with input edges was lost, they go again with it*/
+	if (bHasOldMoveData)
+	{
+		ServerMoveOldWithData(OldMoveData, OldMove->TimeStamp, OldMove->Acceleration, OldMove->GetCompressedFlags());
+	}
+	else if (OldMove)
+	{
+		ServerMoveOld(OldMove->TimeStamp, OldMove->Acceleration, OldMove->GetCompressedFlags());
+	}
+
+	if (PendingMove)
+	{
+		uint32 OldClientYawPitchINT = 0;
+		uint8 OldClientRollBYTE = 0;
+		PendingMove->GetPackedAngles(OldClientYawPitchINT, OldClientRollBYTE);
+
+		/*A pending move without root motion followed by one with root motion goes through ServerMoveDualHybridRootMotion*/
+		const bool bHybridRootMotion = PendingMove->RootMotionMontage == nullptr && NewMove->RootMotionMontage != nullptr;
+		ServerMoveDualWithData(bHybridRootMotion, PendingMoveData, MoveData,
+			PendingMove->TimeStamp, PendingMove->Acceleration, PendingMove->GetCompressedFlags(), OldClientYawPitchINT,
+			NewMove->TimeStamp, NewMove->Acceleration, SendLocation, NewMove->GetCompressedFlags(), ClientRollBYTE, ClientYawPitchINT,
+			ClientMovementBase, ClientBaseBone, NewMove->EndPackedMovementMode);
+	}
+	else
+	{
+		ServerMoveWithData(MoveData, NewMove->TimeStamp, NewMove->Acceleration, SendLocation, NewMove->GetCompressedFlags(), ClientRollBYTE, ClientYawPitchINT,
+			ClientMovementBase, ClientBaseBone, NewMove->EndPackedMovementMode);
+	}
+
+	MarkForClientCameraUpdate();
+}
+
+bool UFPSCharacterMovementComponent::MakeNetMoveData(const FSavedMove_Character_FPS& Move, const FSavedMove_Character_FPS* LastAckedMove, FFPSNetMoveData& OutMoveData)
+{
+	OutMoveData.TimeStamp = Move.TimeStamp;
+
+	/*The server runs the same transition, only the height during the transition is worth sending and only when it isn't the one the server already has*/
+	OutMoveData.bHasCapsuleHeight = Move.SavedTransition != None
+		&& !(LastAckedMove && LastAckedMove->SavedTransition == Move.SavedTransition && LastAckedMove->SavedQuantizedCapsuleHeight == Move.SavedQuantizedCapsuleHeight);
+	OutMoveData.QuantizedCapsuleHeight = OutMoveData.bHasCapsuleHeight ? Move.SavedQuantizedCapsuleHeight : 0;
+
+	/*The compressed flags only have the wants at the start of the move*/
+	OutMoveData.InputEdges = Move.SavedInputEdges;
+
+	if (!OutMoveData.HasData())
+	{
 		return false;
+	}
 
-	FRotator ControlRotation = PawnController->GetControlRotation();
-	FRotator ControlRotationForward = FRotator(0.0f, ControlRotation.Yaw, 0.0f);
-	
-	float DirectionDot = FVector::DotProduct(ControlRotationForward.Vector().GetSafeNormal2D(), Acceleration.GetSafeNormal2D());
-	//UE_LOG(LogTemp, Warning, TEXT("%f"), DirectionDot);
+	INC_DWORD_STAT(STAT_FPSMovement_NetMoveDataSent);
+	INC_DWORD_STAT_BY(STAT_FPSMovement_NetMoveDataBits, OutMoveData.GetNumBits());
+	INC_DWORD_STAT_BY(STAT_FPSMovement_InputEdgesSent, OutMoveData.InputEdges.Num());
+	InputEdgeCounters.NumSent += OutMoveData.InputEdges.Num();
+	InputEdgeCounters.NumMovesWithEdges += OutMoveData.InputEdges.Num() > 0 ? 1 : 0;
+	return true;
+}
+
+void UFPSCharacterMovementComponent::ReceiveNetMoveData(const FFPSNetMoveData& MoveData, float TimeStamp)
+{
+	if (MoveData.HasData())
+	{
+		const int32 Index = PendingNetMoveData.Add(MoveData);
+		PendingNetMoveData[Index].TimeStamp = TimeStamp;
+	}
+}
+
+bool UFPSCharacterMovementComponent::ServerMoveWithData_Validate(const FFPSNetMoveData& MoveData, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	return MoveData.IsValid(CompressedMoveFlags)
+		&& ServerMove_Validate(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void UFPSCharacterMovementComponent::ServerMoveWithData_Implementation(const FFPSNetMoveData& MoveData, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	ReceiveNetMoveData(MoveData, TimeStamp);
+	ServerMove_Implementation(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	PendingNetMoveData.Reset();
+}
+
+bool UFPSCharacterMovementComponent::ServerMoveOldWithData_Validate(const FFPSNetMoveData& MoveData, float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	return MoveData.IsValid(OldMoveFlags) && ServerMoveOld_Validate(OldTimeStamp, OldAccel, OldMoveFlags);
+}
 
-	return (DirectionDot < 0.7071f) ? false : true;
+void UFPSCharacterMovementComponent::ServerMoveOldWithData_Implementation(const FFPSNetMoveData& MoveData, float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	ReceiveNetMoveData(MoveData, OldTimeStamp);
+	ServerMoveOld_Implementation(OldTimeStamp, OldAccel, OldMoveFlags);
+	PendingNetMoveData.Reset();
+}
+
+bool UFPSCharacterMovementComponent::ServerMoveDualWithData_Validate(bool bHybridRootMotion, const FFPSNetMoveData& PendingMoveData, const FFPSNetMoveData& MoveData, float TimeStamp0, FVector_NetQuantize10 InAccel0, uint8 PendingFlags, uint32 View0, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 NewFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	if (!PendingMoveData.IsValid(PendingFlags) || !MoveData.IsValid(NewFlags))
+	{
+		return false;
+	}
+
+	return bHybridRootMotion
+		? ServerMoveDualHybridRootMotion_Validate(TimeStamp0, InAccel0, PendingFlags, View0, TimeStamp, InAccel, ClientLoc, NewFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode)
+		: ServerMoveDual_Validate(TimeStamp0, InAccel0, PendingFlags, View0, TimeStamp, InAccel, ClientLoc, NewFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void UFPSCharacterMovementComponent::ServerMoveDualWithData_Implementation(bool bHybridRootMotion, const FFPSNetMoveData& PendingMoveData, const FFPSNetMoveData& MoveData, float TimeStamp0, FVector_NetQuantize10 InAccel0, uint8 PendingFlags, uint32 View0, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 NewFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	ReceiveNetMoveData(PendingMoveData, TimeStamp0);
+	ReceiveNetMoveData(MoveData, TimeStamp);
+	if (bHybridRootMotion)
+	{
+		ServerMoveDualHybridRootMotion_Implementation(TimeStamp0, InAccel0, PendingFlags, View0, TimeStamp, InAccel, ClientLoc, NewFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	}
+	else
+	{
+		ServerMoveDual_Implementation(TimeStamp0, InAccel0, PendingFlags, View0, TimeStamp, InAccel, ClientLoc, NewFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	}
+	PendingNetMoveData.Reset();
+}
+
+bool UFPSCharacterMovementComponent::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	if (bClientMoveStateMismatch)
+	{
+		bClientMoveStateMismatch = false;
+		return true;
+	}
+
+	return Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void UFPSCharacterMovementComponent::SendClientAdjustment()
+{
+	FNetworkPredictionData_Server_Character* ServerData = HasValidData() ? GetPredictionData_Server_Character() : nullptr;
+	const float AdjustmentTimeStamp = ServerData ? ServerData->PendingAdjustment.TimeStamp : 0.f;
+	const float LastAdjustmentTime = ServerData ? ServerData->ServerLastClientAdjustmentTime : 0.f;
+
+	Super::SendClientAdjustment();
+
+	/*A correction went out, not throttled or an acknowledgment, the client replays from the stance of the server instead of its own*/
+	if (ServerData && AdjustmentTimeStamp > 0.f && ServerData->ServerLastClientAdjustmentTime != LastAdjustmentTime)
+	{
+		ClientAdjustMoveState(AdjustmentTimeStamp, MakeMoveStateCorrection());
+	}
+}
+
+FFPSMoveStateCorrection UFPSCharacterMovementComponent::MakeMoveStateCorrection() const
+{
+	FFPSMoveStateCorrection State;
+	State.CapsuleHeight = InternalCapsuleHeight;
+	State.Transition = CurrentTransition;
+	State.TransitionElapsed = TransitionClock - TransitionTimeline.StartTime;
+	State.TransitionDirection = TransitionTimeline.Direction;
+	State.StaminaAtMark = StaminaAtMark;
+	State.StaminaElapsed = StaminaClock - StaminaMarkTime;
+	State.bStaminaDraining = bStaminaDraining;
+	State.bStaminaExhausted = bStaminaExhausted;
+	return State;
+}
+
+void UFPSCharacterMovementComponent::ClientAdjustMoveState_Implementation(float TimeStamp, const FFPSMoveStateCorrection& State)
+{
+	MoveStateCorrection = State;
+	MoveStateCorrectionTimeStamp = TimeStamp;
+
+	/*Usually arrives right after its correction, it still applies until the replay of the correction has run*/
+	const FNetworkPredictionData_Client_Character* ClientData = HasValidData() ? GetPredictionData_Client_Character() : nullptr;
+	if (ClientData && ClientData->bUpdatePosition && TimeStamp == LastCorrectionTimeStamp)
+	{
+		bApplyMoveStateCorrection = true;
+	}
+}
+
+void UFPSCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	INC_DWORD_STAT(STAT_FPSMovement_ClientCorrections);
+	++InputEdgeCounters.NumCorrections;
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+
+	/*The stance of the server came first*/
+	LastCorrectionTimeStamp = TimeStamp;
+	bApplyMoveStateCorrection = MoveStateCorrectionTimeStamp > 0.f && MoveStateCorrectionTimeStamp == TimeStamp;
+}
+
+void UFPSCharacterMovementComponent::ApplyMoveStateCorrection()
+{
+	bApplyMoveStateCorrection = false;
+	bMoveStateCorrected = true;
+	MoveStateCorrectionTimeStamp = 0.f;
+
+	/*The times since the transition started and the stamina last changed, on the clocks of the client at the end of the corrected move*/
+	InternalCapsuleHeight = MoveStateCorrection.CapsuleHeight;
+	CurrentTransition = MoveStateCorrection.Transition;
+	TransitionTimeline = { TransitionClock - MoveStateCorrection.TransitionElapsed, MoveStateCorrection.TransitionDirection };
+	StaminaAtMark = MoveStateCorrection.StaminaAtMark;
+	StaminaMarkTime = StaminaClock - MoveStateCorrection.StaminaElapsed;
+	bStaminaDraining = MoveStateCorrection.bStaminaDraining;
+	bStaminaExhausted = MoveStateCorrection.bStaminaExhausted;
+	bCheckCrouch = bCheckCrouch || CurrentTransition != None;
+	InvalidateMovementSnapshot();
+	INC_DWORD_STAT(STAT_FPSMovement_MoveStateCorrections);
+}
+
+uint8 UFPSCharacterMovementComponent::QuantizeCapsuleHeight(float HalfHeight)
+{
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float Alpha = FMath::Clamp((HalfHeight - Profile.PronedHalfHeight) * Profile.InvCapsuleHeightRange, 0.f, 1.f);
+	return (uint8)FMath::RoundToInt(Alpha * 255.f);
+}
+
+float UFPSCharacterMovementComponent::DequantizeCapsuleHeight(uint8 QuantizedHalfHeight)
+{
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	return FMath::Lerp(Profile.PronedHalfHeight, Profile.StandingHalfHeight, QuantizedHalfHeight / 255.f);
+}
+
+bool FFPSNetMoveData::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 bHasHeight = bHasCapsuleHeight ? 1 : 0;
+	Ar.SerializeBits(&bHasHeight, 1);
+	bHasCapsuleHeight = bHasHeight != 0;
+
+	if (bHasCapsuleHeight)
+	{
+		Ar << QuantizedCapsuleHeight;
+	}
+
+	uint8 bHasInputEdges = InputEdges.Num() > 0 ? 1 : 0;
+	Ar.SerializeBits(&bHasInputEdges, 1);
+	if (bHasInputEdges)
+	{
+		/*1 to MaxEdges edges, the count is sent minus one*/
+		uint8 LastIndex = (uint8)FMath::Min(InputEdges.Num() - 1, FPSInputEdge::MaxEdges - 1);
+		Ar.SerializeBits(&LastIndex, FPSInputEdge::NumCountBits);
+		if (Ar.IsLoading())
+		{
+			InputEdges.SetNumZeroed(LastIndex + 1);
+		}
+
+		/*Only the wants bits are sent, anything above them is dropped when saving*/
+		for (int32 i = 0; i <= LastIndex; ++i)
+		{
+			uint8 Wants = Ar.IsSaving() ? (InputEdges[i].Wants & FPSInputEdge::WantsMask) : 0;
+			Ar.SerializeBits(&Wants, FPSInputEdge::NumWantsBits);
+			if (Ar.IsLoading())
+			{
+				InputEdges[i].Wants = Wants;
+			}
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		InputEdges.Reset();
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+bool FFPSNetMoveData::IsValid(uint8 CompressedFlags) const
+{
+	if (InputEdges.Num() > FPSInputEdge::MaxEdges)
+	{
+		return false;
+	}
+
+	uint8 Wants = FPSInputEdge::FromCompressedFlags(CompressedFlags);
+	for (const FFPSInputEdge& Edge : InputEdges)
+	{
+		if ((Edge.Wants & ~FPSInputEdge::WantsMask) != 0 || Edge.Wants == Wants)
+		{
+			return false;
+		}
+		Wants = Edge.Wants;
+	}
+
+	return true;
+}
+
+void UFPSCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_UpdateState);
+
+	//UE_LOG(LogTemp, Warning, TEXT("current state: %d bWantsToCrouch %d"), CurrentTransition.GetValue(), bWantsToCrouch);
+	//Super::UpdateCharacterStateBeforeMovement(DeltaSeconds); //no need to do it here since the crouch is checked below,
+	// Check for a change in crouch state. Players toggle crouch by changing bWantsToCrouch.
+	const bool bIsCrouching = IsCrouching();
+	const bool bIsSprinting = IsSprinting();
+	const bool bPressedJump = CharacterOwner->bPressedJump;
+	bUnCrouchDeferred = false;
+	AdvanceMovementClocks(DeltaSeconds);
+
+	const bool bIsProne = FPSCharacterOwner->bIsProne;
+	if (bPressedJump && (CurrentTransition != None || bIsCrouching || bIsProne))
+	{
+		CharacterOwner->bPressedJump = false;
+		bWantsToCrouch = false;
+		bWantsToProne = false;
+		bCheckCrouch = true;
+	}
+
+	const bool bIsMovingForward = IsMovingForward();
+	const bool bIsMovingOnGround = IsMovingOnGround();
+
+	/*Probe the ledge of the wall walked into every VaultProbeInterval so CanVault() is up to date, the server tests the vaults of remote clients when they arrive*/
+	if (bHasVaultWallHit && bIsMovingForward && bIsMovingOnGround && !IsDecisionFromMove())
+	{
+		VaultProbeTimer -= DeltaSeconds;
+		if (VaultProbeTimer <= 0.f)
+		{
+			VaultProbeTimer = FMath::Max(0.f, VaultProbeTimer + VaultProbeInterval);
+			FVector EndLocation;
+			FindLedge(VaultWallHit, EndLocation);
+		}
+	}
+	bHasVaultWallHit = false;
+
+	/*See FPSMovementStateTable for the rules*/
+	const bool bWantsLowStance = bWantsToCrouch || bWantsToProne;
+	const uint32 SprintKey =
+		(bIsSprinting ? Sprint_IsSprinting : 0)
+		| (bWantsToSprint ? Sprint_WantsSprint : 0)
+		| (bIsMovingOnGround ? Sprint_OnGround : 0)
+		| (bIsMovingForward ? Sprint_MovingForward : 0)
+		| (CanSprint() ? Sprint_CanSprint : 0)
+		| (bWantsLowStance ? Sprint_WantsLowStance : 0)
+		| ((CurrentTransition == None && !bIsCrouching && !bIsProne) ? Sprint_IdleStance : 0);
+
+	switch (GetSprintAction(SprintKey))
+	{
+	case ESprintAction::StopAndClearWants:
+		bWantsToSprint = false;
+		/*Fall through*/
+	case ESprintAction::Stop:
+		FPSCharacterOwner->bIsSprinting = false;
+		break;
+	case ESprintAction::ClearLowStanceAndStart:
+		FPSCharacterOwner->bIsSprinting = true;
+		/*Fall through*/
+	case ESprintAction::ClearLowStance:
+		/*Comment out these 2 lines if you want the player to be able to run while crouched and prone*/
+		bWantsToCrouch = false;
+		bWantsToProne = false;
+		break;
+	default:
+		break;
+	}
+
+	/*The stamina only changes on the sprint start and stop, it's computed from the clock in between*/
+	if (FPSCharacterOwner->bIsSprinting != bIsSprinting)
+	{
+		MarkSprintStamina(FPSCharacterOwner->bIsSprinting);
+	}
+
+	/*Prone takes over from crouching, getting up from prone always ends crouched and UnCrouch carries on from there*/
+	const uint32 StanceKey =
+		((bWantsToProne && CanProneInCurrentState()) ? Stance_WantsProne : 0)
+		| (bIsProne ? Stance_IsProne : 0)
+		| (IsProne() ? Stance_InProneMode : 0)
+		| (CurrentTransition != None ? Stance_Transitioning : 0)
+		| (CanCrouchInCurrentState() ? Stance_CanCrouch : 0)
+		| (bWantsToCrouch ? Stance_WantsCrouch : 0)
+		| (bIsCrouching ? Stance_IsCrouching : 0)
+		| (bWantsToSprint ? Stance_WantsSprint : 0);
+
+	switch (GetStanceAction(StanceKey))
+	{
+	case EStanceAction::Prone:
+		Prone(DeltaSeconds);
+		break;
+	case EStanceAction::EnterProneMode:
+		/*Landed while still prone*/
+		SetMovementMode(MOVE_Custom, CMOVE_Prone);
+		break;
+	case EStanceAction::UnProne:
+		UnProne(DeltaSeconds);
+		break;
+	case EStanceAction::Crouch:
+		Crouch(false, DeltaSeconds);
+		break;
+	case EStanceAction::UnCrouch:
+		UnCrouch(false, DeltaSeconds);
+		break;
+	default:
+		break;
+	}
+
+	UpdateMovementSnapshot();
+
+	if (bReplicateProxyStance && CharacterOwner->Role == ROLE_Authority)
+	{
+		UpdateProxyStance();
+	}
+
+	if (bAdaptiveNetUpdateFrequency && CharacterOwner->Role == ROLE_Authority)
+	{
+		UpdateNetUpdateRate();
+	}
+}
+
+bool UFPSCharacterMovementComponent::IsMovingForward()
+{
+	//float DirectionDot = FVector::DotProduct(PawnOwner->GetActorForwardVector().GetSafeNormal2D(), Acceleration.GetSafeNormal2D());
+	//bool IsMovingForward = (DirectionDot > 0.2f) ? true : false;
+
+	AController* PawnController = PawnOwner->Controller;
+	if (!PawnController)
+		return false;
+
+	/*Acceleration within 45 degrees of the control yaw, see FPSSprintKernel*/
+	return FPSSprintKernel::IsInForwardCone(PawnController->GetControlRotation().Yaw, Acceleration.X, Acceleration.Y);
+}
+
+
+void UFPSCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+	if (CharacterOwner->Role != ROLE_SimulatedProxy)
+		return;
+
+	/*Transitions are started from OnProxyCrouchReplicated, this only picks up a crouch that was replicated before the component could start it*/
+	if (!bCheckCrouch || ProxyTransitionIndex != INDEX_NONE || FPSCharacterOwner->bIsProne)
+	{
+		INC_DWORD_STAT(STAT_FPSMovement_ProxyUpdatesSkipped);
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_ProxyUpdate);
+	INC_DWORD_STAT(STAT_FPSMovement_ProxyUpdates);
+	
+	/*The interpolation itself is done for all the simulated proxies at once by the transition manager*/
+	if (FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(GetWorld()))
+	{
+		TransitionManager->AddTransition(this, CharacterOwner->bIsCrouched);
+	}
+}
+
+void UFPSCharacterMovementComponent::OnProxyCrouchReplicated()
+{
+	bCheckCrouch = true;
+	InvalidateMovementSnapshot();
+	if (!HasValidData() || CharacterOwner->Role != ROLE_SimulatedProxy || FPSCharacterOwner->bIsProne)
+	{
+		return;
+	}
+
+	if (FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(GetWorld()))
+	{
+		INC_DWORD_STAT(STAT_FPSMovement_ProxyUpdates);
+		TransitionManager->AddTransition(this, CharacterOwner->bIsCrouched);
+	}
+}
+
+void UFPSCharacterMovementComponent::OnProxySprintReplicated()
+{
+	InvalidateMovementSnapshot();
+	if (!HasValidData() || CharacterOwner->Role != ROLE_SimulatedProxy || ProxySprintSmoothLocationTime <= 0.f)
+	{
+		return;
+	}
+
+	/*Sprinting proxies cover more distance between updates, smooth them over a shorter time so they don't trail behind as far*/
+	NetworkSimulatedSmoothLocationTime = IsSprinting() ? ProxySprintSmoothLocationTime : ProxyDefaultSmoothLocationTime;
+}
+
+void UFPSCharacterMovementComponent::OnProxyProneReplicated()
+{
+	InvalidateMovementSnapshot();
+	if (!HasValidData() || CharacterOwner->Role != ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	if (ProxyTransitionIndex != INDEX_NONE)
+	{
+		if (FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(GetWorld()))
+		{
+			TransitionManager->RemoveTransition(this);
+		}
+	}
+
+	/*Proxies don't interpolate the prone height, they go straight to the capsule of the server*/
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	CurrentTransition = EMovementTransition::None;
+	if (FPSCharacterOwner->bIsProne)
+	{
+		CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(Profile.CapsuleRadius, Profile.StandingHalfHeight);
+		bShrinkProxyCapsule = true;
+		InternalCapsuleHeight = Profile.PronedHalfHeight;
+		FPSCharacterOwner->BaseEyeHeight = Profile.PronedEyeHeight;
+		ShrinkCapsule(Profile.PronedHalfHeight, true);
+		bCheckCrouch = false;
+	}
+	else
+	{
+		ExpandCapsule(Profile.CrouchedHalfHeight, true);
+		InternalCapsuleHeight = Profile.CrouchedHalfHeight;
+		FPSCharacterOwner->BaseEyeHeight = Profile.CrouchedEyeHeight;
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+
+		/*Getting up from prone ends crouched, stands up from there if the server already did*/
+		OnProxyCrouchReplicated();
+	}
+}
+
+void UFPSCharacterMovementComponent::OnProxyStanceProgressReplicated(float Progress)
+{
+	if (!HasValidData() || CharacterOwner->Role != ROLE_SimulatedProxy || ProxyTransitionIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	/*The transition carries on from the height of the server, the replicated state change has already started it.
+	 *Proxy transitions only cover standing and crouched, prone goes straight to the capsule of the server*/
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	if (FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(GetWorld()))
+	{
+		TransitionManager->SetTransitionHeight(this, FMath::Max(Profile.CrouchedHalfHeight, FMath::Lerp(Profile.PronedHalfHeight, Profile.StandingHalfHeight, Progress)));
+	}
+}
+
+void UFPSCharacterMovementComponent::UpdateProxyStance()
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float Progress = (InternalCapsuleHeight - Profile.PronedHalfHeight) * Profile.InvCapsuleHeightRange;
+	const uint8 NewStance = FPSProxyStance::Pack(CharacterOwner->bIsCrouched, FPSCharacterOwner->bIsSprinting, Progress);
+
+	if (NewStance != FPSCharacterOwner->ProxyStance)
+	{
+		FPSCharacterOwner->ProxyStance = NewStance;
+		INC_DWORD_STAT(STAT_FPSMovement_ProxyStanceChanges);
+	}
+}
+
+void UFPSCharacterMovementComponent::UpdateNetUpdateRate()
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	const bool bIsCrouching = IsCrouching();
+	const bool bIsSprinting = IsSprinting();
+	const bool bIsProne = FPSCharacterOwner->bIsProne;
+	const bool bAdaptive = CVarAdaptiveNetUpdate.GetValueOnGameThread() != 0;
+
+	EFPSNetUpdateRate NewRate = EFPSNetUpdateRate::Default;
+	if (bAdaptive)
+	{
+		if (bIsSprinting || CurrentTransition != None || IsVaulting())
+		{
+			NewRate = EFPSNetUpdateRate::Active;
+		}
+		else if (IsMovingOnGround() && Acceleration.IsZero() && Velocity.SizeSquared() < FMath::Square(MaxIdleNetUpdateSpeed))
+		{
+			NewRate = EFPSNetUpdateRate::Idle;
+		}
+	}
+
+	/*Proxies see a sprint or stance change and an idle character moving again now instead of on the next update at the old rate*/
+	const uint8 Stance = (bIsCrouching ? 0x01 : 0) | (bIsSprinting ? 0x02 : 0) | (bIsProne ? 0x04 : 0);
+	if (bAdaptive && (Stance != LastNetUpdateStance || (NetUpdateRate == EFPSNetUpdateRate::Idle && NewRate != EFPSNetUpdateRate::Idle)))
+	{
+		CharacterOwner->ForceNetUpdate();
+		INC_DWORD_STAT(STAT_FPSMovement_NetUpdatesForced);
+	}
+	LastNetUpdateStance = Stance;
+
+	if (NewRate != NetUpdateRate)
+	{
+		NetUpdateRate = NewRate;
+		const float Frequency = (NewRate == EFPSNetUpdateRate::Idle) ? IdleNetUpdateFrequency
+			: (NewRate == EFPSNetUpdateRate::Active) ? ActiveNetUpdateFrequency
+			: DefaultNetUpdateFrequency;
+
+		/*The adaptive frequency of the net driver goes down to the minimum when nothing changes, it can't be above the frequency*/
+		CharacterOwner->NetUpdateFrequency = Frequency;
+		CharacterOwner->MinNetUpdateFrequency = FMath::Min(DefaultMinNetUpdateFrequency, Frequency);
+		INC_DWORD_STAT(STAT_FPSMovement_NetUpdateRateChanges);
+	}
+}
+
+void UFPSCharacterMovementComponent::BeginProxyTransition(bool bCrouch)
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float DefaultStandingHalfHeight = Profile.StandingHalfHeight;
+
+	if (bCrouch)
+	{
+		// restore collision size before crouching
+		CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(Profile.CapsuleRadius, DefaultStandingHalfHeight);
+		bShrinkProxyCapsule = true;
+		CurrentTransition = Stand_to_Crouch;
+	}
+	else
+	{
+		ExpandCapsule(DefaultStandingHalfHeight, true);
+		CurrentTransition = Crouch_to_Stand;
+	}
+}
+
+void UFPSCharacterMovementComponent::FinishProxyTransition(float FinalHalfHeight, float FinalEyeHeight)
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	InternalCapsuleHeight = FinalHalfHeight;
+	FPSCharacterOwner->BaseEyeHeight = FinalEyeHeight;
+
+	if (CurrentTransition == Stand_to_Crouch)
+	{
+		ShrinkCapsule(GetMovementProfile().CrouchedHalfHeight, true);
+	}
+	else
+	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+	}
+
+	CurrentTransition = EMovementTransition::None;
+	bCheckCrouch = false;
+}
+
+FNetworkPredictionData_Client_Character_FPS::FNetworkPredictionData_Client_Character_FPS(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+	, NumAllocatedMoves(0)
+{
+	OwnerMovement = const_cast<UFPSCharacterMovementComponent*>(Cast<UFPSCharacterMovementComponent>(&ClientMovement));
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Character_FPS::AllocateNewMove()
+{
+	++NumAllocatedMoves;
+	INC_DWORD_STAT(STAT_FPSMovement_SavedMovesAllocated);
+	FSavedMove_Character_FPS* NewMove = new FSavedMove_Character_FPS();
+	NewMove->OwnerMovement = OwnerMovement;
+	return FSavedMovePtr(NewMove);
+}
+
+class FNetworkPredictionData_Client* UFPSCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UFPSCharacterMovementComponent* MutableThis = const_cast<UFPSCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Character_FPS(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UFPSCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+	bWantsToSprint = (Flags&FSavedMove_Character::FLAG_Custom_0) != 0;
+	bWantsToProne = (Flags&FSavedMove_Character::FLAG_Custom_1) != 0;
+	bUnCrouchDeferredByMove = (Flags&FSavedMove_Character::FLAG_Custom_2) != 0;
+	bVaultStartedByMove = (Flags&FSavedMove_Character::FLAG_Custom_3) != 0;
+}
+
+uint8 UFPSCharacterMovementComponent::GetInputWants() const
+{
+	return FPSInputEdge::Pack(bWantsToSprint, bWantsToCrouch, bWantsToProne);
+}
+
+void UFPSCharacterMovementComponent::ApplyInputWants(uint8 Wants)
+{
+	bWantsToSprint = (Wants & FPSInputEdge::SprintBit) != 0;
+	bWantsToCrouch = (Wants & FPSInputEdge::CrouchBit) != 0;
+	bWantsToProne = (Wants & FPSInputEdge::ProneBit) != 0;
+	InvalidateMovementSnapshot();
+}
+
+void UFPSCharacterMovementComponent::RecordInputEdge(uint8 PreviousWants)
+{
+	const uint8 Wants = GetInputWants();
+	if (Wants == PreviousWants || !bUseInputEdges || !CharacterOwner || CharacterOwner->Role != ROLE_AutonomousProxy || CVarInputEdges.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
+
+	if (NumRecordedInputEdges == 0)
+	{
+		RecordedInputStartWants = PreviousWants;
+	}
+	else if (NumRecordedInputEdges == FPSInputEdge::MaxEdges)
+	{
+		/*Full, the oldest edge becomes the start wants*/
+		RecordedInputStartWants = RecordedInputEdges[RecordedInputEdgeHead].Wants;
+		RecordedInputEdgeHead = (RecordedInputEdgeHead + 1) % FPSInputEdge::MaxEdges;
+		--NumRecordedInputEdges;
+		INC_DWORD_STAT(STAT_FPSMovement_InputEdgesLost);
+		++InputEdgeCounters.NumLost;
+	}
+
+	RecordedInputEdges[(RecordedInputEdgeHead + NumRecordedInputEdges) % FPSInputEdge::MaxEdges].Wants = Wants;
+	++NumRecordedInputEdges;
+	INC_DWORD_STAT(STAT_FPSMovement_InputEdgesRecorded);
+	++InputEdgeCounters.NumRecorded;
+}
+
+void UFPSCharacterMovementComponent::TakeInputEdges(FSavedMove_Character_FPS& Move)
+{
+	Move.SavedInputEdges.Reset();
+	MoveInputEdges.Reset();
+	if (NumRecordedInputEdges == 0)
+	{
+		return;
+	}
+
+	/*Wants changed by something other than the input count as changed before the first edge, so the move still ends with them*/
+	const uint8 LastWants = RecordedInputEdges[(RecordedInputEdgeHead + NumRecordedInputEdges - 1) % FPSInputEdge::MaxEdges].Wants;
+	const uint8 UnrecordedWants = GetInputWants() ^ LastWants;
+
+	/*The move and its compressed flags start with the wants before the first edge, an edge the state update made the same as the one before is dropped*/
+	const uint8 StartWants = RecordedInputStartWants ^ UnrecordedWants;
+	uint8 Wants = StartWants;
+	for (int32 i = 0; i < NumRecordedInputEdges; ++i)
+	{
+		const uint8 EdgeWants = RecordedInputEdges[(RecordedInputEdgeHead + i) % FPSInputEdge::MaxEdges].Wants ^ UnrecordedWants;
+		if (EdgeWants != Wants)
+		{
+			Move.SavedInputEdges.Add({ EdgeWants });
+			Wants = EdgeWants;
+		}
+	}
+
+	Move.bSavedWantsToSprint = (StartWants & FPSInputEdge::SprintBit) != 0;
+	Move.bWantsToCrouch = (StartWants & FPSInputEdge::CrouchBit) != 0;
+	Move.bSavedWantsToProne = (StartWants & FPSInputEdge::ProneBit) != 0;
+	ApplyInputWants(StartWants);
+	MoveInputEdges = Move.SavedInputEdges;
+
+	RecordedInputEdgeHead = 0;
+	NumRecordedInputEdges = 0;
+}
+
+const FFPSMovementProfile& UFPSCharacterMovementComponent::GetMovementProfile()
+{
+	/*CrouchedHalfHeight, the eye heights and the others can be changed on the instance at runtime, they get a profile of their own*/
+	const FFPSMovementProfile::FMovementSettings Settings = FFPSMovementProfile::FMovementSettings::Get(CharacterOwner);
+	if (!MovementProfile.IsValid() || MovementProfile->Generation != FFPSMovementProfile::GetGeneration() || MovementProfile->Settings != Settings)
+	{
+		MovementProfile = FFPSMovementProfile::Get(CharacterOwner->GetClass(), Settings);
+	}
+
+	return *MovementProfile;
+}
+
+bool UFPSCharacterMovementComponent::IsSprinting() const
+{
+	return FPSCharacterOwner && FPSCharacterOwner->bIsSprinting;
+}
+
+bool UFPSCharacterMovementComponent::CanSprint() const
+{
+	if (!bCanSprint)
+	{
+		return false;
+	}
+
+	if (MaxSprintTime <= 0.f)
+	{
+		return true;
+	}
+
+	/*After running out, wait for some of it to come back so sprint doesn't flicker on and off*/
+	const float Stamina = GetSprintStamina(StaminaClock);
+	return bStaminaExhausted ? Stamina >= SprintRestartStamina * MaxSprintTime : Stamina > 0.f;
+}
+
+float UFPSCharacterMovementComponent::GetSprintStaminaFraction() const
+{
+	return (MaxSprintTime > 0.f) ? GetSprintStamina(StaminaClock) / MaxSprintTime : 1.f;
+}
+
+float UFPSCharacterMovementComponent::GetSprintStamina(float Time) const
+{
+	const float Elapsed = FMath::Max(0.f, Time - StaminaMarkTime);
+	if (bStaminaDraining)
+	{
+		return FMath::Max(0.f, StaminaAtMark - Elapsed);
+	}
+
+	const float RecoveryElapsed = bStaminaExhausted ? FMath::Max(0.f, Elapsed - SprintCooldownTime) : Elapsed;
+	const float RecoveryRate = (SprintRecoveryTime > 0.f) ? MaxSprintTime / SprintRecoveryTime : BIG_NUMBER;
+	return FMath::Min(MaxSprintTime, StaminaAtMark + RecoveryElapsed * RecoveryRate);
+}
+
+void UFPSCharacterMovementComponent::MarkSprintStamina(bool bDraining)
+{
+	StaminaAtMark = GetSprintStamina(StaminaClock);
+	StaminaMarkTime = StaminaClock;
+	bStaminaExhausted = !bDraining && StaminaAtMark <= 0.f;
+	bStaminaDraining = bDraining;
+}
+
+void UFPSCharacterMovementComponent::AdvanceMovementClocks(float DeltaSeconds)
+{
+	/*Enough has come back after running out, recover at the normal rate from here*/
+	if (MaxSprintTime > 0.f && bStaminaExhausted && GetSprintStamina(StaminaClock) >= SprintRestartStamina * MaxSprintTime)
+	{
+		MarkSprintStamina(false);
+	}
+
+	/*Nothing depends on the stamina clock while the stamina is full, start over so the clock keeps its precision*/
+	const bool bStaminaFull = MaxSprintTime <= 0.f || (!bStaminaDraining && !bStaminaExhausted && GetSprintStamina(StaminaClock) >= MaxSprintTime);
+	if (bStaminaFull)
+	{
+		StaminaClock = 0.f;
+		StaminaMarkTime = 0.f;
+		StaminaAtMark = MaxSprintTime;
+	}
+
+	/*Same for the transition clock between transitions, the next one starts its own timeline*/
+	if (CurrentTransition == None)
+	{
+		TransitionClock = 0.f;
+	}
+
+	StaminaClock += DeltaSeconds;
+	TransitionClock += DeltaSeconds;
+}
+
+void UFPSCharacterMovementComponent::Crouch(bool bClientSimulation /*= false*/, float DeltaTime /*= 0.0f*/)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_Crouch);
+	INC_DWORD_STAT(STAT_FPSMovement_CrouchCalls);
+
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	if (!bClientSimulation && !CanCrouchInCurrentState())
+	{
+		return;
+	}
+
+	/*So we can force the player the crouch*/
+	if (!bCheckCrouch && bClientSimulation)
+	{
+		return;
+	}
+
+	// restore collision size before crouching
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	if (bClientSimulation && CharacterOwner->Role == ROLE_SimulatedProxy)
+	{
+		CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(Profile.CapsuleRadius, Profile.StandingHalfHeight);
+		bShrinkProxyCapsule = true;
+	}
+
+	if (!bClientSimulation)
+	{
+		CharacterOwner->bIsCrouched = true;
+		SetUnCrouchBlocked(false);
+	}
+
+	const float DefaultCrouchedHalfHeight = Profile.CrouchedHalfHeight;
+
+	/*If we are already going from standing to crouch then keep it the same, or change to it if we are we standing back up and decide to crouch*/
+	if (CurrentTransition == Stand_to_Crouch || CurrentTransition == Crouch_to_Stand || (IsCrouching() && CurrentTransition == None))
+	{
+		CurrentTransition = Stand_to_Crouch;
+	}
+
+	//Shrink the capsule if we are fully crouched
+	if (!UpdateTransitionHeight(DefaultCrouchedHalfHeight, DeltaTime, true))
+	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+		//FPSCharacterOwner->CapsuleAdjusted(0.f, 0.f);
+	}
+	else
+	{
+		ShrinkCapsule(DefaultCrouchedHalfHeight, bClientSimulation);
+		CurrentTransition = EMovementTransition::None;
+		bCheckCrouch = false;
+	}
+}
+
+void UFPSCharacterMovementComponent::UnCrouch(bool bClientSimulation /*= false*/, float DeltaTime /*= 0.0f*/)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_UnCrouch);
+	INC_DWORD_STAT(STAT_FPSMovement_UnCrouchCalls);
+
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	/*This might be called when !CanCrouchInCurrentState(), which wouldn't set bCheckCrouch*/
+	if (!bCheckCrouch && bClientSimulation)
+	{
+		return;
+	}
+
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float DefaultStandingHalfHeight = Profile.StandingHalfHeight;
+
+	if (!bClientSimulation && CharacterOwner->bIsCrouched)
+	{	
+		/*Still blocked the last time we checked, wait for the async overlap to find room*/
+		if (ShouldDeferUnCrouch(DefaultStandingHalfHeight))
+		{
+			bUnCrouchDeferred = true;
+			INC_DWORD_STAT(STAT_FPSMovement_UnCrouchDeferred);
+			return;
+		}
+
+		// See if collision is already at desired size.
+		if (ExpandCapsule(DefaultStandingHalfHeight, bClientSimulation))
+		{
+			CharacterOwner->bIsCrouched = false;
+			UnCrouchClearance.bValid = false;
+			SetUnCrouchBlocked(false);
+		}
+		else
+		{
+#if !(UE_BUILD_SHIPPING)
+			if (!bUnCrouchBlocked)
+			{
+				UE_LOG(LogFPSCharacterMovement, Warning, TEXT("UnCrouch Blocked!!"));
+			}
+#endif // !(UE_BUILD_SHIPPING)
+			SetUnCrouchBlocked(true);
+			RecordUnCrouchClearance(DefaultStandingHalfHeight);
+			RequestUnCrouchOverlap(DefaultStandingHalfHeight);
+			return;
+		}
+	}
+	else if (bClientSimulation && !CharacterOwner->bIsCrouched)
+	{
+		// See if collision is already at desired size.
+		ExpandCapsule(DefaultStandingHalfHeight, bClientSimulation);
+	}
+
+	if (CurrentTransition == Stand_to_Crouch || CurrentTransition == Crouch_to_Stand || (!IsCrouching() && CurrentTransition == None))
+	{
+		CurrentTransition = Crouch_to_Stand;
+	}
+
+	if (!UpdateTransitionHeight(DefaultStandingHalfHeight, DeltaTime, true))
+	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+		//FPSCharacterOwner->CapsuleAdjusted(0.f, 0.f);
+	}
+	else
+	{
+		CurrentTransition = EMovementTransition::None;
+		bCheckCrouch = false;
+	}
+}
+
+bool UFPSCharacterMovementComponent::CanProneInCurrentState() const
+{
+	return IsMovingOnGround() && UpdatedComponent && !UpdatedComponent->IsSimulatingPhysics();
 }
 
+float UFPSCharacterMovementComponent::GetStanceEyeHeight(float HalfHeight)
+{
+	return FPSCrouchKernel::GetEyeHeight(GetMovementProfile().StanceMetrics, HalfHeight);
+}
 
-void UFPSCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+bool UFPSCharacterMovementComponent::UpdateTransitionHeight(float TargetHalfHeight, float DeltaTime, bool bCrouch)
 {
-	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
-	if (CharacterOwner->Role != ROLE_SimulatedProxy)
-		return;
-	
-	if (bCheckCrouch)
+	/*A new transition, or one that was interrupted, turned around or corrected by the server is started again*/
+	FPSCrouchKernel::FStanceState State = { InternalCapsuleHeight, FPSCharacterOwner->BaseEyeHeight };
+	bool bStartedTimeline = false;
+	const FPSCrouchKernel::FStanceMetrics& Metrics = GetMovementProfile().StanceMetrics;
+	const bool bReachedTarget = bCrouch
+		? FPSCrouchKernel::StepTimeline(FPSCrouchKernel::GetCrouchMetrics(Metrics, CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius()), TransitionTimeline, State, TargetHalfHeight, TransitionClock, DeltaTime, bStartedTimeline)
+		: FPSCrouchKernel::StepTimeline(Metrics, TransitionTimeline, State, TargetHalfHeight, TransitionClock, DeltaTime, bStartedTimeline);
+	INC_DWORD_STAT_BY(STAT_FPSMovement_TransitionTimelineStarts, bStartedTimeline ? 1 : 0);
+
+	InternalCapsuleHeight = State.HalfHeight;
+
+	/*Crouching only moves the eyes during the stand and crouch transition, a crouch that carries on from something else leaves them to RecalculateBaseEyeHeight*/
+	if (!bCrouch || CurrentTransition == Stand_to_Crouch || CurrentTransition == Crouch_to_Stand)
 	{
-		if (CharacterOwner->bIsCrouched)
-		{
-			Crouch(true, DeltaSeconds);
-		}
-		else
-		{
-			UnCrouch(true, DeltaSeconds);
-		}
+		FPSCharacterOwner->BaseEyeHeight = State.EyeHeight;
 	}
+	return bReachedTarget;
 }
 
-FSavedMovePtr FNetworkPredictionData_Client_Character_FPS::AllocateNewMove()
+void UFPSCharacterMovementComponent::Prone(float DeltaTime)
 {
-	return FSavedMovePtr(new FSavedMove_Character_FPS());
-}
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_Prone);
 
-class FNetworkPredictionData_Client* UFPSCharacterMovementComponent::GetPredictionData_Client() const
-{
-	if (ClientPredictionData == nullptr)
+	if (!HasValidData())
 	{
-		UFPSCharacterMovementComponent* MutableThis = const_cast<UFPSCharacterMovementComponent*>(this);
-		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Character_FPS(*this);
+		return;
 	}
 
-	return ClientPredictionData;
-}
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float DefaultPronedHalfHeight = Profile.PronedHalfHeight;
 
-void UFPSCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
-{
-	Super::UpdateFromCompressedFlags(Flags);
-	bWantsToSprint = (Flags&FSavedMove_Character::FLAG_Custom_0) != 0;
-}
+	/*Prone replaces crouched, the crouched state comes back when getting up*/
+	if (!FPSCharacterOwner->bIsProne)
+	{
+		FPSCharacterOwner->bIsProne = true;
+		CharacterOwner->bIsCrouched = false;
+		SetUnCrouchBlocked(false);
+	}
 
-bool UFPSCharacterMovementComponent::IsSprinting() const
-{
-	return FPSCharacterOwner && FPSCharacterOwner->bIsSprinting;
+	if (!IsProne())
+	{
+		SetMovementMode(MOVE_Custom, CMOVE_Prone);
+	}
+
+	/*Carry on from wherever the height is, the capsule isn't shrunk until the end so going back up doesn't need a test until then*/
+	if (CurrentTransition != Stand_to_Prone && CurrentTransition != Crouch_to_Prone)
+	{
+		CurrentTransition = (InternalCapsuleHeight > Profile.CrouchedHalfHeight) ? Stand_to_Prone : Crouch_to_Prone;
+	}
+
+	/*From standing the crouch part of the height goes at the crouch speed*/
+	if (!UpdateTransitionHeight(DefaultPronedHalfHeight, DeltaTime, false))
+	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
+	}
+	else
+	{
+		ShrinkCapsule(DefaultPronedHalfHeight, false);
+		CurrentTransition = EMovementTransition::None;
+	}
 }
 
-void UFPSCharacterMovementComponent::Crouch(bool bClientSimulation /*= false*/, float DeltaTime /*= 0.0f*/)
+void UFPSCharacterMovementComponent::UnProne(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_UnProne);
+
 	if (!HasValidData())
 	{
 		return;
 	}
 
-	if (!bClientSimulation && !CanCrouchInCurrentState())
+	const FFPSMovementProfile& Profile = GetMovementProfile();
+	const float DefaultCrouchedHalfHeight = Profile.CrouchedHalfHeight;
+
+	if (CurrentTransition != Prone_to_Crouch)
 	{
-		return;
+		/*Grow to the crouched capsule at the start like UnCrouch does with the standing one, it's only smaller once fully prone*/
+		if (CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight() < DefaultCrouchedHalfHeight)
+		{
+			if (ShouldDeferUnCrouch(DefaultCrouchedHalfHeight))
+			{
+				bUnCrouchDeferred = true;
+				INC_DWORD_STAT(STAT_FPSMovement_UnCrouchDeferred);
+				return;
+			}
+
+			if (!ExpandCapsule(DefaultCrouchedHalfHeight, false))
+			{
+				SetUnCrouchBlocked(true);
+				RecordUnCrouchClearance(DefaultCrouchedHalfHeight);
+				RequestUnCrouchOverlap(DefaultCrouchedHalfHeight);
+				return;
+			}
+
+			UnCrouchClearance.bValid = false;
+			SetUnCrouchBlocked(false);
+		}
+
+		CurrentTransition = Prone_to_Crouch;
 	}
 
-	/*So we can force the player the crouch*/
-	if (!bCheckCrouch && bClientSimulation)
+	/*Going back up before the standing capsule was shrunk comes down to crouched from above*/
+	if (!UpdateTransitionHeight(DefaultCrouchedHalfHeight, DeltaTime, false))
 	{
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
 		return;
 	}
 
-	// restore collision size before crouching
-	ACharacter* DefaultCharacter = CharacterOwner->GetClass()->GetDefaultObject<ACharacter>();
-	if (bClientSimulation && CharacterOwner->Role == ROLE_SimulatedProxy)
+	if (CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight() > DefaultCrouchedHalfHeight)
 	{
-		CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleRadius(), DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight());
-		bShrinkProxyCapsule = true;
+		ShrinkCapsule(DefaultCrouchedHalfHeight, false);
 	}
-
-	if (!bClientSimulation)
+	else
 	{
-		CharacterOwner->bIsCrouched = true;
+		FPSCharacterOwner->RecalculateBaseEyeHeight();
 	}
 
-	//The radius before we change anything
-	const float OldUnscaledRadius = CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius();
-	float DefaultStandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
+	CurrentTransition = EMovementTransition::None;
+	FPSCharacterOwner->bIsProne = false;
+	CharacterOwner->bIsCrouched = true;
+	bCheckCrouch = true;
 
-	//Interp speed, the default interpSpeed is the same, so if coming out of a prone to crouch might be quicker since the change in height is different
-	float InterpSpeed = (DefaultStandingHalfHeight - CrouchedHalfHeight) / CrouchTime;
+	if (IsProne())
+	{
+		SetMovementMode(MOVE_Walking);
+	}
+}
 
-	/*If we are already going from standing to crouch then keep it the same, or change to it if we are we standing back up and decide to crouch*/
-	if (CurrentTransition == Stand_to_Crouch || CurrentTransition == Crouch_to_Stand || (IsCrouching() && CurrentTransition == None))
+bool UFPSCharacterMovementComponent::ShouldDeferUnCrouch(float TargetHalfHeight)
+{
+	if (!bAsyncUnCrouchCheck && !bUseUnCrouchClearanceCache)
 	{
-		InterpSpeed = (DefaultStandingHalfHeight - CrouchedHalfHeight) / CrouchTime;
-		CurrentTransition = Stand_to_Crouch;
+		return false;
 	}
 
-	float ClampedCharacterHalfHeight = FMath::Max3(0.f, OldUnscaledRadius, FMath::FInterpConstantTo(InternalCapsuleHeight, CrouchedHalfHeight, DeltaTime, InterpSpeed));
-	InternalCapsuleHeight = ClampedCharacterHalfHeight;
+	if (IsDecisionFromMove())
+	{
+		return bUnCrouchDeferredByMove;
+	}
 
-	if (CurrentTransition == Stand_to_Crouch)
+	if (bUseUnCrouchClearanceCache && UnCrouchClearance.bValid && UnCrouchClearance.HalfHeight == TargetHalfHeight)
 	{
-		float NormalisedAlpha = (DefaultStandingHalfHeight - InternalCapsuleHeight) / (DefaultStandingHalfHeight - CrouchedHalfHeight);
-		FPSCharacterOwner->BaseEyeHeight = FMath::Lerp(FPSCharacterOwner->DefaultEyeHeight, FPSCharacterOwner->CrouchedEyeHeight, NormalisedAlpha);
+		if (IsUnCrouchClearanceCached())
+		{
+			INC_DWORD_STAT(STAT_FPSMovement_UnCrouchClearanceHits);
+			return true;
+		}
+
+		INC_DWORD_STAT(STAT_FPSMovement_UnCrouchClearanceMisses);
+		UnCrouchClearance.bValid = false;
 	}
 
+	if (!bAsyncUnCrouchCheck)
+	{
+		return false;
+	}
 
-	//Shrink the capsule if we are fully crouched
-	if (ClampedCharacterHalfHeight != CrouchedHalfHeight)
+	if (!UnCrouchOverlapHandles[0].IsValid() || UnCrouchOverlapHalfHeight != TargetHalfHeight)
 	{
-		FPSCharacterOwner->RecalculateBaseEyeHeight();
-		//FPSCharacterOwner->CapsuleAdjusted(0.f, 0.f);
+		return false;
 	}
-	else
+
+	/*Blocked only if every location ExpandCapsule would try is blocked, a result that isn't ready counts as clear so the synchronous test decides*/
+	bool bBlocked = true;
+	for (FTraceHandle& Handle : UnCrouchOverlapHandles)
 	{
-		ShrinkCapsule(CrouchedHalfHeight, bClientSimulation);
-		CurrentTransition = EMovementTransition::None;
-		bCheckCrouch = false;
+		if (!Handle.IsValid())
+		{
+			continue;
+		}
+
+		FOverlapDatum OverlapDatum;
+		const bool bHasResult = GetWorld()->QueryOverlapData(Handle, OverlapDatum);
+		Handle = FTraceHandle();
+
+		bBlocked &= bHasResult && OverlapDatum.OutOverlaps.ContainsByPredicate([](const FOverlapResult& Overlap) { return Overlap.bBlockingHit; });
+	}
+
+	if (bBlocked)
+	{
+		RequestUnCrouchOverlap(TargetHalfHeight);
 	}
+
+	return bBlocked;
 }
 
-void UFPSCharacterMovementComponent::UnCrouch(bool bClientSimulation /*= false*/, float DeltaTime /*= 0.0f*/)
+void UFPSCharacterMovementComponent::SetUnCrouchBlocked(bool bBlocked)
 {
-	if (!HasValidData())
+	if (bUnCrouchBlocked == bBlocked || bClientUpdating)
 	{
 		return;
 	}
 
-	/*This might be called when !CanCrouchInCurrentState(), which wouldn't set bCheckCrouch*/
-	if (!bCheckCrouch && bClientSimulation)
+	bUnCrouchBlocked = bBlocked;
+	OnUnCrouchBlockedChanged.Broadcast(bBlocked);
+}
+
+void UFPSCharacterMovementComponent::RecordUnCrouchClearance(float TargetHalfHeight)
+{
+	UnCrouchClearance.bValid = false;
+	UnCrouchClearance.Blockers.Reset();
+	UnCrouchClearance.BlockerTransforms.Reset();
+
+	/*ExpandCapsule sweeps for a place to stand when the base location isn't kept, the blockers of that can't be known up front*/
+	if (!bUseUnCrouchClearanceCache || !bCrouchMaintainsBaseLocation || IsDecisionFromMove())
 	{
 		return;
 	}
 
-	ACharacter* DefaultCharacter = CharacterOwner->GetClass()->GetDefaultObject<ACharacter>();
-	if (!bClientSimulation && CharacterOwner->bIsCrouched)
-	{	
-		// See if collision is already at desired size.
-		float DefaultStandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
+	/*The blocking test doesn't say what blocked it, one more overlap on a miss to find out what to watch.
+	 *The capsule is stretched down over the location closer to the floor that ExpandCapsule also tries*/
+	const float ComponentScale = CharacterOwner->GetCapsuleComponent()->GetShapeScale();
+	const float ScaledHalfHeightAdjust = (TargetHalfHeight - CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight()) * ComponentScale;
+	const float MinFloorDist = KINDA_SMALL_NUMBER * 10.f;
+	const float FloorAdjust = (IsMovingOnGround() && CurrentFloor.bBlockingHit && CurrentFloor.FloorDist > MinFloorDist) ? CurrentFloor.FloorDist - MinFloorDist : 0.f;
+	const FCollisionShape StandingCapsuleShape = GetPawnCapsuleCollisionShape(SHRINK_HeightCustom, -KINDA_SMALL_NUMBER * 10.f - ScaledHalfHeightAdjust);
+	const FCollisionShape WatchedCapsuleShape = FCollisionShape::MakeCapsule(StandingCapsuleShape.GetCapsuleRadius(), StandingCapsuleShape.GetCapsuleHalfHeight() + FloorAdjust * 0.5f);
+	const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+	const FVector StandingLocation = PawnLocation + FVector(0.f, 0.f, StandingCapsuleShape.GetCapsuleHalfHeight() - CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() - FloorAdjust * 0.5f);
 
-		if (ExpandCapsule(DefaultStandingHalfHeight, bClientSimulation))
-		{
-			CharacterOwner->bIsCrouched = false;
-		}
-		else
+	FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(CrouchTrace), false, CharacterOwner);
+	FCollisionResponseParams ResponseParam;
+	InitCollisionParams(CapsuleParams, ResponseParam);
+
+	TArray<FOverlapResult, TInlineAllocator<8>> Overlaps;
+	INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
+	GetWorld()->OverlapMultiByChannel(Overlaps, StandingLocation, FQuat::Identity, UpdatedComponent->GetCollisionObjectType(), WatchedCapsuleShape, CapsuleParams, ResponseParam);
+
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* Blocker = Overlap.GetComponent();
+		if (Overlap.bBlockingHit && Blocker)
 		{
-			//#TODO broadcast uncrouch blocked??
-#if !(UE_BUILD_SHIPPING)
-			UE_LOG(LogFPSCharacterMovement, Warning, TEXT("UnCrouch Blocked!!"));
-#endif // !(UE_BUILD_SHIPPING)
-			return;
+			/*Too many to keep track of, test again next time*/
+			if (UnCrouchClearance.Blockers.Num() == MaxUnCrouchClearanceBlockers)
+			{
+				return;
+			}
+
+			UnCrouchClearance.Blockers.Add(Blocker);
+			UnCrouchClearance.BlockerTransforms.Add(Blocker->GetComponentTransform());
 		}
 	}
-	else if (bClientSimulation && !CharacterOwner->bIsCrouched)
-	{
-		// See if collision is already at desired size.
-		float DefaultStandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
 
-		ExpandCapsule(DefaultStandingHalfHeight, bClientSimulation);
+	/*Nothing blocking found, the blocking test and this one disagree so don't remember it*/
+	if (UnCrouchClearance.Blockers.Num() == 0)
+	{
+		return;
 	}
 
-	const float OldUnscaledRadius = CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius();
-	float DefaultStandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
-	
-	//Interp speed, the default interpSpeed is the same, so if coming out of a prone to crouch might be quicker since the change in height is different
-	float InterpSpeed = (DefaultStandingHalfHeight - CrouchedHalfHeight) / CrouchTime;
+	UPrimitiveComponent* Floor = CurrentFloor.HitResult.Component.Get();
+	UnCrouchClearance.Floor = Floor;
+	UnCrouchClearance.FloorTransform = Floor ? Floor->GetComponentTransform() : FTransform::Identity;
+	UnCrouchClearance.Location = PawnLocation;
+	UnCrouchClearance.HalfHeight = TargetHalfHeight;
+	UnCrouchClearance.bValid = true;
+}
 
-	if (CurrentTransition == Stand_to_Crouch || CurrentTransition == Crouch_to_Stand || (!IsCrouching() && CurrentTransition == None))
+bool UFPSCharacterMovementComponent::IsUnCrouchClearanceCached() const
+{
+	/*Distance to where it was blocked, a grid would test again right away when the character is next to a cell edge*/
+	const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+	if (FVector::DistSquared(PawnLocation, UnCrouchClearance.Location) > FMath::Square(UnCrouchClearanceTolerance)
+		|| CurrentFloor.HitResult.Component != UnCrouchClearance.Floor)
 	{
-		InterpSpeed = (DefaultStandingHalfHeight - CrouchedHalfHeight) / CrouchTime;
-		CurrentTransition = Crouch_to_Stand;
+		return false;
 	}
 
+	const UPrimitiveComponent* Floor = UnCrouchClearance.Floor.Get();
+	if (Floor && !Floor->GetComponentTransform().Equals(UnCrouchClearance.FloorTransform))
+	{
+		return false;
+	}
 
-	float ClampedCharacterHalfHeight = FMath::Max3(0.f, OldUnscaledRadius, FMath::FInterpConstantTo(InternalCapsuleHeight, DefaultStandingHalfHeight, DeltaTime, InterpSpeed));
-	InternalCapsuleHeight = ClampedCharacterHalfHeight;
-
-	if (CurrentTransition == Crouch_to_Stand)
+	for (int32 i = 0; i < UnCrouchClearance.Blockers.Num(); ++i)
 	{
-		float NormalisedAlpha = (InternalCapsuleHeight - CrouchedHalfHeight) / (DefaultStandingHalfHeight - CrouchedHalfHeight);
-		FPSCharacterOwner->BaseEyeHeight = FMath::Lerp(FPSCharacterOwner->CrouchedEyeHeight, FPSCharacterOwner->DefaultEyeHeight, NormalisedAlpha);
+		const UPrimitiveComponent* Blocker = UnCrouchClearance.Blockers[i].Get();
+		if (!Blocker || !Blocker->IsCollisionEnabled() || !Blocker->GetComponentTransform().Equals(UnCrouchClearance.BlockerTransforms[i]))
+		{
+			return false;
+		}
 	}
 
+	return true;
+}
 
-	//Shrink the capsule if we are fully crouched
-	if (ClampedCharacterHalfHeight != DefaultStandingHalfHeight)
+bool UFPSCharacterMovementComponent::IsDecisionFromMove() const
+{
+	/*Replays and the moves of a remote client use the decision saved with the move, so the client and server stand up on the same move*/
+	return bClientUpdating || (CharacterOwner->Role == ROLE_Authority && CharacterOwner->IsPlayerControlled() && !CharacterOwner->IsLocallyControlled());
+}
+
+void UFPSCharacterMovementComponent::RequestUnCrouchOverlap(float TargetHalfHeight)
+{
+	UnCrouchOverlapHandles[0] = FTraceHandle();
+	UnCrouchOverlapHandles[1] = FTraceHandle();
+
+	/*ExpandCapsule sweeps to find a place to stand when the base location isn't kept, that can't be done with one overlap*/
+	if (!bAsyncUnCrouchCheck || !bCrouchMaintainsBaseLocation || !HasValidData() || IsDecisionFromMove())
 	{
-		FPSCharacterOwner->RecalculateBaseEyeHeight();
-		//FPSCharacterOwner->CapsuleAdjusted(0.f, 0.f);
+		return;
 	}
-	else
+
+	/*Same shape and locations as the tests in ExpandCapsule*/
+	UWorld* MyWorld = GetWorld();
+	const float SweepInflation = KINDA_SMALL_NUMBER * 10.f;
+	const float ComponentScale = CharacterOwner->GetCapsuleComponent()->GetShapeScale();
+	const float ScaledHalfHeightAdjust = (TargetHalfHeight - CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight()) * ComponentScale;
+	const FCollisionShape StandingCapsuleShape = GetPawnCapsuleCollisionShape(SHRINK_HeightCustom, -SweepInflation - ScaledHalfHeightAdjust);
+	const ECollisionChannel CollisionChannel = UpdatedComponent->GetCollisionObjectType();
+
+	FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(CrouchTrace), false, CharacterOwner);
+	FCollisionResponseParams ResponseParam;
+	InitCollisionParams(CapsuleParams, ResponseParam);
+
+	FVector StandingLocation = UpdatedComponent->GetComponentLocation() + FVector(0.f, 0.f, StandingCapsuleShape.GetCapsuleHalfHeight() - CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+	UnCrouchOverlapHalfHeight = TargetHalfHeight;
+	UnCrouchOverlapHandles[0] = MyWorld->AsyncOverlapByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
+	INC_DWORD_STAT(STAT_FPSMovement_AsyncExpandQueries);
+
+	const float MinFloorDist = KINDA_SMALL_NUMBER * 10.f;
+	if (IsMovingOnGround() && CurrentFloor.bBlockingHit && CurrentFloor.FloorDist > MinFloorDist)
 	{
-		CurrentTransition = EMovementTransition::None;
-		bCheckCrouch = false;
+		StandingLocation.Z -= CurrentFloor.FloorDist - MinFloorDist;
+		UnCrouchOverlapHandles[1] = MyWorld->AsyncOverlapByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
+		INC_DWORD_STAT(STAT_FPSMovement_AsyncExpandQueries);
 	}
 }
 
 bool UFPSCharacterMovementComponent::ShrinkCapsule(float NewUnscaledHalfHeight, bool bClientSimulation)
 {
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_ShrinkCapsule);
+	INC_DWORD_STAT(STAT_FPSMovement_ShrinkCapsuleCalls);
+
 	// Change collision size to crouching dimensions
 	const float ComponentScale = CharacterOwner->GetCapsuleComponent()->GetShapeScale();
 	const float OldUnscaledHalfHeight = CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
 	const float OldUnscaledRadius = CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius();
 
-	CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(OldUnscaledRadius, NewUnscaledHalfHeight);
-	float HalfHeightAdjust = (OldUnscaledHalfHeight - NewUnscaledHalfHeight);
-	float ScaledHalfHeightAdjust = HalfHeightAdjust * ComponentScale;
+	/*Overlap events only for the final size of a replay*/
+	bPendingOverlapUpdate |= ShouldDeferCosmeticUpdates();
+	CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(OldUnscaledRadius, NewUnscaledHalfHeight, !ShouldDeferCosmeticUpdates());
+	const float ScaledHalfHeightAdjust = FPSCrouchKernel::GetCapsuleAdjust(OldUnscaledHalfHeight, NewUnscaledHalfHeight, ComponentScale).ScaledHalfHeightAdjust;
 
 	//UE_LOG(LogTemp, Warning, TEXT("Shrink Capsule Size %f"), CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight());
 
@@ -349,13 +1934,14 @@ bool UFPSCharacterMovementComponent::ShrinkCapsule(float NewUnscaledHalfHeight,
 			FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(CrouchTrace), false, CharacterOwner);
 			FCollisionResponseParams ResponseParam;
 			InitCollisionParams(CapsuleParams, ResponseParam);
+			INC_DWORD_STAT(STAT_FPSMovement_ShrinkQueries);
 			const bool bEncroached = GetWorld()->OverlapBlockingTestByChannel(UpdatedComponent->GetComponentLocation() - FVector(0.f, 0.f, ScaledHalfHeightAdjust), FQuat::Identity,
 				UpdatedComponent->GetCollisionObjectType(), GetPawnCapsuleCollisionShape(SHRINK_None), CapsuleParams, ResponseParam);
 
 			// If encroached, cancel
 			if (bEncroached)
 			{
-				CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(OldUnscaledRadius, OldUnscaledHalfHeight);
+				CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(OldUnscaledRadius, OldUnscaledHalfHeight, !ShouldDeferCosmeticUpdates());
 				return false;
 			}
 		}
@@ -371,12 +1957,10 @@ bool UFPSCharacterMovementComponent::ShrinkCapsule(float NewUnscaledHalfHeight,
 
 	// CapsuleAdjusted takes the change from the Default size, not the current one (though they are usually the same).
 	const float MeshAdjust = ScaledHalfHeightAdjust;
-	ACharacter* DefaultCharacter = CharacterOwner->GetClass()->GetDefaultObject<ACharacter>();
-	HalfHeightAdjust = (DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight() - NewUnscaledHalfHeight);
-	ScaledHalfHeightAdjust = HalfHeightAdjust * ComponentScale;
+	const FPSCrouchKernel::FCapsuleAdjust DefaultAdjust = FPSCrouchKernel::GetCapsuleAdjust(GetMovementProfile().StandingHalfHeight, NewUnscaledHalfHeight, ComponentScale);
 
 	AdjustProxyCapsuleSize();
-	FPSCharacterOwner->CapsuleAdjusted(HalfHeightAdjust, ScaledHalfHeightAdjust);
+	FPSCharacterOwner->CapsuleAdjusted(DefaultAdjust.HalfHeightAdjust, DefaultAdjust.ScaledHalfHeightAdjust);
 
 	// Don't smooth this change in mesh position
 	if (bClientSimulation && CharacterOwner->Role == ROLE_SimulatedProxy)
@@ -394,6 +1978,9 @@ bool UFPSCharacterMovementComponent::ShrinkCapsule(float NewUnscaledHalfHeight,
 
 bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight, bool bClientSimulation)
 {
+	SCOPE_CYCLE_COUNTER(STAT_FPSMovement_ExpandCapsule);
+	INC_DWORD_STAT(STAT_FPSMovement_ExpandCapsuleCalls);
+
 	const float CurrentHalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
 
 	const float ComponentScale = CharacterOwner->GetCapsuleComponent()->GetShapeScale();
@@ -433,6 +2020,7 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 		if (!bCrouchMaintainsBaseLocation)
 		{
 			// Expand in place
+			INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
 			bEncroached = MyWorld->OverlapBlockingTestByChannel(PawnLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 
 			if (bEncroached)
@@ -449,6 +2037,7 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 
 					FHitResult Hit(1.f);
 					const FCollisionShape ShortCapsuleShape = GetPawnCapsuleCollisionShape(SHRINK_HeightCustom, ShrinkHalfHeight);
+					INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
 					const bool bBlockingHit = MyWorld->SweepSingleByChannel(Hit, PawnLocation, PawnLocation + Down, FQuat::Identity, CollisionChannel, ShortCapsuleShape, CapsuleParams);
 					if (Hit.bStartPenetrating)
 					{
@@ -459,6 +2048,7 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 						// Compute where the base of the sweep ended up, and see if we can stand there
 						const float DistanceToBase = (Hit.Time * TraceDist) + ShortCapsuleShape.Capsule.HalfHeight;
 						const FVector NewLoc = FVector(PawnLocation.X, PawnLocation.Y, PawnLocation.Z - DistanceToBase + StandingCapsuleShape.Capsule.HalfHeight + SweepInflation + MIN_FLOOR_DIST / 2.f);
+						INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
 						bEncroached = MyWorld->OverlapBlockingTestByChannel(NewLoc, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 						if (!bEncroached)
 						{
@@ -473,6 +2063,7 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 		{
 			// Expand while keeping base location the same.
 			FVector StandingLocation = PawnLocation + FVector(0.f, 0.f, StandingCapsuleShape.GetCapsuleHalfHeight() - CurrentHalfHeight);
+			INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
 			bEncroached = MyWorld->OverlapBlockingTestByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 
 			if (bEncroached)
@@ -484,6 +2075,7 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 					if (CurrentFloor.bBlockingHit && CurrentFloor.FloorDist > MinFloorDist)
 					{
 						StandingLocation.Z -= CurrentFloor.FloorDist - MinFloorDist;
+						INC_DWORD_STAT(STAT_FPSMovement_ExpandQueries);
 						bEncroached = MyWorld->OverlapBlockingTestByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 					}
 				}
@@ -508,13 +2100,15 @@ bool UFPSCharacterMovementComponent::ExpandCapsule(float NewUnscaledHalfHeight,
 		bShrinkProxyCapsule = true;
 	}
 
-	ACharacter* DefaultCharacter = CharacterOwner->GetClass()->GetDefaultObject<ACharacter>();
-	// Now call SetCapsuleSize() to cause touch/untouch events and actually grow the capsule
-	CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleRadius(), NewUnscaledHalfHeight, true);
+	// Now call SetCapsuleSize() to cause touch/untouch events and actually grow the capsule, replays cause them once at the end
+	bPendingOverlapUpdate |= ShouldDeferCosmeticUpdates();
+	CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(GetMovementProfile().CapsuleRadius, NewUnscaledHalfHeight, !ShouldDeferCosmeticUpdates());
 
+	// CapsuleAdjusted takes the change from the Default size like in ShrinkCapsule, expanding to the crouched size from prone isn't back to the default.
 	const float MeshAdjust = ScaledHalfHeightAdjust;
+	const FPSCrouchKernel::FCapsuleAdjust DefaultAdjust = FPSCrouchKernel::GetCapsuleAdjust(GetMovementProfile().StandingHalfHeight, NewUnscaledHalfHeight, ComponentScale);
 	AdjustProxyCapsuleSize();
-	FPSCharacterOwner->CapsuleAdjusted(HalfHeightAdjust, ScaledHalfHeightAdjust);
+	FPSCharacterOwner->CapsuleAdjusted(DefaultAdjust.HalfHeightAdjust, DefaultAdjust.ScaledHalfHeightAdjust);
 
 	// Don't smooth this change in mesh position
 	if (bClientSimulation && CharacterOwner->Role == ROLE_SimulatedProxy)
@@ -555,12 +2149,72 @@ void UFPSCharacterMovementComponent::PostLoad()
 	}
 }
 
+void UFPSCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	BakeSprintAccelerationCurve();
+	BakeVaultHeightCurve();
+	ProxyDefaultSmoothLocationTime = NetworkSimulatedSmoothLocationTime;
+
+	if (CharacterOwner)
+	{
+		DefaultNetUpdateFrequency = CharacterOwner->NetUpdateFrequency;
+		DefaultMinNetUpdateFrequency = CharacterOwner->MinNetUpdateFrequency;
+	}
+
+	/*Start with full stamina*/
+	StaminaAtMark = FMath::Max(0.f, MaxSprintTime);
+
+	/*Spread the ledge probes of the characters over the interval*/
+	VaultProbeTimer = VaultProbeInterval * (GetUniqueID() % 8) / 8.f;
+}
+
+void UFPSCharacterMovementComponent::BakeSprintAccelerationCurve()
+{
+	SprintCurveSampler.Bake(SprintAccelerationCurve, SprintCurveSampleMode, SprintCurveMaxError);
+}
+
+void UFPSCharacterMovementComponent::OnUnregister()
+{
+	if (ProxyTransitionIndex != INDEX_NONE)
+	{
+		if (FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(GetWorld()))
+		{
+			TransitionManager->RemoveTransition(this);
+		}
+	}
+
+	Super::OnUnregister();
+}
+
+UFPSCharacterMovementComponent* FSavedMove_Character_FPS::GetFPSMovement(ACharacter* Character) const
+{
+	return OwnerMovement ? OwnerMovement : Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+}
+
 void FSavedMove_Character_FPS::Clear()
 {
 	Super::Clear();
 	bSavedWantsToSprint = false;
+	bSavedWantsToProne = false;
+	bSavedUnCrouchDeferred = false;
+	bSavedVaultStarted = false;
+	SavedVaultElapsed = 0.0f;
+	SavedVaultStartLocation = FVector::ZeroVector;
+	SavedVaultEndLocation = FVector::ZeroVector;
+	SavedStaminaClock = 0.0f;
+	SavedStaminaMarkTime = 0.0f;
+	SavedStaminaAtMark = 0.0f;
+	bSavedStaminaDraining = false;
+	bSavedStaminaExhausted = false;
 	SavedCapsuleHeight = 0.0f;
 	SavedTransition = None;
+	SavedTransitionClock = 0.0f;
+	SavedTransitionStartTime = 0.0f;
+	SavedTransitionDirection = 0.0f;
+	SavedQuantizedCapsuleHeight = 0;
+	SavedInputEdges.Reset();
+	bInitialPositionSet = false;
 }
 
 uint8 FSavedMove_Character_FPS::GetCompressedFlags() const
@@ -571,47 +2225,206 @@ uint8 FSavedMove_Character_FPS::GetCompressedFlags() const
 		Result |= FLAG_Custom_0;
 	}
 
+	if (bSavedWantsToProne)
+	{
+		Result |= FLAG_Custom_1;
+	}
+
+	if (bSavedUnCrouchDeferred)
+	{
+		Result |= FLAG_Custom_2;
+	}
+
+	if (bSavedVaultStarted)
+	{
+		Result |= FLAG_Custom_3;
+	}
+
 	return Result;
 }
 
 bool FSavedMove_Character_FPS::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const
 {
-	if (bSavedWantsToSprint != ((FSavedMove_Character_FPS*)NewMove.Get())->bSavedWantsToSprint)
+	const FSavedMove_Character_FPS* NewFPSMove = (FSavedMove_Character_FPS*)NewMove.Get();
+
+	/*The new move has to start with the wants the input edges of this one end with, without edges these are the wants of both moves*/
+	if (GetEndInputWants() != NewFPSMove->GetStartInputWants())
+		return false;
+
+	if (SavedInputEdges.Num() + NewFPSMove->SavedInputEdges.Num() > FPSInputEdge::MaxEdges)
+		return false;
+
+	if (bSavedUnCrouchDeferred != NewFPSMove->bSavedUnCrouchDeferred)
+		return false;
+
+	/*A vault start, or moves during a vault which are placed by the elapsed time*/
+	if (bSavedVaultStarted || NewFPSMove->bSavedVaultStarted || SavedVaultElapsed != NewFPSMove->SavedVaultElapsed)
+		return false;
+
+	/*The stamina changed during this move*/
+	if (SavedStaminaMarkTime != NewFPSMove->SavedStaminaMarkTime || SavedStaminaAtMark != NewFPSMove->SavedStaminaAtMark
+		|| bSavedStaminaDraining != NewFPSMove->bSavedStaminaDraining || bSavedStaminaExhausted != NewFPSMove->bSavedStaminaExhausted)
+		return false;
+
+	if (SavedTransition != NewFPSMove->SavedTransition)
 		return false;
 
-	if (SavedCapsuleHeight != ((FSavedMove_Character_FPS*)NewMove.Get())->SavedCapsuleHeight)
+	/*The timeline was started again during this move, the combined move has to start it at the same time*/
+	if (SavedTransitionStartTime != NewFPSMove->SavedTransitionStartTime || SavedTransitionDirection != NewFPSMove->SavedTransitionDirection)
 		return false;
 
-	if (SavedTransition != ((FSavedMove_Character_FPS*)NewMove.Get())->SavedTransition)
+	/*The height changes every frame of a transition, the combined move is replayed from the start height of this move*/
+	if (SavedTransition == None && SavedCapsuleHeight != NewFPSMove->SavedCapsuleHeight)
 		return false;
 
 	return Super::CanCombineWith(NewMove, Character, MaxDelta);
 }
 
+void FSavedMove_Character_FPS::SetInitialPosition(ACharacter* Character)
+{
+	/*Called a second time on the new move when it's combined with the pending move, once the character is back where the pending move started*/
+	const bool bCombining = bInitialPositionSet;
+	bInitialPositionSet = true;
+
+	Super::SetInitialPosition(Character);
+	UFPSCharacterMovementComponent* FPSMov = GetFPSMovement(Character);
+	if (FPSMov)
+	{
+		const FNetworkPredictionData_Client_Character* ClientData = bCombining ? FPSMov->GetPredictionData_Client_Character() : nullptr;
+		const FSavedMove_Character_FPS* PendingMove = ClientData ? static_cast<const FSavedMove_Character_FPS*>(ClientData->PendingMove.Get()) : nullptr;
+
+		/*Go back to the height and clocks the pending move started at so the combined move covers the summed delta time*/
+		if (PendingMove)
+		{
+			FPSMov->InternalCapsuleHeight = PendingMove->SavedCapsuleHeight;
+			FPSMov->StaminaClock = PendingMove->SavedStaminaClock;
+			FPSMov->TransitionClock = PendingMove->SavedTransitionClock;
+			if (FPSMov->CurrentTransition != None)
+			{
+				INC_DWORD_STAT(STAT_FPSMovement_CombinedTransitionMoves);
+			}
+
+			/*The input edges of both moves in order, the combined move starts with the wants of the pending move and CanCombineWith made sure
+			 *the new move starts where the pending move ended*/
+			if (PendingMove->SavedInputEdges.Num() > 0 || SavedInputEdges.Num() > 0)
+			{
+				FFPSInputEdgeArray Edges = PendingMove->SavedInputEdges;
+				Edges.Append(SavedInputEdges);
+				SavedInputEdges = Edges;
+				FPSMov->MoveInputEdges = Edges;
+
+				const uint8 StartWants = PendingMove->GetStartInputWants();
+				bSavedWantsToSprint = (StartWants & FPSInputEdge::SprintBit) != 0;
+				bWantsToCrouch = (StartWants & FPSInputEdge::CrouchBit) != 0;
+				bSavedWantsToProne = (StartWants & FPSInputEdge::ProneBit) != 0;
+				FPSMov->ApplyInputWants(StartWants);
+				INC_DWORD_STAT(STAT_FPSMovement_InputEdgeMovesCombined);
+				++FPSMov->InputEdgeCounters.NumCombinedWithEdges;
+			}
+		}
+
+		SavedVaultElapsed = FPSMov->VaultElapsed;
+		SavedVaultStartLocation = FPSMov->VaultStartLocation;
+		SavedVaultEndLocation = FPSMov->VaultEndLocation;
+		SaveStanceState(FPSMov);
+	}
+}
+
+void FSavedMove_Character_FPS::SaveStanceState(UFPSCharacterMovementComponent* FPSMov)
+{
+	SavedStaminaClock = FPSMov->StaminaClock;
+	SavedStaminaMarkTime = FPSMov->StaminaMarkTime;
+	SavedStaminaAtMark = FPSMov->StaminaAtMark;
+	bSavedStaminaDraining = FPSMov->bStaminaDraining;
+	bSavedStaminaExhausted = FPSMov->bStaminaExhausted;
+	SavedTransition = FPSMov->CurrentTransition;
+	SavedTransitionClock = FPSMov->TransitionClock;
+	SavedTransitionStartTime = FPSMov->TransitionTimeline.StartTime;
+	SavedTransitionDirection = FPSMov->TransitionTimeline.Direction;
+	SavedCapsuleHeight = FPSMov->InternalCapsuleHeight;
+	SavedQuantizedCapsuleHeight = FPSMov->HasValidData() ? FPSMov->QuantizeCapsuleHeight(SavedCapsuleHeight) : 0;
+}
+
 void FSavedMove_Character_FPS::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character & ClientData)
 {
+	UFPSCharacterMovementComponent* FPSMov = GetFPSMovement(Character);
+
+	/*A new move, the SetInitialPosition of the engine SetMoveFor is the first one*/
+	bInitialPositionSet = false;
 	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
-	UFPSCharacterMovementComponent* FPSMov = Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
 	if (FPSMov)
 	{
 		bSavedWantsToSprint = FPSMov->bWantsToSprint;
-		SavedTransition = FPSMov->CurrentTransition;
-		SavedCapsuleHeight = FPSMov->InternalCapsuleHeight;
+		bSavedWantsToProne = FPSMov->bWantsToProne;
+
+		/*The vault starts in DoJump, which runs before the move is set up*/
+		bSavedVaultStarted = FPSMov->bVaultStarted;
+		FPSMov->bVaultStarted = false;
+
+		/*The input since the last move, this puts the saved wants back to the start of the move if there was any*/
+		FPSMov->TakeInputEdges(*this);
 	}
 }
 
 void FSavedMove_Character_FPS::PrepMoveFor(ACharacter* Character)
 {
 	Super::PrepMoveFor(Character);
-	UFPSCharacterMovementComponent* FPSMov = Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+	UFPSCharacterMovementComponent* FPSMov = GetFPSMovement(Character);
 	if (FPSMov)
 	{
 		FPSMov->bWantsToSprint = bSavedWantsToSprint;
-		FPSMov->CurrentTransition = SavedTransition;
-		FPSMov->InternalCapsuleHeight = SavedCapsuleHeight;
+		FPSMov->bWantsToProne = bSavedWantsToProne;
+		FPSMov->bUnCrouchDeferredByMove = bSavedUnCrouchDeferred;
+		FPSMov->VaultElapsed = SavedVaultElapsed;
+		FPSMov->VaultStartLocation = SavedVaultStartLocation;
+		FPSMov->VaultEndLocation = SavedVaultEndLocation;
+		FPSMov->MoveInputEdges = SavedInputEdges;
+
+		/*After a correction with the stance of the server the moves carry on from the replayed state and keep it for when they are sent again*/
+		if (!FPSMov->bMoveStateCorrected)
+		{
+			FPSMov->StaminaClock = SavedStaminaClock;
+			FPSMov->StaminaMarkTime = SavedStaminaMarkTime;
+			FPSMov->StaminaAtMark = SavedStaminaAtMark;
+			FPSMov->bStaminaDraining = bSavedStaminaDraining;
+			FPSMov->bStaminaExhausted = bSavedStaminaExhausted;
+			FPSMov->CurrentTransition = SavedTransition;
+			FPSMov->TransitionClock = SavedTransitionClock;
+			FPSMov->TransitionTimeline = { SavedTransitionStartTime, SavedTransitionDirection };
+			FPSMov->InternalCapsuleHeight = SavedCapsuleHeight;
+		}
+
+		if (FPSMov->bApplyMoveStateCorrection)
+		{
+			FPSMov->ApplyMoveStateCorrection();
+		}
+
+		if (FPSMov->bMoveStateCorrected)
+		{
+			SaveStanceState(FPSMov);
+		}
+		FPSMov->InvalidateMovementSnapshot();
+	}
+}
+
+void FSavedMove_Character_FPS::PostUpdate(ACharacter* Character, EPostUpdateMode PostUpdateMode)
+{
+	Super::PostUpdate(Character, PostUpdateMode);
+
+	/*Decided during the move, the server and replays have to use the same decision*/
+	UFPSCharacterMovementComponent* FPSMov = GetFPSMovement(Character);
+	if (FPSMov && PostUpdateMode == PostUpdate_Record)
+	{
+		bSavedUnCrouchDeferred = FPSMov->bUnCrouchDeferred;
 	}
 }
 
+bool FSavedMove_Character_FPS::IsImportantMove(const FSavedMovePtr& LastAckedMove) const
+{
+	/*The next move doesn't sample input edges again like it does the wants, a move with edges is resent as the old move until it's acknowledged*/
+	return SavedInputEdges.Num() > 0 || Super::IsImportantMove(LastAckedMove);
+}
+
 
 
 
@@ -0,0 +1,348 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSCrouchTransitionManager.h"
+#include "FPSCharacterMovementComponent.h"
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSMovementProfile.h"
+#include "Player/FPSMovementStats.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/CapsuleComponent.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarProxyTransitionLOD(
+	TEXT("fps.Movement.ProxyTransitionLOD"),
+	1,
+	TEXT("Update the crouch transitions of simulated proxies by their distance to the local cameras\n")
+	TEXT("0: every transition every frame, 1: reduced rate and snapping by the distances set on the movement component"));
+
+namespace FPSCrouchTransitionManager
+{
+	static TMap<const UWorld*, TUniquePtr<FFPSCrouchTransitionManager>> Managers;
+	static FDelegateHandle WorldCleanupHandle;
+}
+
+FFPSCrouchTransitionManager::FFPSCrouchTransitionManager(UWorld* InWorld)
+	: World(InWorld)
+{
+}
+
+FFPSCrouchTransitionManager::~FFPSCrouchTransitionManager()
+{
+	for (const TWeakObjectPtr<UFPSCharacterMovementComponent>& Component : Components)
+	{
+		if (Component.IsValid())
+		{
+			Component->ProxyTransitionIndex = INDEX_NONE;
+		}
+	}
+}
+
+FFPSCrouchTransitionManager* FFPSCrouchTransitionManager::Get(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	TUniquePtr<FFPSCrouchTransitionManager>& Manager = FPSCrouchTransitionManager::Managers.FindOrAdd(World);
+	if (!Manager.IsValid())
+	{
+		Manager = MakeUnique<FFPSCrouchTransitionManager>(World);
+
+		if (!FPSCrouchTransitionManager::WorldCleanupHandle.IsValid())
+		{
+			FPSCrouchTransitionManager::WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&FFPSCrouchTransitionManager::OnWorldCleanup);
+		}
+	}
+
+	return Manager.Get();
+}
+
+void FFPSCrouchTransitionManager::OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources)
+{
+	FPSCrouchTransitionManager::Managers.Remove(InWorld);
+}
+
+void FFPSCrouchTransitionManager::AddTransition(UFPSCharacterMovementComponent* MovementComponent, bool bCrouch)
+{
+	AFPSCharacterBase* FPSOwner = MovementComponent ? MovementComponent->GetFPSOwner() : nullptr;
+	if (!FPSOwner)
+	{
+		return;
+	}
+
+	int32 Index = MovementComponent->ProxyTransitionIndex;
+	if (Index != INDEX_NONE && bCrouching[Index] == bCrouch)
+	{
+		return;
+	}
+
+	const FFPSMovementProfile& Profile = MovementComponent->GetMovementProfile();
+
+	/*Too far away to see the transition, go straight to the final state without adding it*/
+	if (CVarProxyTransitionLOD.GetValueOnGameThread() != 0 && MovementComponent->ProxyTransitionSnapDistance > 0.f)
+	{
+		FViewInfo Views;
+		GatherViews(Views);
+
+		bool bBehind = false;
+		if (Views.Locations.Num() > 0
+			&& GetViewDistanceSquared(Views, FPSOwner->GetActorLocation(), bBehind) > FMath::Square(MovementComponent->ProxyTransitionSnapDistance))
+		{
+			if (Index != INDEX_NONE)
+			{
+				RemoveAtSwap(Index);
+				MovementComponent->ProxyTransitionIndex = INDEX_NONE;
+			}
+
+			const float FinalHeight = bCrouch ? Profile.CrouchedHalfHeight : Profile.StandingHalfHeight;
+			MovementComponent->BeginProxyTransition(bCrouch);
+			MovementComponent->FinishProxyTransition(FinalHeight, FPSCrouchKernel::GetEyeHeight(Profile.StanceMetrics, FinalHeight));
+			INC_DWORD_STAT(STAT_FPSMovement_ProxyTransitionsSnapped);
+			return;
+		}
+	}
+
+	MovementComponent->BeginProxyTransition(bCrouch);
+
+	if (Index == INDEX_NONE)
+	{
+		Index = Components.Add(MovementComponent);
+		Owners.Add(FPSOwner);
+		Heights.Add(MovementComponent->InternalCapsuleHeight);
+		TargetHeights.AddUninitialized();
+		MinHeights.AddUninitialized();
+		InterpSpeeds.AddUninitialized();
+		EyeHeights.Add(FPSOwner->BaseEyeHeight);
+		CrouchedHalfHeights.AddUninitialized();
+		CrouchedEyeHeights.AddUninitialized();
+		EyeHeightSlopes.AddUninitialized();
+		bCrouching.AddUninitialized();
+		PendingDeltaTimes.Add(0.f);
+		StepTimes.AddUninitialized();
+		SnapDistancesSquared.AddUninitialized();
+		ReducedRateDistancesSquared.AddUninitialized();
+		ReducedRateIntervals.AddUninitialized();
+
+		MovementComponent->ProxyTransitionIndex = Index;
+		INC_DWORD_STAT(STAT_FPSMovement_ProxyTransitionsActive);
+	}
+
+	TargetHeights[Index] = bCrouch ? Profile.CrouchedHalfHeight : Profile.StandingHalfHeight;
+	MinHeights[Index] = FMath::Max(0.f, FPSOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius());
+	InterpSpeeds[Index] = Profile.CrouchInterpSpeed;
+	CrouchedHalfHeights[Index] = Profile.CrouchedHalfHeight;
+	CrouchedEyeHeights[Index] = Profile.CrouchedEyeHeight;
+	EyeHeightSlopes[Index] = Profile.EyeHeightSlope;
+	bCrouching[Index] = bCrouch;
+	SnapDistancesSquared[Index] = FMath::Square(MovementComponent->ProxyTransitionSnapDistance);
+	ReducedRateDistancesSquared[Index] = FMath::Square(MovementComponent->ProxyTransitionReducedRateDistance);
+	ReducedRateIntervals[Index] = MovementComponent->ProxyTransitionReducedRateInterval;
+}
+
+void FFPSCrouchTransitionManager::SetViewOverride(const TArray<FVector>& Locations, const TArray<FVector>& Directions)
+{
+	check(Locations.Num() == Directions.Num());
+	OverrideViewLocations = Locations;
+	OverrideViewDirections = Directions;
+}
+
+void FFPSCrouchTransitionManager::GatherViews(FViewInfo& OutViews) const
+{
+	UWorld* MyWorld = World.Get();
+	if (!MyWorld)
+	{
+		return;
+	}
+
+	/*No view targets, the overridden views don't look through any character*/
+	if (OverrideViewLocations.Num() > 0)
+	{
+		OutViews.Locations.Append(OverrideViewLocations);
+		OutViews.Directions.Append(OverrideViewDirections);
+		return;
+	}
+
+	for (FConstPlayerControllerIterator Iterator = MyWorld->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+		{
+			const APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager;
+			OutViews.Targets.Add(CameraManager->GetViewTarget());
+			OutViews.Locations.Add(CameraManager->GetCameraLocation());
+			OutViews.Directions.Add(CameraManager->GetCameraRotation().Vector());
+		}
+	}
+}
+
+float FFPSCrouchTransitionManager::GetViewDistanceSquared(const FViewInfo& Views, const FVector& Location, bool& bOutBehind)
+{
+	float ClosestDistanceSquared = BIG_NUMBER;
+	bOutBehind = true;
+
+	for (int32 View = 0; View < Views.Locations.Num(); ++View)
+	{
+		const FVector ToLocation = Location - Views.Locations[View];
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, ToLocation.SizeSquared());
+		bOutBehind &= (ToLocation | Views.Directions[View]) < 0.f;
+	}
+
+	return ClosestDistanceSquared;
+}
+
+void FFPSCrouchTransitionManager::SetTransitionHeight(UFPSCharacterMovementComponent* MovementComponent, float Height)
+{
+	const int32 Index = MovementComponent ? MovementComponent->ProxyTransitionIndex : INDEX_NONE;
+	if (!Heights.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	/*How far the local transition had drifted from the server*/
+	const float NewHeight = FMath::Max(MinHeights[Index], Height);
+	INC_FLOAT_STAT_BY(STAT_FPSMovement_ProxyStanceHeightError, FMath::Abs(Heights[Index] - NewHeight));
+
+	Heights[Index] = NewHeight;
+	EyeHeights[Index] = FPSCrouchKernel::GetLinearEyeHeight(NewHeight, CrouchedHalfHeights[Index], CrouchedEyeHeights[Index], EyeHeightSlopes[Index]);
+}
+
+void FFPSCrouchTransitionManager::RemoveTransition(UFPSCharacterMovementComponent* MovementComponent)
+{
+	if (MovementComponent && Components.IsValidIndex(MovementComponent->ProxyTransitionIndex))
+	{
+		RemoveAtSwap(MovementComponent->ProxyTransitionIndex);
+		MovementComponent->ProxyTransitionIndex = INDEX_NONE;
+	}
+}
+
+void FFPSCrouchTransitionManager::Tick(float DeltaTime)
+{
+	UWorld* MyWorld = World.Get();
+	if (!MyWorld)
+	{
+		return;
+	}
+
+	/*Only the characters we are looking through need the camera moved during the transition*/
+	FViewInfo Views;
+	GatherViews(Views);
+
+	const int32 Count = Heights.Num();
+	float* RESTRICT Height = Heights.GetData();
+	const float* RESTRICT TargetHeight = TargetHeights.GetData();
+	float* RESTRICT StepTime = StepTimes.GetData();
+
+	/*Pick the rate of each transition, reduced rate ones keep the time until the interval has passed so the total is the same*/
+	const bool bUseLOD = CVarProxyTransitionLOD.GetValueOnGameThread() != 0 && Views.Locations.Num() > 0;
+	int32 NumSkipped = 0;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		PendingDeltaTimes[i] += DeltaTime;
+		StepTime[i] = PendingDeltaTimes[i];
+
+		const UFPSCharacterMovementComponent* MovementComponent = Components[i].Get();
+		if (bUseLOD && MovementComponent && MovementComponent->UpdatedComponent)
+		{
+			bool bBehind = false;
+			const float DistanceSquared = GetViewDistanceSquared(Views, MovementComponent->UpdatedComponent->GetComponentLocation(), bBehind);
+
+			if (SnapDistancesSquared[i] > 0.f && DistanceSquared > SnapDistancesSquared[i])
+			{
+				Height[i] = TargetHeight[i];
+			}
+			else if ((bBehind || (ReducedRateDistancesSquared[i] > 0.f && DistanceSquared > ReducedRateDistancesSquared[i]))
+				&& PendingDeltaTimes[i] < ReducedRateIntervals[i]
+				&& !Views.Targets.Contains(Owners[i]))
+			{
+				StepTime[i] = 0.f;
+				++NumSkipped;
+				continue;
+			}
+		}
+
+		PendingDeltaTimes[i] = 0.f;
+	}
+	INC_DWORD_STAT_BY(STAT_FPSMovement_ProxyTransitionsSkipped, NumSkipped);
+
+	/*Same as the crouch part of FPSCrouchKernel::Step in UFPSCharacterMovementComponent::Crouch/UnCrouch*/
+	FPSCrouchKernel::FTransitionBatch Batch;
+	Batch.Heights = Height;
+	Batch.EyeHeights = EyeHeights.GetData();
+	Batch.TargetHeights = TargetHeight;
+	Batch.MinHeights = MinHeights.GetData();
+	Batch.InterpSpeeds = InterpSpeeds.GetData();
+	Batch.CrouchedHalfHeights = CrouchedHalfHeights.GetData();
+	Batch.CrouchedEyeHeights = CrouchedEyeHeights.GetData();
+	Batch.EyeHeightSlopes = EyeHeightSlopes.GetData();
+	Batch.DeltaTimes = StepTime;
+	Batch.Count = Count;
+	FPSCrouchKernel::StepBatch(Batch);
+
+	/*Going backwards so the swapped in element has already been processed*/
+	for (int32 i = Count - 1; i >= 0; --i)
+	{
+		if (Height[i] == TargetHeight[i] || !Components[i].IsValid())
+		{
+			FinishTransition(i);
+		}
+		else if (Views.Targets.Num() > 0 && Views.Targets.Contains(Owners[i]))
+		{
+			UFPSCharacterMovementComponent* MovementComponent = Components[i].Get();
+			MovementComponent->InternalCapsuleHeight = Height[i];
+			MovementComponent->GetFPSOwner()->BaseEyeHeight = EyeHeights[i];
+			MovementComponent->GetFPSOwner()->RecalculateBaseEyeHeight();
+		}
+	}
+}
+
+void FFPSCrouchTransitionManager::FinishTransition(int32 Index)
+{
+	UFPSCharacterMovementComponent* MovementComponent = Components[Index].Get();
+	const float FinalHeight = Heights[Index];
+	const float FinalEyeHeight = EyeHeights[Index];
+
+	RemoveAtSwap(Index);
+
+	if (MovementComponent)
+	{
+		MovementComponent->ProxyTransitionIndex = INDEX_NONE;
+		MovementComponent->FinishProxyTransition(FinalHeight, FinalEyeHeight);
+	}
+}
+
+void FFPSCrouchTransitionManager::RemoveAtSwap(int32 Index)
+{
+	DEC_DWORD_STAT(STAT_FPSMovement_ProxyTransitionsActive);
+
+	const int32 LastIndex = Components.Num() - 1;
+	if (Index != LastIndex && Components[LastIndex].IsValid())
+	{
+		Components[LastIndex]->ProxyTransitionIndex = Index;
+	}
+
+	Components.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	Heights.RemoveAtSwap(Index, 1, false);
+	TargetHeights.RemoveAtSwap(Index, 1, false);
+	MinHeights.RemoveAtSwap(Index, 1, false);
+	InterpSpeeds.RemoveAtSwap(Index, 1, false);
+	EyeHeights.RemoveAtSwap(Index, 1, false);
+	CrouchedHalfHeights.RemoveAtSwap(Index, 1, false);
+	CrouchedEyeHeights.RemoveAtSwap(Index, 1, false);
+	EyeHeightSlopes.RemoveAtSwap(Index, 1, false);
+	bCrouching.RemoveAtSwap(Index, 1, false);
+	PendingDeltaTimes.RemoveAtSwap(Index, 1, false);
+	StepTimes.RemoveAtSwap(Index, 1, false);
+	SnapDistancesSquared.RemoveAtSwap(Index, 1, false);
+	ReducedRateDistancesSquared.RemoveAtSwap(Index, 1, false);
+	ReducedRateIntervals.RemoveAtSwap(Index, 1, false);
+}
+
+TStatId FFPSCrouchTransitionManager::GetStatId() const
+{
+	return GET_STATID(STAT_FPSMovement_ProxyTransitions);
+}
@@ -0,0 +1,104 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSCurveSampler.h"
+#include "Curves/CurveFloat.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFPSCurveSampler, Log, All);
+
+/*Error is measured at this many points per table interval*/
+static const int32 ErrorSamplesPerInterval = 8;
+
+FFPSCurveSampler::FFPSCurveSampler()
+{
+	Reset();
+}
+
+void FFPSCurveSampler::Reset()
+{
+	FMemory::Memzero(Table);
+	FMemory::Memzero(Coefficients);
+	SourceCurve = nullptr;
+	Mode = EFPSCurveSampleMode::Curve;
+	MaxError = 0.f;
+}
+
+EFPSCurveSampleMode FFPSCurveSampler::Bake(const UCurveFloat* Curve, EFPSCurveSampleMode RequestedMode, float InMaxError)
+{
+	Reset();
+	if (!Curve || RequestedMode == EFPSCurveSampleMode::Curve)
+	{
+		return Mode;
+	}
+
+	SourceCurve = Curve;
+
+	for (int32 i = 0; i <= NumTableIntervals; ++i)
+	{
+		Table[i] = Curve->GetFloatValue((float)i / NumTableIntervals);
+	}
+
+	/*Cubic hermite through the segment ends, the slopes are central differences of the source curve scaled to the segment*/
+	const float SegmentWidth = 1.f / NumSegments;
+	const float SlopeDelta = SegmentWidth * 0.25f;
+	for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+	{
+		const float X0 = Segment * SegmentWidth;
+		const float X1 = X0 + SegmentWidth;
+		const float Y0 = Curve->GetFloatValue(X0);
+		const float Y1 = Curve->GetFloatValue(X1);
+
+		auto SegmentSlope = [Curve, SlopeDelta, SegmentWidth](float X)
+		{
+			const float Low = FMath::Max(0.f, X - SlopeDelta);
+			const float High = FMath::Min(1.f, X + SlopeDelta);
+			return (Curve->GetFloatValue(High) - Curve->GetFloatValue(Low)) / (High - Low) * SegmentWidth;
+		};
+
+		const float M0 = SegmentSlope(X0);
+		const float M1 = SegmentSlope(X1);
+
+		Coefficients[Segment][0] = Y0;
+		Coefficients[Segment][1] = M0;
+		Coefficients[Segment][2] = 3.f * (Y1 - Y0) - 2.f * M0 - M1;
+		Coefficients[Segment][3] = 2.f * (Y0 - Y1) + M0 + M1;
+	}
+
+	/*Use the requested mode if it's within the error bound, otherwise fall back to the more accurate one*/
+	Mode = RequestedMode;
+	MaxError = MeasureError(Curve, Mode);
+
+	if (Mode == EFPSCurveSampleMode::Polynomial && MaxError > InMaxError)
+	{
+		UE_LOG(LogFPSCurveSampler, Log, TEXT("%s polynomial fit error %f is over %f, using the lookup table"), *Curve->GetName(), MaxError, InMaxError);
+		Mode = EFPSCurveSampleMode::LookupTable;
+		MaxError = MeasureError(Curve, Mode);
+	}
+
+	if (MaxError > InMaxError)
+	{
+		UE_LOG(LogFPSCurveSampler, Warning, TEXT("%s lookup table error %f is over %f, evaluating the curve directly"), *Curve->GetName(), MaxError, InMaxError);
+		Reset();
+	}
+
+	return Mode;
+}
+
+float FFPSCurveSampler::EvaluateSource(float Time) const
+{
+	return SourceCurve->GetFloatValue(Time);
+}
+
+float FFPSCurveSampler::MeasureError(const UCurveFloat* Curve, EFPSCurveSampleMode TestMode) const
+{
+	const int32 NumErrorSamples = NumTableIntervals * ErrorSamplesPerInterval;
+
+	float LargestError = 0.f;
+	for (int32 i = 0; i <= NumErrorSamples; ++i)
+	{
+		const float Time = (float)i / NumErrorSamples;
+		const float Baked = (TestMode == EFPSCurveSampleMode::Polynomial) ? EvaluatePolynomial(Time) : EvaluateTable(Time);
+		LargestError = FMath::Max(LargestError, FMath::Abs(Baked - Curve->GetFloatValue(Time)));
+	}
+
+	return LargestError;
+}
@@ -0,0 +1,1512 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "FPSCharacterMovementComponent.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSCrouchTransitionManager.h"
+#include "Player/FPSCurveSampler.h"
+#include "Player/FPSMovementProfile.h"
+#include "Player/FPSMovementStateTable.h"
+#include "Player/FPSSprintKernel.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Curves/CurveFloat.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Containers/Ticker.h"
+#include "Math/RandomStream.h"
+#include "Misc/Crc.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFPSMovementBenchmark, Log, All);
+
+/**
+ * Headless movement benchmark, meant to be run on a -nullrhi dedicated server in a fixed test map, e.g.
+ * -ExecCmds="fps.Movement.Benchmark 128 1200"
+ * Spawns the characters, feeds them a scripted input stream (sprint and crouch toggles, jumps, strafes) and steps
+ * their movement at a fixed time step, advancing the world clock with every frame. Reports the time per frame and per character
+ * and a hash of the final transforms so determinism regressions show up when the hash changes.
+ * Allocations aren't counted here, run with -llm and use "stat LLM" or memreport to see them.
+ */
+
+static TAutoConsoleVariable<FString> CVarBenchmarkCharacterClass(
+	TEXT("fps.Movement.BenchmarkCharacterClass"),
+	TEXT(""),
+	TEXT("Character class spawned by fps.Movement.Benchmark, e.g. /Game/Player/BP_Player.BP_Player_C. AFPSCharacterBase if empty"));
+
+namespace FPSMovementBenchmark
+{
+	/** Scripted input of one character, a new random action is picked when FramesLeft runs out. */
+	struct FScriptedInput
+	{
+		FRandomStream Stream;
+		float Forward;
+		float Right;
+		float Yaw;
+		int32 FramesLeft;
+	};
+
+	/*Pick a new random action when the last one runs out and add the movement input of the frame, a third of the actions stand still if bStandStill*/
+	static void StepScriptedInput(AFPSCharacterBase* Character, FScriptedInput& Input, bool bStandStill)
+	{
+		if (--Input.FramesLeft <= 0)
+		{
+			Input.FramesLeft = Input.Stream.RandRange(10, 90);
+			Input.Forward = Input.Stream.FRandRange(-0.5f, 1.f);
+			Input.Right = Input.Stream.FRandRange(-1.f, 1.f);
+			Input.Yaw += Input.Stream.FRandRange(-60.f, 60.f);
+
+			if (bStandStill && Input.Stream.FRand() < 0.33f)
+			{
+				Input.Forward = 0.f;
+				Input.Right = 0.f;
+			}
+
+			Character->StopJumping();
+			if (Input.Stream.FRand() < 0.3f)
+			{
+				if (Input.Stream.FRand() < 0.5f)
+				{
+					Character->StartSprint();
+				}
+				else
+				{
+					Character->StopSprint();
+				}
+			}
+			if (Input.Stream.FRand() < 0.2f)
+			{
+				Character->ToggleCrouch();
+			}
+			if (Input.Stream.FRand() < 0.1f)
+			{
+				Character->Jump();
+			}
+		}
+
+		const FRotator ControlRotation(0.f, Input.Yaw, 0.f);
+		if (Character->Controller)
+		{
+			Character->Controller->SetControlRotation(ControlRotation);
+		}
+
+		Character->AddMovementInput(ControlRotation.Vector(), Input.Forward);
+		Character->AddMovementInput(FRotationMatrix(ControlRotation).GetScaledAxis(EAxis::Y), Input.Right);
+	}
+
+	/*Spawn the characters on a grid far enough apart that they don't block each other, their ticks are off so the benchmark steps them itself*/
+	static TArray<AFPSCharacterBase*> SpawnBenchmarkCharacters(UWorld* World, UClass* CharacterClass, int32 NumCharacters)
+	{
+		const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)NumCharacters));
+		const float GridSpacing = 400.f;
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+		TArray<AFPSCharacterBase*> Characters;
+		for (int32 i = 0; i < NumCharacters; ++i)
+		{
+			const FVector Location((i % GridSize) * GridSpacing, (i / GridSize) * GridSpacing, 200.f);
+			AFPSCharacterBase* Character = World->SpawnActor<AFPSCharacterBase>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParameters);
+			UFPSCharacterMovementComponent* MovementComponent = Character ? Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+			if (!MovementComponent)
+			{
+				continue;
+			}
+
+			/*The controller is needed for the forward test of the sprint*/
+			Character->SpawnDefaultController();
+			MovementComponent->bRunPhysicsWithNoController = true;
+			MovementComponent->SetComponentTickEnabled(false);
+			Character->SetActorTickEnabled(false);
+			Characters.Add(Character);
+		}
+		return Characters;
+	}
+
+	static void DestroyBenchmarkCharacters(const TArray<AFPSCharacterBase*>& Characters)
+	{
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			if (Character->Controller)
+			{
+				Character->Controller->Destroy();
+			}
+			Character->Destroy();
+		}
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.Benchmark has to run on the server or standalone"));
+			return;
+		}
+
+		const int32 NumCharacters = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64);
+		const int32 NumFrames = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600);
+		const int32 Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 0;
+		const float FixedDeltaTime = 1.f / 60.f;
+
+		UClass* CharacterClass = AFPSCharacterBase::StaticClass();
+		const FString ClassPath = CVarBenchmarkCharacterClass.GetValueOnGameThread();
+		if (!ClassPath.IsEmpty())
+		{
+			UClass* LoadedClass = LoadClass<AFPSCharacterBase>(nullptr, *ClassPath);
+			if (!LoadedClass)
+			{
+				UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("Unable to load %s"), *ClassPath);
+				return;
+			}
+			CharacterClass = LoadedClass;
+		}
+
+		const TArray<AFPSCharacterBase*> Characters = SpawnBenchmarkCharacters(World, CharacterClass, NumCharacters);
+		TArray<FScriptedInput> Inputs;
+		for (int32 i = 0; i < Characters.Num(); ++i)
+		{
+			FScriptedInput& Input = Inputs.AddDefaulted_GetRef();
+			Input.Stream.Initialize(Seed + i);
+			Input.Forward = 0.f;
+			Input.Right = 0.f;
+			Input.Yaw = 0.f;
+			Input.FramesLeft = 0;
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 i = 0; i < Characters.Num(); ++i)
+			{
+				StepScriptedInput(Characters[i], Inputs[i], false);
+			}
+
+			/*The movement reads the world time for its timestamps and timers, move it on like the world tick would*/
+			World->TimeSeconds += FixedDeltaTime;
+			World->UnpausedTimeSeconds += FixedDeltaTime;
+			World->RealTimeSeconds += FixedDeltaTime;
+			World->DeltaTimeSeconds = FixedDeltaTime;
+
+			for (AFPSCharacterBase* Character : Characters)
+			{
+				UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+				MovementComponent->TickComponent(FixedDeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+		}
+		const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+		/*Hash the final state, any change in the simulation changes the hash*/
+		uint32 Hash = 0;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			const UFPSCharacterMovementComponent* MovementComponent = CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+			const FVector Location = Character->GetActorLocation();
+			const FRotator Rotation = Character->GetActorRotation();
+			const FVector Velocity = MovementComponent->Velocity;
+			const float CapsuleHeight = MovementComponent->InternalCapsuleHeight;
+
+			Hash = FCrc::MemCrc32(&Location, sizeof(Location), Hash);
+			Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+			Hash = FCrc::MemCrc32(&Velocity, sizeof(Velocity), Hash);
+			Hash = FCrc::MemCrc32(&CapsuleHeight, sizeof(CapsuleHeight), Hash);
+		}
+
+		const int32 NumSpawned = Characters.Num();
+		DestroyBenchmarkCharacters(Characters);
+
+		const double FrameMilliseconds = ElapsedSeconds * 1000.0 / NumFrames;
+		const double CharacterMicroseconds = NumSpawned > 0 ? ElapsedSeconds * 1000000.0 / ((double)NumFrames * NumSpawned) : 0.0;
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Characters=%d Frames=%d Seed=%d FPS=%.1f FrameMs=%.3f CharacterUs=%.3f Hash=%08X"),
+			NumSpawned, NumFrames, Seed, NumFrames / FMath::Max(ElapsedSeconds, SMALL_NUMBER), FrameMilliseconds, CharacterMicroseconds, Hash);
+	}
+}
+
+/**
+ * Blocked uncrouch benchmark, meant to be run on a -nullrhi dedicated server in a fixed test map like fps.Movement.Benchmark, e.g.
+ * -ExecCmds="fps.Movement.CoverBenchmark 100 600"
+ * Crouches the characters, puts a ceiling over each one and has them try to stand up every frame.
+ * The frames are stepped with bAsyncUnCrouchCheck off and on, the async traces are flushed after every stepped frame like the world tick does.
+ */
+namespace FPSMovementCoverBenchmark
+{
+	static double StepCharacters(UWorld* World, const TArray<AFPSCharacterBase*>& Characters, int32 NumFrames, float FixedDeltaTime)
+	{
+		double MovementSeconds = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			World->ResetAsyncTrace();
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (AFPSCharacterBase* Character : Characters)
+			{
+				UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+				MovementComponent->TickComponent(FixedDeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+			MovementSeconds += FPlatformTime::Seconds() - StartTime;
+
+			World->FinishAsyncTrace();
+		}
+		return MovementSeconds;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		UStaticMesh* CeilingMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		if (!World || World->GetNetMode() == NM_Client || !CeilingMesh)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.CoverBenchmark has to run on the server or standalone"));
+			return;
+		}
+
+		const int32 NumCharacters = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100);
+		const int32 NumFrames = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600);
+		const float FixedDeltaTime = 1.f / 60.f;
+
+		const TArray<AFPSCharacterBase*> Characters = FPSMovementBenchmark::SpawnBenchmarkCharacters(World, AFPSCharacterBase::StaticClass(), NumCharacters);
+		float CrouchTime = 0.f;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			Character->Crouch();
+			CrouchTime = FMath::Max(CrouchTime, CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement())->CrouchTime);
+		}
+
+		/*Land and finish crouching before the ceilings go in*/
+		StepCharacters(World, Characters, FMath::CeilToInt((CrouchTime + 1.f) / FixedDeltaTime), FixedDeltaTime);
+
+		TArray<AActor*> Ceilings;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			/*The cube is 100 units, scaled to a 20 unit thick slab 10 units over the crouched capsule*/
+			const FVector CapsuleTop = Character->GetActorLocation() + FVector(0.f, 0.f, Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+			AStaticMeshActor* Ceiling = World->SpawnActor<AStaticMeshActor>(CapsuleTop + FVector(0.f, 0.f, 20.f), FRotator::ZeroRotator);
+			if (Ceiling)
+			{
+				Ceiling->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+				Ceiling->GetStaticMeshComponent()->SetStaticMesh(CeilingMesh);
+				Ceiling->SetActorScale3D(FVector(2.f, 2.f, 0.2f));
+				Ceilings.Add(Ceiling);
+			}
+
+			Character->UnCrouch();
+		}
+
+		double Seconds[2];
+		int32 NumStanding = 0;
+		for (int32 Pass = 0; Pass < 2; ++Pass)
+		{
+			for (AFPSCharacterBase* Character : Characters)
+			{
+				CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement())->bAsyncUnCrouchCheck = (Pass == 1);
+			}
+			Seconds[Pass] = StepCharacters(World, Characters, NumFrames, FixedDeltaTime);
+		}
+
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			NumStanding += Character->bIsCrouched ? 0 : 1;
+		}
+		FPSMovementBenchmark::DestroyBenchmarkCharacters(Characters);
+
+		for (AActor* Ceiling : Ceilings)
+		{
+			Ceiling->Destroy();
+		}
+
+		/*Any standing character got out from under its ceiling and doesn't measure the blocked case*/
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Characters=%d Frames=%d Standing=%d SyncFrameMs=%.3f AsyncFrameMs=%.3f Saved=%.1f%%"),
+			Characters.Num(), NumFrames, NumStanding, Seconds[0] * 1000.0 / NumFrames, Seconds[1] * 1000.0 / NumFrames,
+			Seconds[0] > 0.0 ? (1.0 - Seconds[1] / Seconds[0]) * 100.0 : 0.0);
+	}
+}
+
+/**
+ * Simulated proxy crouch transition benchmark, run on a server or standalone with or without a local player, e.g.
+ * fps.Movement.ProxyBenchmark 256 600
+ * Spawns the characters in front of the view out to twice ProxyTransitionSnapDistance, makes them simulated proxies
+ * and toggles their crouch every second with staggered starts. The transitions are stepped one component at a time the way
+ * Crouch/UnCrouch used to do it, through the transition manager at full rate and with fps.Movement.ProxyTransitionLOD on.
+ * Without a count it runs 16, 128 and 512 proxies and reports how the cost per proxy grows for each path.
+ * The view is the camera of the first local player or the world origin looking down X without one, given to the transition manager
+ * with SetViewOverride so no viewport is needed. FPS.Movement.Stance.ProxyTransitionGrowth checks the growth of the batched paths.
+ */
+namespace FPSMovementProxyBenchmark
+{
+	struct FResult
+	{
+		int32 NumProxies;
+		double PerComponentSeconds;
+		double FullRateSeconds;
+		double LODSeconds;
+	};
+
+	/*The per component interpolation from before the transition manager, class default lookups and the eye height written every frame*/
+	static double StepPerComponent(const TArray<AFPSCharacterBase*>& Characters, int32 NumFrames, float FixedDeltaTime)
+	{
+		const int32 FramesPerToggle = 60;
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 i = 0; i < Characters.Num(); ++i)
+			{
+				AFPSCharacterBase* Character = Characters[i];
+				UFPSCharacterMovementComponent* MovementComponent = CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+				if ((Frame + i) % FramesPerToggle == 0)
+				{
+					Character->bIsCrouched = !Character->bIsCrouched;
+					MovementComponent->CurrentTransition = Character->bIsCrouched ? Stand_to_Crouch : Crouch_to_Stand;
+				}
+
+				if (MovementComponent->CurrentTransition == None)
+				{
+					continue;
+				}
+
+				const ACharacter* DefaultCharacter = Character->GetClass()->GetDefaultObject<ACharacter>();
+				const float DefaultStandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
+				const float CrouchedHalfHeight = MovementComponent->CrouchedHalfHeight;
+				const float InterpSpeed = (DefaultStandingHalfHeight - CrouchedHalfHeight) / MovementComponent->CrouchTime;
+				const float TargetHalfHeight = Character->bIsCrouched ? CrouchedHalfHeight : DefaultStandingHalfHeight;
+
+				MovementComponent->InternalCapsuleHeight = FMath::Max3(0.f, Character->GetCapsuleComponent()->GetUnscaledCapsuleRadius(),
+					FMath::FInterpConstantTo(MovementComponent->InternalCapsuleHeight, TargetHalfHeight, FixedDeltaTime, InterpSpeed));
+
+				const float NormalisedAlpha = (DefaultStandingHalfHeight - MovementComponent->InternalCapsuleHeight) / (DefaultStandingHalfHeight - CrouchedHalfHeight);
+				Character->BaseEyeHeight = FMath::Lerp(Character->DefaultEyeHeight, Character->CrouchedEyeHeight, NormalisedAlpha);
+
+				if (MovementComponent->InternalCapsuleHeight != TargetHalfHeight)
+				{
+					Character->RecalculateBaseEyeHeight();
+				}
+				else
+				{
+					Character->GetCapsuleComponent()->SetCapsuleSize(Character->GetCapsuleComponent()->GetUnscaledCapsuleRadius(), TargetHalfHeight);
+					MovementComponent->CurrentTransition = None;
+				}
+			}
+		}
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	static double StepTransitions(UWorld* World, const TArray<AFPSCharacterBase*>& Characters, int32 NumFrames, float FixedDeltaTime)
+	{
+		FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(World);
+		const int32 FramesPerToggle = 60;
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 i = 0; i < Characters.Num(); ++i)
+			{
+				if ((Frame + i) % FramesPerToggle == 0)
+				{
+					AFPSCharacterBase* Character = Characters[i];
+					Character->bIsCrouched = !Character->bIsCrouched;
+					Character->OnRep_IsCrouched();
+				}
+			}
+
+			TransitionManager->Tick(FixedDeltaTime);
+		}
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	/*Put every character back to standing so the next path starts from the same state*/
+	static void ResetCharacters(UWorld* World, const TArray<AFPSCharacterBase*>& Characters)
+	{
+		FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(World);
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			UFPSCharacterMovementComponent* MovementComponent = CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+			const FFPSMovementProfile& Profile = MovementComponent->GetMovementProfile();
+
+			TransitionManager->RemoveTransition(MovementComponent);
+			Character->bIsCrouched = false;
+			Character->GetCapsuleComponent()->SetCapsuleSize(Profile.CapsuleRadius, Profile.StandingHalfHeight);
+			MovementComponent->InternalCapsuleHeight = Profile.StandingHalfHeight;
+			MovementComponent->CurrentTransition = None;
+			MovementComponent->bCheckCrouch = false;
+			Character->BaseEyeHeight = Profile.DefaultEyeHeight;
+			Character->RecalculateBaseEyeHeight();
+		}
+	}
+
+	static bool RunProxies(UWorld* World, const FVector& ViewLocation, const FRotator& ViewRotation, IConsoleVariable* LODVariable, int32 NumProxies, int32 NumFrames, FResult& OutResult)
+	{
+		const float FixedDeltaTime = 1.f / 60.f;
+
+		const FVector Forward = ViewRotation.Vector();
+		const FVector Right = FRotationMatrix(ViewRotation).GetScaledAxis(EAxis::Y);
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		TArray<AFPSCharacterBase*> Characters;
+		for (int32 i = 0; i < NumProxies; ++i)
+		{
+			AFPSCharacterBase* Character = World->SpawnActor<AFPSCharacterBase>(AFPSCharacterBase::StaticClass(), ViewLocation, FRotator::ZeroRotator, SpawnParameters);
+			UFPSCharacterMovementComponent* MovementComponent = Character ? Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+			if (!MovementComponent)
+			{
+				continue;
+			}
+
+			/*Spread evenly from the camera to twice the snap distance, in rows so they don't overlap*/
+			const float Distance = 200.f + (MovementComponent->ProxyTransitionSnapDistance * 2.f) * i / NumProxies;
+			const float Side = ((i % 8) - 3.5f) * 100.f;
+			Character->SetActorLocation(ViewLocation + Forward * Distance + Right * Side);
+
+			MovementComponent->SetComponentTickEnabled(false);
+			Character->SetActorTickEnabled(false);
+			Character->Role = ROLE_SimulatedProxy;
+			Characters.Add(Character);
+		}
+
+		if (Characters.Num() == 0)
+		{
+			return false;
+		}
+
+		const int32 OldLOD = LODVariable->GetInt();
+
+		OutResult.NumProxies = Characters.Num();
+		OutResult.PerComponentSeconds = StepPerComponent(Characters, NumFrames, FixedDeltaTime);
+		ResetCharacters(World, Characters);
+
+		LODVariable->Set(0);
+		OutResult.FullRateSeconds = StepTransitions(World, Characters, NumFrames, FixedDeltaTime);
+		ResetCharacters(World, Characters);
+
+		LODVariable->Set(1);
+		OutResult.LODSeconds = StepTransitions(World, Characters, NumFrames, FixedDeltaTime);
+		ResetCharacters(World, Characters);
+
+		LODVariable->Set(OldLOD);
+
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			Character->Role = ROLE_Authority;
+			Character->Destroy();
+		}
+
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Proxies=%d Frames=%d PerComponentFrameMs=%.3f BatchedFrameMs=%.3f LODFrameMs=%.3f BatchedSaved=%.1f%% LODSaved=%.1f%%"),
+			OutResult.NumProxies, NumFrames, OutResult.PerComponentSeconds * 1000.0 / NumFrames, OutResult.FullRateSeconds * 1000.0 / NumFrames,
+			OutResult.LODSeconds * 1000.0 / NumFrames,
+			OutResult.PerComponentSeconds > 0.0 ? (1.0 - OutResult.FullRateSeconds / OutResult.PerComponentSeconds) * 100.0 : 0.0,
+			OutResult.PerComponentSeconds > 0.0 ? (1.0 - OutResult.LODSeconds / OutResult.PerComponentSeconds) * 100.0 : 0.0);
+		return true;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		IConsoleVariable* LODVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("fps.Movement.ProxyTransitionLOD"));
+		if (!World || World->GetNetMode() == NM_Client || !LODVariable)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.ProxyBenchmark has to run on the server or standalone"));
+			return;
+		}
+
+		const int32 NumFrames = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600);
+
+		FVector ViewLocation = FVector::ZeroVector;
+		FRotator ViewRotation = FRotator::ZeroRotator;
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+		{
+			ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+			ViewRotation.Yaw = PlayerController->PlayerCameraManager->GetCameraRotation().Yaw;
+		}
+
+		FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(World);
+		TransitionManager->SetViewOverride({ ViewLocation }, { ViewRotation.Vector() });
+
+		FResult Result;
+		TArray<FResult> Results;
+		if (Args.Num() > 0)
+		{
+			RunProxies(World, ViewLocation, ViewRotation, LODVariable, FMath::Max(1, FCString::Atoi(*Args[0])), NumFrames, Result);
+		}
+		else
+		{
+			for (int32 NumProxies : { 16, 128, 512 })
+			{
+				if (RunProxies(World, ViewLocation, ViewRotation, LODVariable, NumProxies, NumFrames, Result))
+				{
+					Results.Add(Result);
+				}
+			}
+		}
+
+		TransitionManager->SetViewOverride({}, {});
+
+		/*Cost per proxy of the largest run over the smallest, 1 is linear, below 1 is sub-linear*/
+		if (Results.Num() > 1)
+		{
+			const FResult& First = Results[0];
+			const FResult& Last = Results.Last();
+			auto GetGrowth = [&First, &Last](double FirstSeconds, double LastSeconds)
+			{
+				return (FirstSeconds > 0.0) ? (LastSeconds / Last.NumProxies) / (FirstSeconds / First.NumProxies) : 0.0;
+			};
+
+			UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Proxies=%d->%d CostPerProxyGrowth PerComponent=%.2f Batched=%.2f LOD=%.2f"),
+				First.NumProxies, Last.NumProxies, GetGrowth(First.PerComponentSeconds, Last.PerComponentSeconds),
+				GetGrowth(First.FullRateSeconds, Last.FullRateSeconds), GetGrowth(First.LODSeconds, Last.LODSeconds));
+		}
+	}
+}
+
+/**
+ * Prone movement benchmark, meant to be run on a -nullrhi dedicated server in a fixed test map like fps.Movement.Benchmark, e.g.
+ * -ExecCmds="fps.Movement.ProneBenchmark 100 600"
+ * Steps the characters walking in circles, then has them go prone and steps the same input again once they are down.
+ * The prone frames should cost about the same as the walking ones, PhysProne is PhysWalking with the prone capsule.
+ */
+namespace FPSMovementProneBenchmark
+{
+	static double StepCharacters(const TArray<AFPSCharacterBase*>& Characters, int32 FirstFrame, int32 NumFrames, float FixedDeltaTime)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = FirstFrame; Frame < FirstFrame + NumFrames; ++Frame)
+		{
+			for (int32 i = 0; i < Characters.Num(); ++i)
+			{
+				AFPSCharacterBase* Character = Characters[i];
+				const FRotator ControlRotation(0.f, (Frame + i * 7) * 2.f, 0.f);
+				if (Character->Controller)
+				{
+					Character->Controller->SetControlRotation(ControlRotation);
+				}
+				Character->AddMovementInput(ControlRotation.Vector(), 1.f);
+
+				UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+				MovementComponent->TickComponent(FixedDeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+		}
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.ProneBenchmark has to run on the server or standalone"));
+			return;
+		}
+
+		const int32 NumCharacters = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100);
+		const int32 NumFrames = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600);
+		const float FixedDeltaTime = 1.f / 60.f;
+
+		const TArray<AFPSCharacterBase*> Characters = FPSMovementBenchmark::SpawnBenchmarkCharacters(World, AFPSCharacterBase::StaticClass(), NumCharacters);
+		float ProneTime = 0.f;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			const UFPSCharacterMovementComponent* MovementComponent = CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement());
+			ProneTime = FMath::Max(ProneTime, MovementComponent->CrouchTime + MovementComponent->ProneTime);
+		}
+
+		/*Land first so both runs start on the ground*/
+		const int32 SettleFrames = FMath::CeilToInt(1.f / FixedDeltaTime);
+		StepCharacters(Characters, 0, SettleFrames, FixedDeltaTime);
+		const double WalkSeconds = StepCharacters(Characters, 0, NumFrames, FixedDeltaTime);
+
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			Character->ToggleProne();
+		}
+		StepCharacters(Characters, 0, FMath::CeilToInt((ProneTime + 1.f) / FixedDeltaTime), FixedDeltaTime);
+		const double ProneSeconds = StepCharacters(Characters, 0, NumFrames, FixedDeltaTime);
+
+		int32 NumProne = 0;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			NumProne += CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement())->IsProne() ? 1 : 0;
+		}
+		FPSMovementBenchmark::DestroyBenchmarkCharacters(Characters);
+
+		/*A character that isn't prone at the end fell off or got stuck and measured walking or falling instead*/
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Characters=%d Frames=%d Prone=%d WalkFrameMs=%.3f ProneFrameMs=%.3f Ratio=%.2f"),
+			Characters.Num(), NumFrames, NumProne, WalkSeconds * 1000.0 / NumFrames, ProneSeconds * 1000.0 / NumFrames,
+			WalkSeconds > 0.0 ? ProneSeconds / WalkSeconds : 0.0);
+	}
+}
+
+/**
+ * Ledge probe benchmark, meant to be run on a -nullrhi dedicated server in a fixed test map like fps.Movement.Benchmark, e.g.
+ * -ExecCmds="fps.Movement.VaultBenchmark 64 600"
+ * Puts a waist high wall in front of each character and has them walk into it, which is when the ledge probes run.
+ * Reports the probe queries per second of simulated time for all the characters, then has them jump and counts the vaults.
+ */
+namespace FPSMovementVaultBenchmark
+{
+	static void StepCharacters(const TArray<AFPSCharacterBase*>& Characters, int32 NumFrames, float FixedDeltaTime)
+	{
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (AFPSCharacterBase* Character : Characters)
+			{
+				Character->AddMovementInput(FVector::ForwardVector, 1.f);
+
+				UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+				MovementComponent->TickComponent(FixedDeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+		}
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		UStaticMesh* WallMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		if (!World || World->GetNetMode() == NM_Client || !WallMesh)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.VaultBenchmark has to run on the server or standalone"));
+			return;
+		}
+
+		const int32 NumCharacters = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64);
+		const int32 NumFrames = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600);
+		const float FixedDeltaTime = 1.f / 60.f;
+
+		/*The controllers face forward for the forward test*/
+		const TArray<AFPSCharacterBase*> Characters = FPSMovementBenchmark::SpawnBenchmarkCharacters(World, AFPSCharacterBase::StaticClass(), NumCharacters);
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			if (Character->Controller)
+			{
+				Character->Controller->SetControlRotation(FRotator::ZeroRotator);
+			}
+		}
+
+		/*Land before the walls go in, the cube is 100 units, scaled to a 50 unit thick wall of 80 from the floor*/
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+			for (int32 Frame = 0; Frame < 60; ++Frame)
+			{
+				MovementComponent->TickComponent(FixedDeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+		}
+
+		const float WallHeight = 80.f;
+		TArray<AActor*> Walls;
+		TArray<float> StartHeights;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			const FVector Feet = Character->GetActorLocation() - FVector(0.f, 0.f, Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+			AStaticMeshActor* Wall = World->SpawnActor<AStaticMeshActor>(Feet + FVector(150.f, 0.f, WallHeight * 0.5f), FRotator::ZeroRotator);
+			if (Wall)
+			{
+				Wall->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+				Wall->GetStaticMeshComponent()->SetStaticMesh(WallMesh);
+				Wall->SetActorScale3D(FVector(0.5f, 2.f, WallHeight / 100.f));
+				Walls.Add(Wall);
+			}
+			StartHeights.Add(Character->GetActorLocation().Z);
+			CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement())->NumLedgeQueries = 0;
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		StepCharacters(Characters, NumFrames, FixedDeltaTime);
+		const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+		int64 NumQueries = 0;
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			NumQueries += CastChecked<UFPSCharacterMovementComponent>(Character->GetCharacterMovement())->NumLedgeQueries;
+			Character->Jump();
+		}
+
+		StepCharacters(Characters, FMath::CeilToInt(1.f / FixedDeltaTime), FixedDeltaTime);
+
+		int32 NumVaulted = 0;
+		for (int32 i = 0; i < Characters.Num(); ++i)
+		{
+			AFPSCharacterBase* Character = Characters[i];
+			NumVaulted += (Character->GetActorLocation().Z > StartHeights[i] + WallHeight * 0.5f) ? 1 : 0;
+		}
+		FPSMovementBenchmark::DestroyBenchmarkCharacters(Characters);
+
+		for (AActor* Wall : Walls)
+		{
+			Wall->Destroy();
+		}
+
+		const double SimulatedSeconds = NumFrames * FixedDeltaTime;
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Characters=%d Frames=%d FrameMs=%.3f LedgeQueries=%lld QueriesPerSecond=%.1f Vaulted=%d"),
+			Characters.Num(), NumFrames, ElapsedSeconds * 1000.0 / NumFrames, NumQueries, NumQueries / SimulatedSeconds, NumVaulted);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs MovementBenchmarkCommand(
+	TEXT("fps.Movement.Benchmark"),
+	TEXT("Step scripted characters at a fixed time step and report the cost. Arguments: NumCharacters NumFrames Seed"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementBenchmark::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs MovementCoverBenchmarkCommand(
+	TEXT("fps.Movement.CoverBenchmark"),
+	TEXT("Step crouched characters trying to stand under ceilings with and without bAsyncUnCrouchCheck and report the cost. Arguments: NumCharacters NumFrames"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementCoverBenchmark::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs MovementProneBenchmarkCommand(
+	TEXT("fps.Movement.ProneBenchmark"),
+	TEXT("Step characters walking and then prone with the same input and report the cost of both. Arguments: NumCharacters NumFrames"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementProneBenchmark::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs MovementVaultBenchmarkCommand(
+	TEXT("fps.Movement.VaultBenchmark"),
+	TEXT("Walk characters into walls, report the ledge probe queries per second and count the vaults after a jump. Arguments: NumCharacters NumFrames"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementVaultBenchmark::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs MovementProxyBenchmarkCommand(
+	TEXT("fps.Movement.ProxyBenchmark"),
+	TEXT("Step crouching simulated proxies one component at a time, batched and with fps.Movement.ProxyTransitionLOD and report the cost. Arguments: NumProxies (16 to 512 if empty) NumFrames"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementProxyBenchmark::Run));
+
+/**
+ * Movement profile benchmark, reads the capsule and eye height metrics of a spawned character the way Crouch/UnCrouch did
+ * through the class default object and through the cached FFPSMovementProfile and reports lookups per second, e.g.
+ * fps.Movement.ProfileBenchmark 1000000
+ * Both read the same values, the sums of the two loops have to match.
+ */
+namespace FPSMovementProfileBenchmark
+{
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.ProfileBenchmark needs a world"));
+			return;
+		}
+
+		const int32 NumLookups = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000);
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AFPSCharacterBase* Character = World->SpawnActor<AFPSCharacterBase>(AFPSCharacterBase::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters);
+		UFPSCharacterMovementComponent* MovementComponent = Character ? Cast<UFPSCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+		if (!MovementComponent)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("Unable to spawn a character"));
+			return;
+		}
+
+		MovementComponent->SetComponentTickEnabled(false);
+		Character->SetActorTickEnabled(false);
+
+		/*The height walks through the crouch range so the alpha isn't the same every lookup*/
+		const float CrouchedHalfHeight = MovementComponent->CrouchedHalfHeight;
+		const float HeightStep = (MovementComponent->GetMovementProfile().StandingHalfHeight - CrouchedHalfHeight) / 1023.f;
+
+		double DefaultSum = 0.0;
+		const double DefaultStart = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLookups; ++i)
+		{
+			const ACharacter* DefaultCharacter = Character->GetClass()->GetDefaultObject<ACharacter>();
+			const float StandingHalfHeight = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
+			const float Radius = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleRadius();
+			const float MeshZ = DefaultCharacter->GetMesh() ? DefaultCharacter->GetMesh()->RelativeLocation.Z : 0.f;
+			const float InterpSpeed = (StandingHalfHeight - MovementComponent->CrouchedHalfHeight) / MovementComponent->CrouchTime;
+			const float Height = CrouchedHalfHeight + (i & 1023) * HeightStep;
+			const float NormalisedAlpha = (StandingHalfHeight - Height) / (StandingHalfHeight - MovementComponent->CrouchedHalfHeight);
+			DefaultSum += InterpSpeed + Radius + MeshZ + NormalisedAlpha;
+		}
+		const double DefaultSeconds = FPlatformTime::Seconds() - DefaultStart;
+
+		double ProfileSum = 0.0;
+		const double ProfileStart = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLookups; ++i)
+		{
+			const FFPSMovementProfile& Profile = MovementComponent->GetMovementProfile();
+			const float Height = CrouchedHalfHeight + (i & 1023) * HeightStep;
+			const float NormalisedAlpha = (Profile.StandingHalfHeight - Height) * Profile.InvCrouchHeightRange;
+			ProfileSum += Profile.CrouchInterpSpeed + Profile.CapsuleRadius + Profile.DefaultMeshZ + NormalisedAlpha;
+		}
+		const double ProfileSeconds = FPlatformTime::Seconds() - ProfileStart;
+
+		Character->Destroy();
+
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Lookups=%d DefaultObjectLookupsPerSecond=%.0f ProfileLookupsPerSecond=%.0f Speedup=%.2f SumDifference=%.4f"),
+			NumLookups, NumLookups / FMath::Max(DefaultSeconds, SMALL_NUMBER), NumLookups / FMath::Max(ProfileSeconds, SMALL_NUMBER),
+			DefaultSeconds / FMath::Max(ProfileSeconds, SMALL_NUMBER), FMath::Abs(DefaultSum - ProfileSum));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs MovementProfileBenchmarkCommand(
+	TEXT("fps.Movement.ProfileBenchmark"),
+	TEXT("Read the crouch metrics of a character through the class default object and through the movement profile and report lookups per second. Arguments: NumLookups"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSMovementProfileBenchmark::Run));
+
+/**
+ * Sprint curve benchmark, evaluates the SprintAccelerationCurve of the default movement component at random speed ratios
+ * through UCurveFloat::GetFloatValue, the baked lookup table and the polynomial fit and reports evaluations per second, e.g.
+ * fps.Movement.SprintCurveBenchmark 1000000
+ * The ratios go a little past 1 like a sprinting character on a slope, those are passed through to the curve by every mode.
+ */
+namespace FPSSprintCurveBenchmark
+{
+	static double TimeEvaluations(const TArray<float>& Ratios, TFunctionRef<float(float)> Evaluate, double& OutSum)
+	{
+		OutSum = 0.0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (float Ratio : Ratios)
+		{
+			OutSum += Evaluate(Ratio);
+		}
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const UFPSCharacterMovementComponent* DefaultMovement = GetDefault<UFPSCharacterMovementComponent>();
+		const UCurveFloat* Curve = DefaultMovement->SprintAccelerationCurve;
+		if (!Curve)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("The default movement component has no SprintAccelerationCurve"));
+			return;
+		}
+
+		const int32 NumEvaluations = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000);
+		const int32 Seed = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0;
+
+		TArray<float> Ratios;
+		Ratios.SetNumUninitialized(NumEvaluations);
+		FRandomStream Stream(Seed);
+		for (float& Ratio : Ratios)
+		{
+			Ratio = Stream.FRandRange(0.f, 1.05f);
+		}
+
+		FFPSCurveSampler TableSampler;
+		FFPSCurveSampler PolynomialSampler;
+		const EFPSCurveSampleMode TableMode = TableSampler.Bake(Curve, EFPSCurveSampleMode::LookupTable, DefaultMovement->SprintCurveMaxError);
+		const EFPSCurveSampleMode PolynomialMode = PolynomialSampler.Bake(Curve, EFPSCurveSampleMode::Polynomial, DefaultMovement->SprintCurveMaxError);
+		if (TableMode == EFPSCurveSampleMode::Curve)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("%s can't be baked within SprintCurveMaxError %f"), *Curve->GetName(), DefaultMovement->SprintCurveMaxError);
+			return;
+		}
+
+		double CurveSum, TableSum, PolynomialSum;
+		const double CurveSeconds = TimeEvaluations(Ratios, [Curve](float Ratio) { return Curve->GetFloatValue(Ratio); }, CurveSum);
+		const double TableSeconds = TimeEvaluations(Ratios, [&TableSampler](float Ratio) { return TableSampler.Evaluate(Ratio); }, TableSum);
+		const double PolynomialSeconds = TimeEvaluations(Ratios, [&PolynomialSampler](float Ratio) { return PolynomialSampler.Evaluate(Ratio); }, PolynomialSum);
+
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Evaluations=%d CurvePerSecond=%.0f TablePerSecond=%.0f TableError=%f PolynomialPerSecond=%.0f PolynomialError=%f%s"),
+			NumEvaluations, NumEvaluations / FMath::Max(CurveSeconds, SMALL_NUMBER),
+			NumEvaluations / FMath::Max(TableSeconds, SMALL_NUMBER), TableSampler.GetMaxError(),
+			NumEvaluations / FMath::Max(PolynomialSeconds, SMALL_NUMBER), PolynomialSampler.GetMaxError(),
+			PolynomialMode == EFPSCurveSampleMode::Polynomial ? TEXT("") : TEXT(" (polynomial over the bound, baked as the table)"));
+	}
+}
+
+static FAutoConsoleCommand SprintCurveBenchmarkCommand(
+	TEXT("fps.Movement.SprintCurveBenchmark"),
+	TEXT("Evaluate the sprint acceleration curve directly, as the baked table and as the polynomial fit and report evaluations per second. Arguments: NumEvaluations Seed"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPSSprintCurveBenchmark::Run));
+
+/**
+ * Sprint forward test benchmark, times FPSSprintKernel against the old FRotator and GetSafeNormal2D test, e.g.
+ * fps.Movement.SprintKernelBenchmark 10000 100
+ * FPS.Movement.Sprint.ForwardKernel checks that the results match.
+ */
+namespace FPSSprintKernelBenchmark
+{
+	static bool OldIsMovingForward(float Yaw, const FVector& Acceleration)
+	{
+		const FRotator ControlRotationForward = FRotator(0.0f, Yaw, 0.0f);
+		const float DirectionDot = FVector::DotProduct(ControlRotationForward.Vector().GetSafeNormal2D(), Acceleration.GetSafeNormal2D());
+		return (DirectionDot < 0.7071f) ? false : true;
+	}
+
+	static void RunEntries(int32 NumEntries, int32 NumIterations, int32 Seed)
+	{
+		using namespace FPSSprintKernel;
+
+		TArray<float> Yaws, AccelX, AccelY;
+		TArray<uint8> Flags, OldResults, SingleResults, BatchResults;
+		Yaws.SetNumUninitialized(NumEntries);
+		AccelX.SetNumUninitialized(NumEntries);
+		AccelY.SetNumUninitialized(NumEntries);
+		Flags.SetNumUninitialized(NumEntries);
+		OldResults.SetNumZeroed(NumEntries);
+		SingleResults.SetNumZeroed(NumEntries);
+		BatchResults.SetNumZeroed(NumEntries);
+
+		/*Some zero and some exactly 45 degree accelerations so the edges get tested too*/
+		FRandomStream Stream(Seed);
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			Yaws[i] = Stream.FRandRange(-720.f, 720.f);
+			const float AccelYaw = (i % 16 == 0) ? Yaws[i] + 45.f : Stream.FRandRange(-180.f, 180.f);
+			const float AccelSize = (i % 32 == 1) ? 0.f : Stream.FRandRange(0.f, 2048.f);
+			AccelX[i] = FMath::Cos(FMath::DegreesToRadians(AccelYaw)) * AccelSize;
+			AccelY[i] = FMath::Sin(FMath::DegreesToRadians(AccelYaw)) * AccelSize;
+			Flags[i] = (uint8)Stream.RandRange(0, 7);
+		}
+
+		const double OldStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				OldResults[i] = (IsSprintState(Flags[i]) && OldIsMovingForward(Yaws[i], FVector(AccelX[i], AccelY[i], 0.f))) ? 1 : 0;
+			}
+		}
+		const double OldSeconds = FPlatformTime::Seconds() - OldStart;
+
+		const double SingleStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				SingleResults[i] = (IsSprintState(Flags[i]) && IsInForwardCone(Yaws[i], AccelX[i], AccelY[i])) ? 1 : 0;
+			}
+		}
+		const double SingleSeconds = FPlatformTime::Seconds() - SingleStart;
+
+		const double BatchStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			EvaluateBatch(Yaws.GetData(), AccelX.GetData(), AccelY.GetData(), Flags.GetData(), BatchResults.GetData(), NumEntries);
+		}
+		const double BatchSeconds = FPlatformTime::Seconds() - BatchStart;
+
+		const double EntriesPerIteration = (double)NumEntries * NumIterations;
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Entries=%d Iterations=%d OldNs=%.2f SingleNs=%.2f BatchNs=%.2f"),
+			NumEntries, NumIterations, OldSeconds * 1e9 / EntriesPerIteration, SingleSeconds * 1e9 / EntriesPerIteration, BatchSeconds * 1e9 / EntriesPerIteration);
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 NumIterations = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100);
+		const int32 Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 0;
+
+		if (Args.Num() > 0)
+		{
+			RunEntries(FMath::Max(1, FCString::Atoi(*Args[0])), NumIterations, Seed);
+			return;
+		}
+
+		for (int32 NumEntries : { 1000, 2500, 5000, 10000 })
+		{
+			RunEntries(NumEntries, NumIterations, Seed);
+		}
+	}
+}
+
+static FAutoConsoleCommand SprintKernelBenchmarkCommand(
+	TEXT("fps.Movement.SprintKernelBenchmark"),
+	TEXT("Time the sprint forward test batch against the single and old versions. Arguments: NumEntries (1k to 10k if empty) NumIterations Seed"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPSSprintKernelBenchmark::Run));
+
+/**
+ * Movement state table benchmark, times FPSMovementStateTable against the if chains it replaced on random keys, e.g.
+ * fps.Movement.StateTableBenchmark 10000 100
+ * FPS.Movement.StateTable.MatchesIfChains checks every key gives the same action.
+ */
+namespace FPSMovementStateTableBenchmark
+{
+	using namespace FPSMovementStateTable;
+
+	/*UpdateCharacterStateBeforeMovement before the tables, with the state read from the key*/
+	static EStanceAction OldStanceAction(uint32 Key)
+	{
+		const bool bWantsProne = (Key & Stance_WantsProne) != 0;
+		const bool bIsProne = (Key & Stance_IsProne) != 0;
+		const bool bInProneMode = (Key & Stance_InProneMode) != 0;
+		const bool bTransitioning = (Key & Stance_Transitioning) != 0;
+		const bool bCanCrouch = (Key & Stance_CanCrouch) != 0;
+		const bool bWantsCrouch = (Key & Stance_WantsCrouch) != 0;
+		const bool bIsCrouching = (Key & Stance_IsCrouching) != 0;
+		const bool bWantsSprint = (Key & Stance_WantsSprint) != 0;
+
+		if (bWantsProne)
+		{
+			if (!(bIsProne && !bTransitioning))
+			{
+				return EStanceAction::Prone;
+			}
+			else if (!bInProneMode)
+			{
+				return EStanceAction::EnterProneMode;
+			}
+		}
+		else if (bIsProne)
+		{
+			return EStanceAction::UnProne;
+		}
+		else if (bCanCrouch && bWantsCrouch && !(bIsCrouching && !bTransitioning))
+		{
+			return EStanceAction::Crouch;
+		}
+		else if (!bCanCrouch || bWantsSprint || (!bWantsCrouch && (bIsCrouching || bTransitioning)))
+		{
+			return EStanceAction::UnCrouch;
+		}
+
+		return EStanceAction::None;
+	}
+
+	static ESprintAction OldSprintAction(uint32 Key)
+	{
+		const bool bIsSprinting = (Key & Sprint_IsSprinting) != 0;
+		const bool bWantsSprint = (Key & Sprint_WantsSprint) != 0;
+		const bool bOnGround = (Key & Sprint_OnGround) != 0;
+		const bool bMovingForward = (Key & Sprint_MovingForward) != 0;
+		const bool bCanSprint = (Key & Sprint_CanSprint) != 0;
+		const bool bWantsLowStance = (Key & Sprint_WantsLowStance) != 0;
+		const bool bIdleStance = (Key & Sprint_IdleStance) != 0;
+
+		if (bIsSprinting && (!bWantsSprint || !bOnGround || !bMovingForward || !bCanSprint || bWantsLowStance))
+		{
+			return bWantsLowStance ? ESprintAction::StopAndClearWants : ESprintAction::Stop;
+		}
+		else if (bMovingForward && bWantsSprint && bOnGround && bCanSprint)
+		{
+			return bIdleStance ? ESprintAction::ClearLowStanceAndStart : ESprintAction::ClearLowStance;
+		}
+
+		return ESprintAction::None;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 NumEntries = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000);
+		const int32 NumIterations = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100);
+		const int32 Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 0;
+
+		/*Random keys so the branches of the chains can't be predicted, like a server full of characters in different states*/
+		TArray<uint8> StanceKeys, SprintKeys;
+		StanceKeys.SetNumUninitialized(NumEntries);
+		SprintKeys.SetNumUninitialized(NumEntries);
+		FRandomStream Stream(Seed);
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			StanceKeys[i] = (uint8)Stream.RandRange(0, NumStanceKeys - 1);
+			SprintKeys[i] = (uint8)Stream.RandRange(0, NumSprintKeys - 1);
+		}
+
+		/*The actions are summed so the loops aren't optimized out*/
+		uint32 OldSum = 0;
+		const double OldStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				OldSum += (uint32)OldSprintAction(SprintKeys[i]) + (uint32)OldStanceAction(StanceKeys[i]);
+			}
+		}
+		const double OldSeconds = FPlatformTime::Seconds() - OldStart;
+
+		uint32 TableSum = 0;
+		const double TableStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				TableSum += (uint32)GetSprintAction(SprintKeys[i]) + (uint32)GetStanceAction(StanceKeys[i]);
+			}
+		}
+		const double TableSeconds = FPlatformTime::Seconds() - TableStart;
+
+		const double EntriesPerIteration = (double)NumEntries * NumIterations;
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Entries=%d Iterations=%d OldNs=%.2f TableNs=%.2f Sums=%u/%u"),
+			NumEntries, NumIterations, OldSeconds * 1e9 / EntriesPerIteration, TableSeconds * 1e9 / EntriesPerIteration, OldSum, TableSum);
+	}
+}
+
+static FAutoConsoleCommand StateTableBenchmarkCommand(
+	TEXT("fps.Movement.StateTableBenchmark"),
+	TEXT("Time the movement state tables against the if chains on random keys. Arguments: NumEntries NumIterations Seed"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPSMovementStateTableBenchmark::Run));
+
+/**
+ * Crouch kernel benchmark, runs whole crouch and stand transitions of the default character with FPSCrouchKernel::Step
+ * one character at a time and with StepBatch over packed arrays, checks they end in the same place and reports transitions per second, e.g.
+ * fps.Movement.CrouchKernelBenchmark 10000 20
+ * Every transition gets its own frame rate between 30 and 120 fps so they don't all finish on the same frame.
+ */
+namespace FPSCrouchKernelBenchmark
+{
+	static void RunEntries(int32 NumEntries, int32 NumIterations, int32 Seed)
+	{
+		using namespace FPSCrouchKernel;
+
+		const FStanceMetrics& Metrics = FFPSMovementProfile::Get(AFPSCharacterBase::StaticClass())->StanceMetrics;
+		const float HeightRange = Metrics.StandingHalfHeight - Metrics.CrouchedHalfHeight;
+		if (Metrics.CrouchInterpSpeed <= 0.f || HeightRange <= 0.f)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("The default character has no crouch transition, CrouchTime or CrouchedHalfHeight is 0"));
+			return;
+		}
+
+		static const float MinDeltaTime = 1.f / 120.f;
+		static const float MaxDeltaTime = 1.f / 30.f;
+		const int32 NumFrames = FMath::CeilToInt(HeightRange / (Metrics.CrouchInterpSpeed * MinDeltaTime)) + 1;
+
+		TArray<float> StartHeights, TargetHeights, DeltaTimes;
+		StartHeights.SetNumUninitialized(NumEntries);
+		TargetHeights.SetNumUninitialized(NumEntries);
+		DeltaTimes.SetNumUninitialized(NumEntries);
+
+		/*Half crouching and half standing up, some starting part of the way there like an interrupted transition*/
+		FRandomStream Stream(Seed);
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			const bool bCrouch = (i & 1) == 0;
+			const float From = bCrouch ? Metrics.StandingHalfHeight : Metrics.CrouchedHalfHeight;
+			TargetHeights[i] = bCrouch ? Metrics.CrouchedHalfHeight : Metrics.StandingHalfHeight;
+			StartHeights[i] = (i % 4 < 2) ? From : FMath::Lerp(From, TargetHeights[i], Stream.FRand());
+			DeltaTimes[i] = Stream.FRandRange(MinDeltaTime, MaxDeltaTime);
+		}
+
+		TArray<FStanceState> States;
+		States.SetNumUninitialized(NumEntries);
+
+		const double ScalarStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				States[i].HalfHeight = StartHeights[i];
+			}
+
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				for (int32 i = 0; i < NumEntries; ++i)
+				{
+					Step(Metrics, States[i], TargetHeights[i], DeltaTimes[i]);
+				}
+			}
+		}
+		const double ScalarSeconds = FPlatformTime::Seconds() - ScalarStart;
+
+		/*The per character values of the batch all come from the same class here, the transition manager mixes classes*/
+		TArray<float> Heights, EyeHeights, MinHeights, InterpSpeeds, CrouchedHalfHeights, CrouchedEyeHeights, EyeHeightSlopes;
+		Heights.SetNumUninitialized(NumEntries);
+		EyeHeights.SetNumUninitialized(NumEntries);
+		MinHeights.Init(Metrics.MinHalfHeight, NumEntries);
+		InterpSpeeds.Init(Metrics.CrouchInterpSpeed, NumEntries);
+		CrouchedHalfHeights.Init(Metrics.CrouchedHalfHeight, NumEntries);
+		CrouchedEyeHeights.Init(Metrics.CrouchedEyeHeight, NumEntries);
+		EyeHeightSlopes.Init(Metrics.EyeHeightSlope, NumEntries);
+
+		FTransitionBatch Batch;
+		Batch.Heights = Heights.GetData();
+		Batch.EyeHeights = EyeHeights.GetData();
+		Batch.TargetHeights = TargetHeights.GetData();
+		Batch.MinHeights = MinHeights.GetData();
+		Batch.InterpSpeeds = InterpSpeeds.GetData();
+		Batch.CrouchedHalfHeights = CrouchedHalfHeights.GetData();
+		Batch.CrouchedEyeHeights = CrouchedEyeHeights.GetData();
+		Batch.EyeHeightSlopes = EyeHeightSlopes.GetData();
+		Batch.DeltaTimes = DeltaTimes.GetData();
+		Batch.Count = NumEntries;
+
+		const double BatchStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			FMemory::Memcpy(Heights.GetData(), StartHeights.GetData(), NumEntries * sizeof(float));
+
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				StepBatch(Batch);
+			}
+		}
+		const double BatchSeconds = FPlatformTime::Seconds() - BatchStart;
+
+		int32 Mismatches = 0;
+		int32 NumUnfinished = 0;
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			Mismatches += (!FMath::IsNearlyEqual(States[i].HalfHeight, Heights[i]) || !FMath::IsNearlyEqual(States[i].EyeHeight, EyeHeights[i])) ? 1 : 0;
+			NumUnfinished += (States[i].HalfHeight != TargetHeights[i]) ? 1 : 0;
+		}
+
+		const double NumTransitions = (double)NumEntries * NumIterations;
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Entries=%d Iterations=%d Frames=%d ScalarTransitionsPerSecond=%.0f BatchTransitionsPerSecond=%.0f Speedup=%.2f Mismatches=%d Unfinished=%d"),
+			NumEntries, NumIterations, NumFrames, NumTransitions / FMath::Max(ScalarSeconds, SMALL_NUMBER), NumTransitions / FMath::Max(BatchSeconds, SMALL_NUMBER),
+			ScalarSeconds / FMath::Max(BatchSeconds, SMALL_NUMBER), Mismatches, NumUnfinished);
+
+		if (Mismatches > 0 || NumUnfinished > 0)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Error, TEXT("FPSCrouchKernel::StepBatch doesn't match FPSCrouchKernel::Step"));
+		}
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 NumIterations = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 20);
+		const int32 Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 0;
+
+		if (Args.Num() > 0)
+		{
+			RunEntries(FMath::Max(1, FCString::Atoi(*Args[0])), NumIterations, Seed);
+			return;
+		}
+
+		for (int32 NumEntries : { 100, 1000, 10000 })
+		{
+			RunEntries(NumEntries, NumIterations, Seed);
+		}
+	}
+}
+
+static FAutoConsoleCommand CrouchKernelBenchmarkCommand(
+	TEXT("fps.Movement.CrouchKernelBenchmark"),
+	TEXT("Run crouch transitions with the scalar and batched crouch kernel, check they match and report transitions per second. Arguments: NumEntries (100 to 10k if empty) NumIterations Seed"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FPSCrouchKernelBenchmark::Run));
+
+/**
+ * Net update report, meant to be run on a server with the bots and clients connected, e.g.
+ * fps.Movement.NetUpdateReport 10
+ * Counts what the net driver sends over the next Seconds, the bytes and packets and the share of each connection, and how much of the time
+ * the characters spend at each EFPSNetUpdateRate. Run it once with fps.Movement.AdaptiveNetUpdate 0 and once with 1 for what the adaptive rate saves,
+ * the replication time is in "stat net".
+ */
+namespace FPSNetUpdateReport
+{
+	/*The totals of the net driver when the report started and the rates of the characters added up every frame since*/
+	struct FReport
+	{
+		TWeakObjectPtr<UWorld> World;
+		double StartTime;
+		float Seconds;
+
+		/*0 to leave the crouch to the player*/
+		float CrouchToggleInterval;
+		double NextCrouchToggleTime;
+		uint32 StartOutBytes;
+		uint32 StartOutPackets;
+		int64 NumFrames;
+		int64 NumCharacterFrames;
+		int64 NumRateFrames[3];
+	};
+
+	static bool Tick(float DeltaTime, TSharedRef<FReport> Report)
+	{
+		UWorld* World = Report->World.Get();
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.NetUpdateReport stopped, the world or its net driver went away"));
+			return false;
+		}
+
+		++Report->NumFrames;
+		for (TActorIterator<AFPSCharacterBase> It(World); It; ++It)
+		{
+			if (const UFPSCharacterMovementComponent* MovementComponent = It->GetFPSMovementComponent())
+			{
+				++Report->NumCharacterFrames;
+				++Report->NumRateFrames[(int32)MovementComponent->GetNetUpdateRate()];
+			}
+		}
+
+		const double ElapsedSeconds = FPlatformTime::Seconds() - Report->StartTime;
+		if (ElapsedSeconds < Report->Seconds)
+		{
+			if (Report->CrouchToggleInterval > 0.f && ElapsedSeconds >= Report->NextCrouchToggleTime)
+			{
+				Report->NextCrouchToggleTime += Report->CrouchToggleInterval;
+				for (const FCharacterCounters& Character : Report->Characters)
+				{
+					UFPSCharacterMovementComponent* MovementComponent = Character.MovementComponent.Get();
+					if (MovementComponent && MovementComponent->GetFPSOwner())
+					{
+						MovementComponent->GetFPSOwner()->ToggleCrouch();
+					}
+				}
+			}
+			return true;
+		}
+
+		/*The totals are never reset, unlike OutBytes which the net driver clears every second*/
+		const uint32 OutBytes = NetDriver->OutTotalBytes - Report->StartOutBytes;
+		const uint32 OutPackets = NetDriver->OutTotalPackets - Report->StartOutPackets;
+		const int32 NumConnections = NetDriver->ClientConnections.Num();
+		const double CharacterFrames = FMath::Max<int64>(1, Report->NumCharacterFrames);
+		const double AverageCharacters = Report->NumCharacterFrames / (double)FMath::Max<int64>(1, Report->NumFrames);
+
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Seconds=%.1f Characters=%.0f Idle=%.1f%% Default=%.1f%% Active=%.1f%% Connections=%d OutBytes=%u OutPackets=%u OutBytesPerSecond=%.0f OutPacketsPerSecond=%.0f OutBytesPerConnectionPerSecond=%.0f"),
+			ElapsedSeconds, AverageCharacters, Report->NumRateFrames[(int32)EFPSNetUpdateRate::Idle] * 100.0 / CharacterFrames,
+			Report->NumRateFrames[(int32)EFPSNetUpdateRate::Default] * 100.0 / CharacterFrames, Report->NumRateFrames[(int32)EFPSNetUpdateRate::Active] * 100.0 / CharacterFrames,
+			NumConnections, OutBytes, OutPackets, OutBytes / ElapsedSeconds, OutPackets / ElapsedSeconds, OutBytes / (ElapsedSeconds * FMath::Max(1, NumConnections)));
+		return false;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver || !NetDriver->IsServer())
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.NetUpdateReport has to run on a server"));
+			return;
+		}
+
+		TSharedRef<FReport> Report = MakeShared<FReport>();
+		Report->World = World;
+		Report->StartTime = FPlatformTime::Seconds();
+		Report->Seconds = FMath::Max(1.f, Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.f);
+		const float CrouchTogglesPerSecond = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.f;
+		Report->CrouchToggleInterval = CrouchTogglesPerSecond > 0.f ? 1.f / CrouchTogglesPerSecond : 0.f;
+		Report->NextCrouchToggleTime = 0.0;
+		Report->StartOutBytes = NetDriver->OutTotalBytes;
+		Report->StartOutPackets = NetDriver->OutTotalPackets;
+		Report->NumFrames = 0;
+		Report->NumCharacterFrames = 0;
+		Report->NumRateFrames[0] = Report->NumRateFrames[1] = Report->NumRateFrames[2] = 0;
+
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick, Report));
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("fps.Movement.NetUpdateReport counting for %.1f seconds"), Report->Seconds);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs NetUpdateReportCommand(
+	TEXT("fps.Movement.NetUpdateReport"),
+	TEXT("Count the bytes and packets the server sends and the net update rates of the characters over a number of seconds. Arguments: Seconds (10 if empty)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSNetUpdateReport::Run));
+
+/**
+ * Input edge report, meant to be run on a client while playing, e.g.
+ * fps.Movement.InputEdgeReport 30 8
+ * Counts what the net driver of the client sends over the next Seconds, the bytes and packets, and the ServerMove RPCs, input edges and
+ * corrections of its own characters, see FFPSInputEdgeCounters. Lost input is the edges dropped past FPSInputEdge::MaxEdges between two moves.
+ * With CrouchTogglesPerSecond the crouch of the characters is toggled that often during the report, crouch spam while the player moves,
+ * which is when the move data and its input edges are the largest. Run it once with fps.Movement.InputEdges 0 and once with 1 for what the edges
+ * cost and save in bytes per ServerMove and corrections, the bits of the move data are in "stat FPSMovement".
+ */
+namespace FPSInputEdgeReport
+{
+	struct FCharacterCounters
+	{
+		TWeakObjectPtr<UFPSCharacterMovementComponent> MovementComponent;
+		FFPSInputEdgeCounters StartCounters;
+	};
+
+	/*The totals of the net driver and the counters of the characters of the client when the report started*/
+	struct FReport
+	{
+		TWeakObjectPtr<UWorld> World;
+		double StartTime;
+		float Seconds;
+
+		/*0 to leave the crouch to the player*/
+		float CrouchToggleInterval;
+		double NextCrouchToggleTime;
+		uint32 StartOutBytes;
+		uint32 StartOutPackets;
+		TArray<FCharacterCounters> Characters;
+	};
+
+	static bool Tick(float DeltaTime, TSharedRef<FReport> Report)
+	{
+		UWorld* World = Report->World.Get();
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.InputEdgeReport stopped, the world or its net driver went away"));
+			return false;
+		}
+
+		const double ElapsedSeconds = FPlatformTime::Seconds() - Report->StartTime;
+		if (ElapsedSeconds < Report->Seconds)
+		{
+			if (Report->CrouchToggleInterval > 0.f && ElapsedSeconds >= Report->NextCrouchToggleTime)
+			{
+				Report->NextCrouchToggleTime += Report->CrouchToggleInterval;
+				for (const FCharacterCounters& Character : Report->Characters)
+				{
+					UFPSCharacterMovementComponent* MovementComponent = Character.MovementComponent.Get();
+					if (MovementComponent && MovementComponent->GetFPSOwner())
+					{
+						MovementComponent->GetFPSOwner()->ToggleCrouch();
+					}
+				}
+			}
+			return true;
+		}
+
+		/*Characters that went away during the report aren't counted*/
+		FFPSInputEdgeCounters Counters;
+		int32 NumCharacters = 0;
+		for (const FCharacterCounters& Character : Report->Characters)
+		{
+			if (const UFPSCharacterMovementComponent* MovementComponent = Character.MovementComponent.Get())
+			{
+				const FFPSInputEdgeCounters& EndCounters = MovementComponent->InputEdgeCounters;
+				Counters.NumRecorded += EndCounters.NumRecorded - Character.StartCounters.NumRecorded;
+				Counters.NumLost += EndCounters.NumLost - Character.StartCounters.NumLost;
+				Counters.NumSent += EndCounters.NumSent - Character.StartCounters.NumSent;
+				Counters.NumServerMoves += EndCounters.NumServerMoves - Character.StartCounters.NumServerMoves;
+				Counters.NumMovesWithEdges += EndCounters.NumMovesWithEdges - Character.StartCounters.NumMovesWithEdges;
+				Counters.NumCombinedWithEdges += EndCounters.NumCombinedWithEdges - Character.StartCounters.NumCombinedWithEdges;
+				Counters.NumCorrections += EndCounters.NumCorrections - Character.StartCounters.NumCorrections;
+				++NumCharacters;
+			}
+		}
+
+		const uint32 OutBytes = NetDriver->OutTotalBytes - Report->StartOutBytes;
+		const uint32 OutPackets = NetDriver->OutTotalPackets - Report->StartOutPackets;
+		/*Everything the client sent over its ServerMoves, the moves are most of it while playing*/
+		const uint32 NumServerMoves = FMath::Max<uint32>(1, Counters.NumServerMoves);
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("Seconds=%.1f Characters=%d CrouchTogglesPerSecond=%.1f OutBytes=%u OutPackets=%u OutBytesPerSecond=%.0f OutPacketsPerSecond=%.1f ServerMovesPerSecond=%.1f BytesPerServerMove=%.1f Corrections=%u CorrectionRate=%.2f%% EdgesRecorded=%u EdgesLost=%u LossRate=%.2f%% EdgesSent=%u MovesWithEdges=%u CombinedWithEdges=%u"),
+			ElapsedSeconds, NumCharacters, Report->CrouchToggleInterval > 0.f ? 1.f / Report->CrouchToggleInterval : 0.f, OutBytes, OutPackets,
+			OutBytes / ElapsedSeconds, OutPackets / ElapsedSeconds, Counters.NumServerMoves / ElapsedSeconds, (double)OutBytes / NumServerMoves,
+			Counters.NumCorrections, 100.0 * Counters.NumCorrections / NumServerMoves,
+			Counters.NumRecorded, Counters.NumLost, 100.0 * Counters.NumLost / FMath::Max<uint32>(1, Counters.NumRecorded),
+			Counters.NumSent, Counters.NumMovesWithEdges, Counters.NumCombinedWithEdges);
+		return false;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver || !NetDriver->ServerConnection)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.InputEdgeReport has to run on a client connected to a server"));
+			return;
+		}
+
+		TSharedRef<FReport> Report = MakeShared<FReport>();
+		Report->World = World;
+		Report->StartTime = FPlatformTime::Seconds();
+		Report->Seconds = FMath::Max(1.f, Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.f);
+		const float CrouchTogglesPerSecond = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.f;
+		Report->CrouchToggleInterval = CrouchTogglesPerSecond > 0.f ? 1.f / CrouchTogglesPerSecond : 0.f;
+		Report->NextCrouchToggleTime = 0.0;
+		Report->StartOutBytes = NetDriver->OutTotalBytes;
+		Report->StartOutPackets = NetDriver->OutTotalPackets;
+		for (TActorIterator<AFPSCharacterBase> It(World); It; ++It)
+		{
+			UFPSCharacterMovementComponent* MovementComponent = It->GetFPSMovementComponent();
+			if (MovementComponent && It->Role == ROLE_AutonomousProxy)
+			{
+				Report->Characters.Add({ MovementComponent, MovementComponent->InputEdgeCounters });
+			}
+		}
+
+		if (Report->Characters.Num() == 0)
+		{
+			UE_LOG(LogFPSMovementBenchmark, Warning, TEXT("fps.Movement.InputEdgeReport found no character controlled by this client"));
+			return;
+		}
+
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick, Report));
+		UE_LOG(LogFPSMovementBenchmark, Display, TEXT("fps.Movement.InputEdgeReport counting for %.1f seconds"), Report->Seconds);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs InputEdgeReportCommand(
+	TEXT("fps.Movement.InputEdgeReport"),
+	TEXT("Count the bytes and packets the client sends, its ServerMove RPCs, input edges and corrections over a number of seconds, optionally toggling crouch. Arguments: Seconds (10 if empty) CrouchTogglesPerSecond"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FPSInputEdgeReport::Run));
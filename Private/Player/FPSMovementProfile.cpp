@@ -0,0 +1,166 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSMovementProfile.h"
+#include "FPSCharacterMovementComponent.h"
+#include "Player/FPSCharacterBase.h"
+#include "Camera/CameraComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace FPSMovementProfile
+{
+	static TMap<FObjectKey, TSharedRef<const FFPSMovementProfile>> Profiles;
+	static uint32 Generation = 0;
+	static bool bDelegatesRegistered = false;
+
+#if WITH_EDITOR
+	static void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+	{
+		// Editing the defaults of a blueprint or a component template changes what the profiles are built from
+		if (Object && Object->IsTemplate() && Profiles.Num() > 0)
+		{
+			FFPSMovementProfile::InvalidateAll();
+		}
+	}
+#endif // WITH_EDITOR
+
+#if WITH_HOT_RELOAD
+	static void OnReloadComplete(EReloadCompleteReason Reason)
+	{
+		FFPSMovementProfile::InvalidateAll();
+	}
+#endif // WITH_HOT_RELOAD
+
+	static void RegisterDelegates()
+	{
+		if (bDelegatesRegistered)
+		{
+			return;
+		}
+
+		bDelegatesRegistered = true;
+#if WITH_EDITOR
+		FCoreUObjectDelegates::OnObjectPropertyChanged.AddStatic(&OnObjectPropertyChanged);
+#endif // WITH_EDITOR
+#if WITH_HOT_RELOAD
+		FCoreUObjectDelegates::ReloadCompleteDelegate.AddStatic(&OnReloadComplete);
+#endif // WITH_HOT_RELOAD
+	}
+
+	static TSharedRef<const FFPSMovementProfile> Build(const UClass* CharacterClass, const FFPSMovementProfile::FMovementSettings& Settings)
+	{
+		TSharedRef<FFPSMovementProfile> Profile = MakeShared<FFPSMovementProfile>();
+
+		const ACharacter* DefaultCharacter = CharacterClass->GetDefaultObject<ACharacter>();
+		const UCapsuleComponent* DefaultCapsule = DefaultCharacter->GetCapsuleComponent();
+		const bool bHasMovement = DefaultCharacter->GetCharacterMovement() != nullptr;
+		const bool bHasFPSMovement = Cast<UFPSCharacterMovementComponent>(DefaultCharacter->GetCharacterMovement()) != nullptr;
+
+		Profile->Settings = Settings;
+		Profile->StandingHalfHeight = DefaultCapsule ? DefaultCapsule->GetUnscaledCapsuleHalfHeight() : 0.f;
+		Profile->CapsuleRadius = DefaultCapsule ? DefaultCapsule->GetUnscaledCapsuleRadius() : 0.f;
+		Profile->CrouchedHalfHeight = bHasMovement ? Settings.CrouchedHalfHeight : Profile->StandingHalfHeight;
+		Profile->PronedHalfHeight = bHasFPSMovement ? FMath::Clamp(Settings.PronedHalfHeight, Profile->CapsuleRadius, Profile->CrouchedHalfHeight) : Profile->CrouchedHalfHeight;
+
+		Profile->bHasMesh = DefaultCharacter->GetMesh() != nullptr;
+		Profile->DefaultMeshZ = Profile->bHasMesh ? DefaultCharacter->GetMesh()->RelativeLocation.Z : 0.f;
+		Profile->DefaultBaseTranslationZ = DefaultCharacter->GetBaseTranslationOffset().Z;
+
+		Profile->DefaultEyeHeight = Settings.DefaultEyeHeight;
+		Profile->CrouchedEyeHeight = Settings.CrouchedEyeHeight;
+		Profile->PronedEyeHeight = Settings.PronedEyeHeight;
+
+		const float HeightRange = Profile->StandingHalfHeight - Profile->CrouchedHalfHeight;
+		Profile->CrouchInterpSpeed = Settings.CrouchTime > 0.f ? HeightRange / Settings.CrouchTime : 0.f;
+		Profile->InvCrouchHeightRange = HeightRange != 0.f ? 1.f / HeightRange : 0.f;
+		Profile->EyeHeightSlope = (Profile->DefaultEyeHeight - Profile->CrouchedEyeHeight) * Profile->InvCrouchHeightRange;
+
+		const float ProneHeightRange = Profile->CrouchedHalfHeight - Profile->PronedHalfHeight;
+		Profile->ProneInterpSpeed = Settings.ProneTime > 0.f ? ProneHeightRange / Settings.ProneTime : 0.f;
+		Profile->InvProneHeightRange = ProneHeightRange != 0.f ? 1.f / ProneHeightRange : 0.f;
+
+		const float CapsuleHeightRange = Profile->StandingHalfHeight - Profile->PronedHalfHeight;
+		Profile->InvCapsuleHeightRange = CapsuleHeightRange != 0.f ? 1.f / CapsuleHeightRange : 0.f;
+
+		FPSCrouchKernel::FStanceMetrics& Metrics = Profile->StanceMetrics;
+		Metrics.StandingHalfHeight = Profile->StandingHalfHeight;
+		Metrics.CrouchedHalfHeight = Profile->CrouchedHalfHeight;
+		Metrics.PronedHalfHeight = Profile->PronedHalfHeight;
+		Metrics.MinHalfHeight = Profile->CapsuleRadius;
+		Metrics.CrouchedEyeHeight = Profile->CrouchedEyeHeight;
+		Metrics.PronedEyeHeight = Profile->PronedEyeHeight;
+		Metrics.CrouchInterpSpeed = Profile->CrouchInterpSpeed;
+		Metrics.ProneInterpSpeed = Profile->ProneInterpSpeed;
+		Metrics.EyeHeightSlope = Profile->EyeHeightSlope;
+		Metrics.InvProneHeightRange = Profile->InvProneHeightRange;
+
+		Profile->Generation = Generation;
+		return Profile;
+	}
+}
+
+TSharedRef<const FFPSMovementProfile> FFPSMovementProfile::Get(const UClass* CharacterClass)
+{
+	check(CharacterClass);
+
+	if (const TSharedRef<const FFPSMovementProfile>* Found = FPSMovementProfile::Profiles.Find(CharacterClass))
+	{
+		return *Found;
+	}
+
+	FPSMovementProfile::RegisterDelegates();
+	const FMovementSettings Settings = FMovementSettings::Get(CharacterClass->GetDefaultObject<ACharacter>());
+	return FPSMovementProfile::Profiles.Add(CharacterClass, FPSMovementProfile::Build(CharacterClass, Settings));
+}
+
+TSharedRef<const FFPSMovementProfile> FFPSMovementProfile::Get(const UClass* CharacterClass, const FMovementSettings& Settings)
+{
+	TSharedRef<const FFPSMovementProfile> ClassProfile = Get(CharacterClass);
+	if (ClassProfile->Settings == Settings)
+	{
+		return ClassProfile;
+	}
+
+	return FPSMovementProfile::Build(CharacterClass, Settings);
+}
+
+FFPSMovementProfile::FMovementSettings FFPSMovementProfile::FMovementSettings::Get(const ACharacter* Character)
+{
+	const UCharacterMovementComponent* MovementComponent = Character ? Character->GetCharacterMovement() : nullptr;
+	const UFPSCharacterMovementComponent* FPSMovementComponent = Cast<UFPSCharacterMovementComponent>(MovementComponent);
+	const AFPSCharacterBase* FPSCharacter = Cast<AFPSCharacterBase>(Character);
+
+	FMovementSettings Settings;
+	Settings.CrouchedHalfHeight = MovementComponent ? MovementComponent->CrouchedHalfHeight : 0.f;
+	Settings.PronedHalfHeight = FPSMovementComponent ? FPSMovementComponent->PronedHalfHeight : 0.f;
+	Settings.CrouchTime = FPSMovementComponent ? FPSMovementComponent->CrouchTime : 0.f;
+	Settings.ProneTime = FPSMovementComponent ? FPSMovementComponent->ProneTime : 0.f;
+
+	/*AFPSCharacterBase::PostInitializeComponents sets DefaultEyeHeight from the camera, the class default object never gets there.
+	BaseEyeHeight of a plain ACharacter changes while crouching, the class default is the standing one*/
+	const UCameraComponent* Camera = FPSCharacter ? FPSCharacter->GetCameraComponent() : nullptr;
+	if (FPSCharacter)
+	{
+		Settings.DefaultEyeHeight = (FPSCharacter->HasAnyFlags(RF_ClassDefaultObject) && Camera) ? Camera->RelativeLocation.Z : FPSCharacter->DefaultEyeHeight;
+	}
+	else
+	{
+		Settings.DefaultEyeHeight = Character ? Character->GetClass()->GetDefaultObject<ACharacter>()->BaseEyeHeight : 0.f;
+	}
+	Settings.CrouchedEyeHeight = Character ? Character->CrouchedEyeHeight : 0.f;
+	Settings.PronedEyeHeight = FPSCharacter ? FPSCharacter->PronedEyeHeight : Settings.CrouchedEyeHeight;
+	return Settings;
+}
+
+uint32 FFPSMovementProfile::GetGeneration()
+{
+	return FPSMovementProfile::Generation;
+}
+
+void FFPSMovementProfile::InvalidateAll()
+{
+	FPSMovementProfile::Profiles.Reset();
+	++FPSMovementProfile::Generation;
+}
@@ -0,0 +1,87 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSMovementStateTable.h"
+
+using namespace FPSMovementStateTable;
+
+namespace FPSMovementStateRules
+{
+	/*Matches a key if (Key & Mask) == Value*/
+	template<typename ActionType>
+	struct TRule
+	{
+		uint8 Mask;
+		uint8 Value;
+		ActionType Action;
+	};
+
+	/*In priority order, prone takes over from crouching and getting up from prone always ends crouched*/
+	static const TRule<EStanceAction> StanceRules[] =
+	{
+		{ Stance_WantsProne | Stance_IsProne,							Stance_WantsProne,							EStanceAction::Prone },
+		{ Stance_WantsProne | Stance_Transitioning,						Stance_WantsProne | Stance_Transitioning,	EStanceAction::Prone },
+		{ Stance_WantsProne | Stance_InProneMode,						Stance_WantsProne,							EStanceAction::EnterProneMode },
+		{ Stance_WantsProne,											Stance_WantsProne,							EStanceAction::None },
+		{ Stance_IsProne,												Stance_IsProne,								EStanceAction::UnProne },
+		{ Stance_CanCrouch | Stance_WantsCrouch | Stance_IsCrouching,	Stance_CanCrouch | Stance_WantsCrouch,		EStanceAction::Crouch },
+		{ Stance_CanCrouch | Stance_WantsCrouch | Stance_Transitioning,	Stance_CanCrouch | Stance_WantsCrouch | Stance_Transitioning,	EStanceAction::Crouch },
+		{ Stance_CanCrouch,												0,											EStanceAction::UnCrouch },
+		{ Stance_WantsSprint,											Stance_WantsSprint,							EStanceAction::UnCrouch },
+		{ Stance_WantsCrouch | Stance_IsCrouching,						Stance_IsCrouching,							EStanceAction::UnCrouch },
+		{ Stance_WantsCrouch | Stance_Transitioning,					Stance_Transitioning,						EStanceAction::UnCrouch },
+	};
+
+	static const uint8 SprintAllowed = Sprint_WantsSprint | Sprint_OnGround | Sprint_MovingForward | Sprint_CanSprint;
+
+	static const TRule<ESprintAction> SprintRules[] =
+	{
+		{ Sprint_IsSprinting | Sprint_WantsLowStance,			Sprint_IsSprinting | Sprint_WantsLowStance,	ESprintAction::StopAndClearWants },
+		{ Sprint_IsSprinting | Sprint_WantsSprint,				Sprint_IsSprinting,							ESprintAction::Stop },
+		{ Sprint_IsSprinting | Sprint_OnGround,					Sprint_IsSprinting,							ESprintAction::Stop },
+		{ Sprint_IsSprinting | Sprint_MovingForward,			Sprint_IsSprinting,							ESprintAction::Stop },
+		{ Sprint_IsSprinting | Sprint_CanSprint,				Sprint_IsSprinting,							ESprintAction::Stop },
+		{ SprintAllowed | Sprint_IdleStance,					SprintAllowed | Sprint_IdleStance,			ESprintAction::ClearLowStanceAndStart },
+		{ SprintAllowed,										SprintAllowed,								ESprintAction::ClearLowStance },
+	};
+
+	template<typename ActionType, int32 NumRules>
+	static ActionType Evaluate(const TRule<ActionType>(&Rules)[NumRules], uint32 Key)
+	{
+		for (const TRule<ActionType>& Rule : Rules)
+		{
+			if ((Key & Rule.Mask) == Rule.Value)
+			{
+				return Rule.Action;
+			}
+		}
+
+		return ActionType::None;
+	}
+
+	template<typename ActionType, int32 NumRules, int32 NumKeys>
+	static const ActionType* Build(const TRule<ActionType>(&Rules)[NumRules], ActionType(&OutTable)[NumKeys])
+	{
+		for (int32 Key = 0; Key < NumKeys; ++Key)
+		{
+			OutTable[Key] = Evaluate(Rules, Key);
+		}
+
+		return OutTable;
+	}
+
+	static EStanceAction StanceTable[NumStanceKeys];
+	static ESprintAction SprintTable[NumSprintKeys];
+}
+
+const EStanceAction* FPSMovementStateTable::StanceActions = FPSMovementStateRules::Build(FPSMovementStateRules::StanceRules, FPSMovementStateRules::StanceTable);
+const ESprintAction* FPSMovementStateTable::SprintActions = FPSMovementStateRules::Build(FPSMovementStateRules::SprintRules, FPSMovementStateRules::SprintTable);
+
+EStanceAction FPSMovementStateTable::EvaluateStanceRules(uint32 Key)
+{
+	return FPSMovementStateRules::Evaluate(FPSMovementStateRules::StanceRules, Key);
+}
+
+ESprintAction FPSMovementStateTable::EvaluateSprintRules(uint32 Key)
+{
+	return FPSMovementStateRules::Evaluate(FPSMovementStateRules::SprintRules, Key);
+}
@@ -0,0 +1,199 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSMovementStats.h"
+#include "FPSCharacterMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_FPSMovement_UpdateAuthority);
+DEFINE_STAT(STAT_FPSMovement_UpdateAutonomous);
+DEFINE_STAT(STAT_FPSMovement_UpdateSimulated);
+DEFINE_STAT(STAT_FPSMovement_UpdateState);
+DEFINE_STAT(STAT_FPSMovement_Crouch);
+DEFINE_STAT(STAT_FPSMovement_UnCrouch);
+DEFINE_STAT(STAT_FPSMovement_Prone);
+DEFINE_STAT(STAT_FPSMovement_UnProne);
+DEFINE_STAT(STAT_FPSMovement_PhysProne);
+DEFINE_STAT(STAT_FPSMovement_PhysVault);
+DEFINE_STAT(STAT_FPSMovement_LedgeProbe);
+DEFINE_STAT(STAT_FPSMovement_ShrinkCapsule);
+DEFINE_STAT(STAT_FPSMovement_ExpandCapsule);
+DEFINE_STAT(STAT_FPSMovement_ProxyUpdate);
+DEFINE_STAT(STAT_FPSMovement_ProxyTransitions);
+DEFINE_STAT(STAT_FPSMovement_CorrectionReplay);
+DEFINE_STAT(STAT_FPSMovement_CrouchCalls);
+DEFINE_STAT(STAT_FPSMovement_UnCrouchCalls);
+DEFINE_STAT(STAT_FPSMovement_ShrinkCapsuleCalls);
+DEFINE_STAT(STAT_FPSMovement_ExpandCapsuleCalls);
+DEFINE_STAT(STAT_FPSMovement_ProxyUpdates);
+DEFINE_STAT(STAT_FPSMovement_ProxyUpdatesSkipped);
+DEFINE_STAT(STAT_FPSMovement_ShrinkQueries);
+DEFINE_STAT(STAT_FPSMovement_ExpandQueries);
+DEFINE_STAT(STAT_FPSMovement_AsyncExpandQueries);
+DEFINE_STAT(STAT_FPSMovement_UnCrouchDeferred);
+DEFINE_STAT(STAT_FPSMovement_UnCrouchClearanceHits);
+DEFINE_STAT(STAT_FPSMovement_UnCrouchClearanceMisses);
+DEFINE_STAT(STAT_FPSMovement_LedgeQueries);
+DEFINE_STAT(STAT_FPSMovement_LedgeCacheHits);
+DEFINE_STAT(STAT_FPSMovement_LedgeCacheMisses);
+DEFINE_STAT(STAT_FPSMovement_VaultsStarted);
+DEFINE_STAT(STAT_FPSMovement_NetMoveDataSent);
+DEFINE_STAT(STAT_FPSMovement_NetMoveDataBits);
+DEFINE_STAT(STAT_FPSMovement_NetMoveDataRejected);
+DEFINE_STAT(STAT_FPSMovement_NetUpdateRateChanges);
+DEFINE_STAT(STAT_FPSMovement_NetUpdatesForced);
+DEFINE_STAT(STAT_FPSMovement_InputEdgesRecorded);
+DEFINE_STAT(STAT_FPSMovement_InputEdgesLost);
+DEFINE_STAT(STAT_FPSMovement_InputEdgesSent);
+DEFINE_STAT(STAT_FPSMovement_InputEdgeMovesCombined);
+DEFINE_STAT(STAT_FPSMovement_CombinedTransitionMoves);
+DEFINE_STAT(STAT_FPSMovement_TransitionTimelineStarts);
+DEFINE_STAT(STAT_FPSMovement_ClientCorrections);
+DEFINE_STAT(STAT_FPSMovement_MoveStateCorrections);
+DEFINE_STAT(STAT_FPSMovement_ReplayedMoves);
+DEFINE_STAT(STAT_FPSMovement_CosmeticUpdatesDeferred);
+DEFINE_STAT(STAT_FPSMovement_SavedMovesAllocated);
+DEFINE_STAT(STAT_FPSMovement_ProxyTransitionsSkipped);
+DEFINE_STAT(STAT_FPSMovement_ProxyTransitionsSnapped);
+DEFINE_STAT(STAT_FPSMovement_ProxyStanceChanges);
+DEFINE_STAT(STAT_FPSMovement_ProxyTransitionsActive);
+DEFINE_STAT(STAT_FPSMovement_ProxyStanceHeightError);
+
+DEFINE_LOG_CATEGORY_STATIC(LogFPSMovementProfiler, Log, All);
+
+static TAutoConsoleVariable<int32> CVarProfileCharacters(
+	TEXT("fps.Movement.ProfileCharacters"),
+	0,
+	TEXT("Write the characters with the most expensive movement each frame to Saved/Profiling/FPSMovement-<date>.csv\n")
+	TEXT("0: off, 1: on"));
+
+static TAutoConsoleVariable<int32> CVarProfileTopCharacters(
+	TEXT("fps.Movement.ProfileTopCharacters"),
+	8,
+	TEXT("Number of characters written to the csv per frame when fps.Movement.ProfileCharacters is on"));
+
+static FAutoConsoleVariableSink CVarProfileCharactersSink(FConsoleCommandDelegate::CreateStatic(&FFPSMovementCharacterProfiler::OnConsoleVariablesChanged));
+
+namespace FPSMovementCharacterProfiler
+{
+	struct FEntry
+	{
+		TWeakObjectPtr<const UFPSCharacterMovementComponent> MovementComponent;
+		uint32 Cycles;
+		uint32 Updates;
+	};
+
+	static TArray<FEntry> Entries;
+	static TMap<const UFPSCharacterMovementComponent*, int32> EntryIndices;
+	static FArchive* Writer = nullptr;
+	static FString Filename;
+	static FDelegateHandle EndFrameHandle;
+
+	static const TCHAR* GetRoleName(ENetRole Role)
+	{
+		switch (Role)
+		{
+		case ROLE_Authority:		return TEXT("Authority");
+		case ROLE_AutonomousProxy:	return TEXT("AutonomousProxy");
+		case ROLE_SimulatedProxy:	return TEXT("SimulatedProxy");
+		default:					return TEXT("None");
+		}
+	}
+
+	static void WriteLine(const FString& Line)
+	{
+		FTCHARToUTF8 Converted(*Line);
+		Writer->Serialize(const_cast<ANSICHAR*>(Converted.Get()), Converted.Length());
+	}
+}
+
+bool FFPSMovementCharacterProfiler::bEnabled = false;
+
+void FFPSMovementCharacterProfiler::AddCycles(const UFPSCharacterMovementComponent* MovementComponent, uint32 Cycles)
+{
+	using namespace FPSMovementCharacterProfiler;
+
+	int32& Index = EntryIndices.FindOrAdd(MovementComponent, INDEX_NONE);
+	if (Index == INDEX_NONE)
+	{
+		Index = Entries.Add({ MovementComponent, 0, 0 });
+	}
+
+	Entries[Index].Cycles += Cycles;
+	Entries[Index].Updates++;
+}
+
+void FFPSMovementCharacterProfiler::OnConsoleVariablesChanged()
+{
+	using namespace FPSMovementCharacterProfiler;
+
+	const bool bWantsEnabled = CVarProfileCharacters.GetValueOnGameThread() != 0;
+	if (bWantsEnabled == bEnabled)
+	{
+		return;
+	}
+
+	if (bWantsEnabled)
+	{
+		Filename = FPaths::ProfilingDir() / FString::Printf(TEXT("FPSMovement-%s.csv"), *FDateTime::Now().ToString());
+		Writer = IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_AllowRead);
+		if (!Writer)
+		{
+			UE_LOG(LogFPSMovementProfiler, Warning, TEXT("Unable to create %s"), *Filename);
+			Filename.Reset();
+			return;
+		}
+
+		UE_LOG(LogFPSMovementProfiler, Log, TEXT("Writing the movement cost of the characters to %s"), *Filename);
+		WriteLine(TEXT("Frame,Rank,Character,Role,Microseconds,Updates\n"));
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FFPSMovementCharacterProfiler::OnEndFrame);
+		bEnabled = true;
+	}
+	else
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		EndFrameHandle.Reset();
+		Writer->Close();
+		delete Writer;
+		Writer = nullptr;
+		Filename.Reset();
+		Entries.Reset();
+		EntryIndices.Reset();
+		bEnabled = false;
+	}
+}
+
+void FFPSMovementCharacterProfiler::OnEndFrame()
+{
+	using namespace FPSMovementCharacterProfiler;
+
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.Cycles > B.Cycles; });
+
+	const int32 NumToWrite = FMath::Min(Entries.Num(), FMath::Max(0, CVarProfileTopCharacters.GetValueOnGameThread()));
+	for (int32 Rank = 0; Rank < NumToWrite; ++Rank)
+	{
+		const FEntry& Entry = Entries[Rank];
+		const UFPSCharacterMovementComponent* MovementComponent = Entry.MovementComponent.Get();
+		const AActor* Owner = MovementComponent ? MovementComponent->GetOwner() : nullptr;
+
+		WriteLine(FString::Printf(TEXT("%llu,%d,%s,%s,%.2f,%u\n"),
+			(uint64)GFrameCounter,
+			Rank + 1,
+			*GetNameSafe(Owner),
+			GetRoleName(Owner ? Owner->Role.GetValue() : ROLE_None),
+			FPlatformTime::ToMilliseconds(Entry.Cycles) * 1000.f,
+			Entry.Updates));
+	}
+
+	Entries.Reset();
+	EntryIndices.Reset();
+}
+
+const FString& FFPSMovementCharacterProfiler::GetFilename()
+{
+	return FPSMovementCharacterProfiler::Filename;
+}
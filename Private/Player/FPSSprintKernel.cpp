@@ -0,0 +1,58 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "FPSSprintKernel.h"
+#include "Math/VectorRegister.h"
+
+/*Forward vectors are computed into stack buffers of this many entries*/
+static const int32 BatchChunkSize = 64;
+
+void FPSSprintKernel::EvaluateBatch(const float* Yaws, const float* AccelX, const float* AccelY, const uint8* Flags, uint8* OutResults, int32 Count)
+{
+	MS_ALIGN(16) float ForwardX[BatchChunkSize] GCC_ALIGN(16);
+	MS_ALIGN(16) float ForwardY[BatchChunkSize] GCC_ALIGN(16);
+
+	const VectorRegister ConeCosSquared = VectorSetFloat1(ForwardConeCosSquared);
+	const VectorRegister MinSizeSquared = VectorSetFloat1(MinAccelerationSizeSquared);
+	const VectorRegister Zero = VectorZero();
+
+	for (int32 ChunkStart = 0; ChunkStart < Count; ChunkStart += BatchChunkSize)
+	{
+		const int32 ChunkCount = FMath::Min(BatchChunkSize, Count - ChunkStart);
+
+		/*Same SinCos as the single version so the results match exactly*/
+		for (int32 i = 0; i < ChunkCount; ++i)
+		{
+			FMath::SinCos(&ForwardY[i], &ForwardX[i], FMath::DegreesToRadians(Yaws[ChunkStart + i]));
+		}
+
+		int32 i = 0;
+		for (; i + 4 <= ChunkCount; i += 4)
+		{
+			const int32 Index = ChunkStart + i;
+			const VectorRegister FX = VectorLoadAligned(&ForwardX[i]);
+			const VectorRegister FY = VectorLoadAligned(&ForwardY[i]);
+			const VectorRegister AX = VectorLoad(&AccelX[Index]);
+			const VectorRegister AY = VectorLoad(&AccelY[Index]);
+
+			/*Same order of operations as the single version*/
+			const VectorRegister Dot = VectorAdd(VectorMultiply(FX, AX), VectorMultiply(FY, AY));
+			const VectorRegister SizeSquared = VectorAdd(VectorMultiply(AX, AX), VectorMultiply(AY, AY));
+
+			VectorRegister Mask = VectorCompareGE(SizeSquared, MinSizeSquared);
+			Mask = VectorBitwiseAnd(Mask, VectorCompareGE(Dot, Zero));
+			Mask = VectorBitwiseAnd(Mask, VectorCompareGE(VectorMultiply(Dot, Dot), VectorMultiply(ConeCosSquared, SizeSquared)));
+
+			const int32 InCone = VectorMaskBits(Mask);
+			OutResults[Index + 0] = ((InCone & 1) && IsSprintState(Flags[Index + 0])) ? 1 : 0;
+			OutResults[Index + 1] = ((InCone & 2) && IsSprintState(Flags[Index + 1])) ? 1 : 0;
+			OutResults[Index + 2] = ((InCone & 4) && IsSprintState(Flags[Index + 2])) ? 1 : 0;
+			OutResults[Index + 3] = ((InCone & 8) && IsSprintState(Flags[Index + 3])) ? 1 : 0;
+		}
+
+		for (; i < ChunkCount; ++i)
+		{
+			const int32 Index = ChunkStart + i;
+			OutResults[Index] = (IsSprintState(Flags[Index]) && IsInForwardCone(ForwardX[i], ForwardY[i], AccelX[Index], AccelY[Index])) ? 1 : 0;
+		}
+	}
+}
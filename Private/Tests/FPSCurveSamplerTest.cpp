@@ -0,0 +1,81 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCurveSampler.h"
+#include "Curves/CurveFloat.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSCurveSamplerTest
+{
+	static const float MaxError = 0.01f;
+
+	/*An acceleration curve like the sprint one, ease in to a peak and back down, linear past the ends*/
+	static UCurveFloat* MakeCurve()
+	{
+		UCurveFloat* Curve = NewObject<UCurveFloat>(GetTransientPackage());
+		const float Keys[][2] = { { 0.f, 1.f }, { 0.3f, 2.5f }, { 0.7f, 1.8f }, { 1.f, 1.f } };
+		for (const float* Key : Keys)
+		{
+			Curve->FloatCurve.SetKeyInterpMode(Curve->FloatCurve.UpdateOrAddKey(Key[0], Key[1]), RCIM_Cubic);
+		}
+		Curve->FloatCurve.PreInfinityExtrap = RCCE_Linear;
+		Curve->FloatCurve.PostInfinityExtrap = RCCE_Linear;
+		return Curve;
+	}
+
+	/*Largest difference between Evaluate and the curve, sampled far finer than the baked table*/
+	static float GetLargestError(const FFPSCurveSampler& Sampler, const UCurveFloat* Curve, float Low, float High)
+	{
+		static const int32 NumSamples = 10000;
+
+		float LargestError = 0.f;
+		for (int32 i = 0; i <= NumSamples; ++i)
+		{
+			const float Time = FMath::Lerp(Low, High, (float)i / NumSamples);
+			LargestError = FMath::Max(LargestError, FMath::Abs(Sampler.Evaluate(Time) - Curve->GetFloatValue(Time)));
+		}
+		return LargestError;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSCurveSamplerErrorBoundTest, "FPS.Movement.CurveSampler.ErrorBound",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSCurveSamplerErrorBoundTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSCurveSamplerTest;
+
+	const UCurveFloat* Curve = MakeCurve();
+
+	for (EFPSCurveSampleMode RequestedMode : { EFPSCurveSampleMode::LookupTable, EFPSCurveSampleMode::Polynomial })
+	{
+		FFPSCurveSampler Sampler;
+		const EFPSCurveSampleMode Mode = Sampler.Bake(Curve, RequestedMode, MaxError);
+		const FString ModeName = (RequestedMode == EFPSCurveSampleMode::Polynomial) ? TEXT("Polynomial") : TEXT("LookupTable");
+
+		if (!TestTrue(ModeName + TEXT(" is baked"), Sampler.IsBakedFrom(Curve)))
+		{
+			continue;
+		}
+
+		TestTrue(ModeName + TEXT(" never falls back to a less accurate mode"), Mode == RequestedMode || Mode == EFPSCurveSampleMode::LookupTable);
+		TestTrue(ModeName + TEXT(" measured error is within the bound"), Sampler.GetMaxError() <= MaxError);
+		TestTrue(ModeName + TEXT(" error over 0-1 is within the bound"), GetLargestError(Sampler, Curve, 0.f, 1.f) <= MaxError);
+
+		/*Outside of 0-1 it has to be the curve itself, the sprint speed ratio goes over 1 on slopes and when landing*/
+		TestEqual(ModeName + TEXT(" keeps the extrapolation below 0"), GetLargestError(Sampler, Curve, -1.f, -KINDA_SMALL_NUMBER), 0.f);
+		TestEqual(ModeName + TEXT(" keeps the extrapolation above 1"), GetLargestError(Sampler, Curve, 1.f + KINDA_SMALL_NUMBER, 2.f), 0.f);
+	}
+
+	/*A bound no table can meet evaluates the curve directly*/
+	FFPSCurveSampler Sampler;
+	TestTrue(TEXT("Falls back to the curve when the bound can't be met"), Sampler.Bake(Curve, EFPSCurveSampleMode::LookupTable, 0.f) == EFPSCurveSampleMode::Curve);
+	TestFalse(TEXT("Nothing baked after the fallback"), Sampler.IsBakedFrom(Curve));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,110 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSMovementStateTable.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSMovementStateTableTest
+{
+	using namespace FPSMovementStateTable;
+
+	/*UpdateCharacterStateBeforeMovement before the tables, with the state read from the key*/
+	static EStanceAction OldStanceAction(uint32 Key)
+	{
+		const bool bWantsProne = (Key & Stance_WantsProne) != 0;
+		const bool bIsProne = (Key & Stance_IsProne) != 0;
+		const bool bInProneMode = (Key & Stance_InProneMode) != 0;
+		const bool bTransitioning = (Key & Stance_Transitioning) != 0;
+		const bool bCanCrouch = (Key & Stance_CanCrouch) != 0;
+		const bool bWantsCrouch = (Key & Stance_WantsCrouch) != 0;
+		const bool bIsCrouching = (Key & Stance_IsCrouching) != 0;
+		const bool bWantsSprint = (Key & Stance_WantsSprint) != 0;
+
+		if (bWantsProne)
+		{
+			if (!(bIsProne && !bTransitioning))
+			{
+				return EStanceAction::Prone;
+			}
+			else if (!bInProneMode)
+			{
+				return EStanceAction::EnterProneMode;
+			}
+		}
+		else if (bIsProne)
+		{
+			return EStanceAction::UnProne;
+		}
+		else if (bCanCrouch && bWantsCrouch && !(bIsCrouching && !bTransitioning))
+		{
+			return EStanceAction::Crouch;
+		}
+		else if (!bCanCrouch || bWantsSprint || (!bWantsCrouch && (bIsCrouching || bTransitioning)))
+		{
+			return EStanceAction::UnCrouch;
+		}
+
+		return EStanceAction::None;
+	}
+
+	static ESprintAction OldSprintAction(uint32 Key)
+	{
+		const bool bIsSprinting = (Key & Sprint_IsSprinting) != 0;
+		const bool bWantsSprint = (Key & Sprint_WantsSprint) != 0;
+		const bool bOnGround = (Key & Sprint_OnGround) != 0;
+		const bool bMovingForward = (Key & Sprint_MovingForward) != 0;
+		const bool bCanSprint = (Key & Sprint_CanSprint) != 0;
+		const bool bWantsLowStance = (Key & Sprint_WantsLowStance) != 0;
+		const bool bIdleStance = (Key & Sprint_IdleStance) != 0;
+
+		if (bIsSprinting && (!bWantsSprint || !bOnGround || !bMovingForward || !bCanSprint || bWantsLowStance))
+		{
+			return bWantsLowStance ? ESprintAction::StopAndClearWants : ESprintAction::Stop;
+		}
+		else if (bMovingForward && bWantsSprint && bOnGround && bCanSprint)
+		{
+			return bIdleStance ? ESprintAction::ClearLowStanceAndStart : ESprintAction::ClearLowStance;
+		}
+
+		return ESprintAction::None;
+	}
+}
+
+/**
+ * Every key of both tables and every key run through the rules gives the action of the if chains the tables replaced,
+ * so the character goes through the same sequence of states for any input.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSMovementStateTableTest, "FPS.Movement.StateTable.MatchesIfChains",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSMovementStateTableTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSMovementStateTable;
+	using namespace FPSMovementStateTableTest;
+
+	for (uint32 Key = 0; Key < NumStanceKeys; ++Key)
+	{
+		const EStanceAction Expected = OldStanceAction(Key);
+		if (GetStanceAction(Key) != Expected || EvaluateStanceRules(Key) != Expected)
+		{
+			AddError(FString::Printf(TEXT("Stance key 0x%02x: table %d, rules %d, if chain %d"), Key,
+				(int32)GetStanceAction(Key), (int32)EvaluateStanceRules(Key), (int32)Expected));
+		}
+	}
+
+	for (uint32 Key = 0; Key < NumSprintKeys; ++Key)
+	{
+		const ESprintAction Expected = OldSprintAction(Key);
+		if (GetSprintAction(Key) != Expected || EvaluateSprintRules(Key) != Expected)
+		{
+			AddError(FString::Printf(TEXT("Sprint key 0x%02x: table %d, rules %d, if chain %d"), Key,
+				(int32)GetSprintAction(Key), (int32)EvaluateSprintRules(Key), (int32)Expected));
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,84 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Player/FPSMovementStats.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSMovementCharacterProfilerTest, "FPS.Movement.Stats.CharacterProfilerCsv",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSMovementCharacterProfilerTest::RunTest(const FString& Parameters)
+{
+	IConsoleVariable* ProfileVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("fps.Movement.ProfileCharacters"));
+	IConsoleVariable* TopVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("fps.Movement.ProfileTopCharacters"));
+	if (!TestNotNull(TEXT("fps.Movement.ProfileCharacters exists"), ProfileVariable) || !TestNotNull(TEXT("fps.Movement.ProfileTopCharacters exists"), TopVariable)
+		|| !TestFalse(TEXT("The profiler isn't already running"), FFPSMovementCharacterProfiler::IsEnabled()))
+	{
+		return false;
+	}
+
+	const int32 OldTop = TopVariable->GetInt();
+	TopVariable->Set(2);
+	ProfileVariable->Set(1);
+	FFPSMovementCharacterProfiler::OnConsoleVariablesChanged();
+
+	const FString Filename = FFPSMovementCharacterProfiler::GetFilename();
+	if (!TestTrue(TEXT("The profiler is enabled"), FFPSMovementCharacterProfiler::IsEnabled()))
+	{
+		ProfileVariable->Set(0);
+		TopVariable->Set(OldTop);
+		return false;
+	}
+
+	/*Three characters, the middle one twice so the updates add up, only the top two are written*/
+	const UFPSCharacterMovementComponent* Cheap = NewObject<UFPSCharacterMovementComponent>(GetTransientPackage());
+	const UFPSCharacterMovementComponent* Costly = NewObject<UFPSCharacterMovementComponent>(GetTransientPackage());
+	const UFPSCharacterMovementComponent* Middle = NewObject<UFPSCharacterMovementComponent>(GetTransientPackage());
+	const uint32 Cycles = FMath::Max(1u, (uint32)(0.001 / FPlatformTime::GetSecondsPerCycle()));
+	FFPSMovementCharacterProfiler::AddCycles(Cheap, Cycles);
+	FFPSMovementCharacterProfiler::AddCycles(Costly, Cycles * 4);
+	FFPSMovementCharacterProfiler::AddCycles(Middle, Cycles);
+	FFPSMovementCharacterProfiler::AddCycles(Middle, Cycles);
+	FFPSMovementCharacterProfiler::OnEndFrame();
+
+	ProfileVariable->Set(0);
+	TopVariable->Set(OldTop);
+	FFPSMovementCharacterProfiler::OnConsoleVariablesChanged();
+	TestFalse(TEXT("The profiler is disabled"), FFPSMovementCharacterProfiler::IsEnabled());
+
+	TArray<FString> Lines;
+	FFileHelper::LoadFileToStringArray(Lines, *Filename);
+	IFileManager::Get().Delete(*Filename);
+
+	if (!TestEqual(TEXT("Header and the top two characters are written"), Lines.Num(), 3))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Header"), Lines[0], FString(TEXT("Frame,Rank,Character,Role,Microseconds,Updates")));
+
+	/*Frame,Rank,Character,Role,Microseconds,Updates*/
+	TArray<FString> First, Second;
+	Lines[1].ParseIntoArray(First, TEXT(","));
+	Lines[2].ParseIntoArray(Second, TEXT(","));
+	if (!TestEqual(TEXT("First row has every column"), First.Num(), 6) || !TestEqual(TEXT("Second row has every column"), Second.Num(), 6))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Ranks are in order"), First[1] + Second[1], FString(TEXT("12")));
+	TestTrue(TEXT("Costliest character first"), FCString::Atof(*First[4]) > FCString::Atof(*Second[4]));
+	TestEqual(TEXT("Costliest character had one update"), FCString::Atoi(*First[5]), 1);
+	TestEqual(TEXT("Updates of a character add up"), FCString::Atoi(*Second[5]), 2);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
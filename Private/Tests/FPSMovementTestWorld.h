@@ -0,0 +1,41 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Player/FPSCharacterBase.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*A standalone game world for the movement tests, destroyed with the scope*/
+struct FFPSMovementTestWorld
+{
+	FFPSMovementTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FFPSMovementTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	/*Spawn a character without a controller, it has authority until its role is changed*/
+	AFPSCharacterBase* SpawnCharacter(const FVector& Location)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		return World->SpawnActor<AFPSCharacterBase>(AFPSCharacterBase::StaticClass(), Location, FRotator::ZeroRotator, SpawnParameters);
+	}
+
+	UWorld* World;
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,106 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSNetMoveDataTest
+{
+	/*Write the move data and read it back, returns the number of bits written*/
+	static int64 RoundTrip(const FFPSNetMoveData& MoveData, FFPSNetMoveData& OutMoveData)
+	{
+		bool bSuccess = false;
+		FBitWriter Writer(0, true);
+		FFPSNetMoveData Written = MoveData;
+		Written.NetSerialize(Writer, nullptr, bSuccess);
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		OutMoveData.NetSerialize(Reader, nullptr, bSuccess);
+		return Writer.GetNumBits();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSNetMoveDataSerializeTest, "FPS.Movement.Network.MoveDataSerialize",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSNetMoveDataSerializeTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSNetMoveDataTest;
+
+	/*Nothing to send, only the two has bits*/
+	FFPSNetMoveData Empty, EmptyRead;
+	TestEqual(TEXT("Empty move data is two bits"), RoundTrip(Empty, EmptyRead), (int64)2);
+	TestFalse(TEXT("Empty move data has nothing to send"), EmptyRead.HasData());
+
+	FFPSNetMoveData MoveData, Read;
+	MoveData.TimeStamp = 12.5f;
+	MoveData.bHasCapsuleHeight = true;
+	MoveData.QuantizedCapsuleHeight = 173;
+	MoveData.InputEdges.Add({ FPSInputEdge::SprintBit });
+	MoveData.InputEdges.Add({ FPSInputEdge::CrouchBit | FPSInputEdge::ProneBit });
+
+	TestEqual(TEXT("GetNumBits is what goes on the wire"), RoundTrip(MoveData, Read), (int64)MoveData.GetNumBits());
+	TestEqual(TEXT("The time stamp comes from the ServerMove, it isn't sent"), Read.TimeStamp, 0.f);
+	TestTrue(TEXT("Height is read back"), Read.bHasCapsuleHeight && Read.QuantizedCapsuleHeight == MoveData.QuantizedCapsuleHeight);
+	if (TestEqual(TEXT("Every edge is read back"), Read.InputEdges.Num(), MoveData.InputEdges.Num()))
+	{
+		for (int32 i = 0; i < Read.InputEdges.Num(); ++i)
+		{
+			TestTrue(FString::Printf(TEXT("Edge %d is read back"), i), Read.InputEdges[i].Wants == MoveData.InputEdges[i].Wants);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * The server rejects input edges no client sends: more than MaxEdges, bits that aren't wants or an edge that doesn't change the wants,
+ * the first edge is checked against the wants in the compressed flags of the move.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSNetMoveDataValidateTest, "FPS.Movement.Network.MoveDataValidate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSNetMoveDataValidateTest::RunTest(const FString& Parameters)
+{
+	const uint8 SprintFlags = FSavedMove_Character::FLAG_Custom_0;
+	const uint8 CrouchFlags = FSavedMove_Character::FLAG_WantsToCrouch | FSavedMove_Character::FLAG_JumpPressed;
+	TestEqual(TEXT("The wants come from the sprint flag"), FPSInputEdge::FromCompressedFlags(SprintFlags), FPSInputEdge::SprintBit);
+	TestEqual(TEXT("The wants come from the crouch flag"), FPSInputEdge::FromCompressedFlags(CrouchFlags), FPSInputEdge::CrouchBit);
+	TestEqual(TEXT("The wants come from the prone flag"), FPSInputEdge::FromCompressedFlags(FSavedMove_Character::FLAG_Custom_1), FPSInputEdge::ProneBit);
+
+	FFPSNetMoveData Empty;
+	TestTrue(TEXT("No edges is valid"), Empty.IsValid(SprintFlags));
+
+	/*A sprint tap in one move starting from standing still*/
+	FFPSNetMoveData Tap;
+	Tap.InputEdges.Add({ FPSInputEdge::SprintBit });
+	Tap.InputEdges.Add({ 0 });
+	TestTrue(TEXT("A press and release is valid"), Tap.IsValid(0));
+	TestFalse(TEXT("A first edge with the wants of the flags is rejected"), Tap.IsValid(SprintFlags));
+
+	FFPSNetMoveData Repeated;
+	Repeated.InputEdges.Add({ FPSInputEdge::CrouchBit });
+	Repeated.InputEdges.Add({ FPSInputEdge::CrouchBit });
+	TestFalse(TEXT("An edge that doesn't change the wants is rejected"), Repeated.IsValid(0));
+
+	FFPSNetMoveData BadBits;
+	BadBits.InputEdges.Add({ 0x08 });
+	TestFalse(TEXT("Bits that aren't wants are rejected"), BadBits.IsValid(0));
+
+	FFPSNetMoveData TooMany;
+	for (int32 i = 0; i <= FPSInputEdge::MaxEdges; ++i)
+	{
+		TooMany.InputEdges.Add({ (i % 2) == 0 ? FPSInputEdge::ProneBit : (uint8)0 });
+	}
+	TestFalse(TEXT("More than MaxEdges is rejected"), TooMany.IsValid(0));
+	TooMany.InputEdges.Pop();
+	TestTrue(TEXT("MaxEdges is valid"), TooMany.IsValid(0));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
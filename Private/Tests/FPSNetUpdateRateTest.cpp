@@ -0,0 +1,72 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/IConsoleManager.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Tests/FPSMovementTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * The rate the server picks for a character on the ground with bAdaptiveNetUpdateFrequency. Standing still is idle like crouched or prone,
+ * moving goes back to the class rate and sprinting goes up to the active rate.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSNetUpdateRateTest, "FPS.Movement.Network.NetUpdateRate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSNetUpdateRateTest::RunTest(const FString& Parameters)
+{
+	FFPSMovementTestWorld TestWorld;
+	AFPSCharacterBase* Character = TestWorld.SpawnCharacter(FVector(0.f, 0.f, 1000.f));
+	if (!TestNotNull(TEXT("Character"), Character))
+	{
+		return false;
+	}
+
+	IConsoleVariable* AdaptiveNetUpdate = IConsoleManager::Get().FindConsoleVariable(TEXT("fps.Movement.AdaptiveNetUpdate"));
+	if (!TestNotNull(TEXT("fps.Movement.AdaptiveNetUpdate"), AdaptiveNetUpdate))
+	{
+		return false;
+	}
+	const int32 SavedAdaptiveNetUpdate = AdaptiveNetUpdate->GetInt();
+	AdaptiveNetUpdate->Set(1);
+
+	/*The rates only read the mode and the velocity, no floor is needed*/
+	UFPSCharacterMovementComponent* Movement = Character->GetFPSMovementComponent();
+	const float ClassNetUpdateFrequency = Character->NetUpdateFrequency;
+	Movement->bAdaptiveNetUpdateFrequency = true;
+	Movement->SetMovementMode(MOVE_Walking);
+	Movement->Velocity = FVector::ZeroVector;
+
+	Movement->UpdateNetUpdateRate();
+	TestEqual(TEXT("Standing still is idle"), (int32)Movement->GetNetUpdateRate(), (int32)EFPSNetUpdateRate::Idle);
+	TestEqual(TEXT("Standing still sends at the idle rate"), Character->NetUpdateFrequency, Movement->IdleNetUpdateFrequency);
+
+	Character->bIsCrouched = true;
+	Movement->UpdateNetUpdateRate();
+	TestEqual(TEXT("Crouched and still is idle"), (int32)Movement->GetNetUpdateRate(), (int32)EFPSNetUpdateRate::Idle);
+	Character->bIsCrouched = false;
+
+	Movement->Velocity = FVector(300.f, 0.f, 0.f);
+	Movement->UpdateNetUpdateRate();
+	TestEqual(TEXT("Walking is at the class rate"), (int32)Movement->GetNetUpdateRate(), (int32)EFPSNetUpdateRate::Default);
+	TestEqual(TEXT("Walking sends at the class rate"), Character->NetUpdateFrequency, ClassNetUpdateFrequency);
+
+	Character->bIsSprinting = true;
+	Movement->UpdateNetUpdateRate();
+	TestEqual(TEXT("Sprinting is active"), (int32)Movement->GetNetUpdateRate(), (int32)EFPSNetUpdateRate::Active);
+	TestEqual(TEXT("Sprinting sends at the active rate"), Character->NetUpdateFrequency, Movement->ActiveNetUpdateFrequency);
+
+	Movement->SetMovementMode(MOVE_Falling);
+	Character->bIsSprinting = false;
+	Movement->Velocity = FVector::ZeroVector;
+	Movement->UpdateNetUpdateRate();
+	TestEqual(TEXT("Still in the air is at the class rate"), (int32)Movement->GetNetUpdateRate(), (int32)EFPSNetUpdateRate::Default);
+
+	AdaptiveNetUpdate->Set(SavedAdaptiveNetUpdate);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
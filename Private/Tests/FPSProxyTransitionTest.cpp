@@ -0,0 +1,127 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Player/FPSCrouchTransitionManager.h"
+#include "Tests/FPSMovementTestWorld.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSProxyTransitionTest
+{
+	static const float FixedDeltaTime = 1.f / 60.f;
+	static const int32 NumFrames = 300;
+	static const int32 FramesPerToggle = 60;
+
+	/*The fastest of a few runs, the others are the ones the machine was busy during*/
+	static const int32 NumRuns = 3;
+
+	/*Cost per proxy at 512 over the cost per proxy at 16, above 1 is worse than linear. The margin is for timing noise*/
+	static const double MaxCostPerProxyGrowth = 1.1;
+
+	/*Seconds per frame of the transition manager toggling the crouch of every proxy once a second with staggered starts*/
+	static double StepTransitions(FFPSCrouchTransitionManager* TransitionManager, const TArray<AFPSCharacterBase*>& Characters)
+	{
+		double BestSeconds = MAX_dbl;
+		for (int32 Run = 0; Run < NumRuns; ++Run)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				for (int32 i = 0; i < Characters.Num(); ++i)
+				{
+					if ((Frame + i) % FramesPerToggle == 0)
+					{
+						Characters[i]->bIsCrouched = !Characters[i]->bIsCrouched;
+						Characters[i]->OnRep_IsCrouched();
+					}
+				}
+
+				TransitionManager->Tick(FixedDeltaTime);
+			}
+			BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartTime);
+		}
+		return BestSeconds / NumFrames;
+	}
+}
+
+/**
+ * The cost per simulated proxy of the crouch transitions with fps.Movement.ProxyTransitionLOD on doesn't grow from 16 to 128 to 512 proxies
+ * spread in front of a view out to twice ProxyTransitionSnapDistance, the view is given with SetViewOverride so no viewport is needed.
+ * fps.Movement.ProxyBenchmark times the same against the per component update.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSProxyTransitionGrowthTest, "FPS.Movement.Stance.ProxyTransitionGrowth",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSProxyTransitionGrowthTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSProxyTransitionTest;
+
+	IConsoleVariable* LODVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("fps.Movement.ProxyTransitionLOD"));
+	if (!TestNotNull(TEXT("fps.Movement.ProxyTransitionLOD"), LODVariable))
+	{
+		return false;
+	}
+
+	FFPSMovementTestWorld TestWorld;
+	FFPSCrouchTransitionManager* TransitionManager = FFPSCrouchTransitionManager::Get(TestWorld.World);
+	TransitionManager->SetViewOverride({ FVector::ZeroVector }, { FVector::ForwardVector });
+
+	const int32 OldLOD = LODVariable->GetInt();
+	LODVariable->Set(1);
+
+	TArray<int32> NumProxies;
+	TArray<double> FrameSeconds;
+	for (int32 Count : { 16, 128, 512 })
+	{
+		/*Spread evenly from the view to twice the snap distance, in rows so they don't overlap*/
+		TArray<AFPSCharacterBase*> Characters;
+		for (int32 i = 0; i < Count; ++i)
+		{
+			AFPSCharacterBase* Character = TestWorld.SpawnCharacter(FVector::ZeroVector);
+			UFPSCharacterMovementComponent* MovementComponent = Character ? Character->GetFPSMovementComponent() : nullptr;
+			if (!MovementComponent)
+			{
+				continue;
+			}
+
+			const float Distance = 200.f + (MovementComponent->ProxyTransitionSnapDistance * 2.f) * i / Count;
+			Character->SetActorLocation(FVector(Distance, ((i % 8) - 3.5f) * 100.f, 0.f));
+			MovementComponent->SetComponentTickEnabled(false);
+			Character->SetActorTickEnabled(false);
+			Character->Role = ROLE_SimulatedProxy;
+			Characters.Add(Character);
+		}
+
+		if (!TestEqual(TEXT("Every proxy spawned"), Characters.Num(), Count))
+		{
+			break;
+		}
+
+		NumProxies.Add(Count);
+		FrameSeconds.Add(StepTransitions(TransitionManager, Characters));
+
+		for (AFPSCharacterBase* Character : Characters)
+		{
+			TransitionManager->RemoveTransition(Character->GetFPSMovementComponent());
+			Character->Role = ROLE_Authority;
+			Character->Destroy();
+		}
+	}
+
+	LODVariable->Set(OldLOD);
+	TransitionManager->SetViewOverride({}, {});
+
+	for (int32 i = 1; i < FrameSeconds.Num(); ++i)
+	{
+		const double Growth = (FrameSeconds[0] > 0.0) ? (FrameSeconds[i] / NumProxies[i]) / (FrameSeconds[0] / NumProxies[0]) : 0.0;
+		TestTrue(FString::Printf(TEXT("Cost per proxy from %d to %d proxies grows by %.2f"), NumProxies[0], NumProxies[i], Growth), Growth <= MaxCostPerProxyGrowth);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
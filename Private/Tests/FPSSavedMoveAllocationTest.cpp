@@ -0,0 +1,64 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Tests/FPSMovementTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Ten minutes of client moves at 60 Hz with the number of unacknowledged moves going up and down like the latency does.
+ * The engine reuses the acknowledged moves from FreeMoves, new moves are only allocated during the first latency spike.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSSavedMoveAllocationTest, "FPS.Movement.Network.SavedMoveAllocation",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSSavedMoveAllocationTest::RunTest(const FString& Parameters)
+{
+	FFPSMovementTestWorld TestWorld;
+	AFPSCharacterBase* Character = TestWorld.SpawnCharacter(FVector(0.f, 0.f, 1000.f));
+	if (!TestNotNull(TEXT("Character"), Character))
+	{
+		return false;
+	}
+
+	FNetworkPredictionData_Client_Character_FPS* ClientData = static_cast<FNetworkPredictionData_Client_Character_FPS*>(Character->GetFPSMovementComponent()->GetPredictionData_Client_Character());
+	const int32 MovesPerMinute = 60 * 60;
+	const int32 NumMinutes = 10;
+
+	/*Between 2 and 30 moves in flight, 33 to 500 ms at 60 Hz, once every 20 seconds*/
+	TArray<int32> AllocatedMovesPerMinute;
+	for (int32 Frame = 0; Frame < NumMinutes * MovesPerMinute; ++Frame)
+	{
+		const int32 MaxMovesInFlight = 2 + FMath::RoundToInt(14.f * (1.f - FMath::Cos(2.f * PI * Frame / 1200.f)));
+		FSavedMovePtr Move = ClientData->CreateSavedMove();
+		if (!TestTrue(TEXT("A move is created every frame"), Move.IsValid()))
+		{
+			return false;
+		}
+
+		ClientData->SavedMoves.Push(Move);
+		while (ClientData->SavedMoves.Num() > MaxMovesInFlight)
+		{
+			ClientData->FreeMove(ClientData->SavedMoves[0]);
+			ClientData->SavedMoves.RemoveAt(0, 1, false);
+		}
+
+		if ((Frame + 1) % MovesPerMinute == 0)
+		{
+			AllocatedMovesPerMinute.Add(ClientData->NumAllocatedMoves);
+		}
+	}
+
+	TestTrue(FString::Printf(TEXT("%d moves allocated for at most 31 in use"), AllocatedMovesPerMinute[0]), AllocatedMovesPerMinute[0] <= 31);
+	for (int32 Minute = 1; Minute < NumMinutes; ++Minute)
+	{
+		TestEqual(FString::Printf(TEXT("No move allocated in minute %d"), Minute + 1), AllocatedMovesPerMinute[Minute], AllocatedMovesPerMinute[0]);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
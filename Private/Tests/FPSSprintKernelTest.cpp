@@ -0,0 +1,77 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSSprintKernel.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSSprintKernelTest
+{
+	/*The forward test IsMovingForward did before FPSSprintKernel*/
+	static bool OldIsMovingForward(float Yaw, const FVector& Acceleration)
+	{
+		const FRotator ControlRotationForward = FRotator(0.0f, Yaw, 0.0f);
+		const float DirectionDot = FVector::DotProduct(ControlRotationForward.Vector().GetSafeNormal2D(), Acceleration.GetSafeNormal2D());
+		return (DirectionDot < 0.7071f) ? false : true;
+	}
+}
+
+/**
+ * EvaluateBatch gives the same result as the single version for every entry, including the ones past the last group of 4 and chunk boundaries,
+ * zero accelerations and accelerations right on the edge of the cone. The single version matches the old test away from the edge of the cone.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSSprintKernelTest, "FPS.Movement.Sprint.ForwardKernel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSSprintKernelTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSSprintKernel;
+	using namespace FPSSprintKernelTest;
+
+	FRandomStream Stream(0);
+	for (int32 NumEntries : { 1, 3, 4, 63, 64, 67, 1000, 10000 })
+	{
+		TArray<float> Yaws, AccelX, AccelY, AccelYaws;
+		TArray<uint8> Flags, BatchResults;
+		Yaws.SetNumUninitialized(NumEntries);
+		AccelX.SetNumUninitialized(NumEntries);
+		AccelY.SetNumUninitialized(NumEntries);
+		AccelYaws.SetNumUninitialized(NumEntries);
+		Flags.SetNumUninitialized(NumEntries);
+		BatchResults.SetNumZeroed(NumEntries);
+
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			Yaws[i] = Stream.FRandRange(-720.f, 720.f);
+			AccelYaws[i] = (i % 16 == 0) ? 45.f : Stream.FRandRange(-180.f, 180.f);
+			const float AccelSize = (i % 32 == 1) ? 0.f : Stream.FRandRange(0.f, 2048.f);
+			AccelX[i] = FMath::Cos(FMath::DegreesToRadians(Yaws[i] + AccelYaws[i])) * AccelSize;
+			AccelY[i] = FMath::Sin(FMath::DegreesToRadians(Yaws[i] + AccelYaws[i])) * AccelSize;
+			Flags[i] = (uint8)Stream.RandRange(0, 7);
+		}
+
+		EvaluateBatch(Yaws.GetData(), AccelX.GetData(), AccelY.GetData(), Flags.GetData(), BatchResults.GetData(), NumEntries);
+
+		int32 NumBatchMismatches = 0;
+		int32 NumOldMismatches = 0;
+		for (int32 i = 0; i < NumEntries; ++i)
+		{
+			const bool bInCone = IsInForwardCone(Yaws[i], AccelX[i], AccelY[i]);
+			const uint8 SingleResult = (IsSprintState(Flags[i]) && bInCone) ? 1 : 0;
+			NumBatchMismatches += (BatchResults[i] != SingleResult) ? 1 : 0;
+
+			/*Rounding decides the entries right on the edge of the cone differently*/
+			const bool bNearEdge = FMath::Abs(FMath::Abs(AccelYaws[i]) - 45.f) < 0.1f;
+			NumOldMismatches += (!bNearEdge && bInCone != OldIsMovingForward(Yaws[i], FVector(AccelX[i], AccelY[i], 0.f))) ? 1 : 0;
+		}
+
+		TestEqual(FString::Printf(TEXT("The batch of %d matches the single version"), NumEntries), NumBatchMismatches, 0);
+		TestEqual(FString::Printf(TEXT("The single version matches the old test for %d entries"), NumEntries), NumOldMismatches, 0);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,104 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Tests/FPSMovementTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FPSSprintStaminaTest
+{
+	static const float DeltaTime = 1.f / 60.f;
+	static const int32 NumMoves = 4;
+
+	static void SetUpStamina(UFPSCharacterMovementComponent* Movement)
+	{
+		Movement->MaxSprintTime = 4.f;
+		Movement->SprintCooldownTime = 1.f;
+		Movement->SprintRecoveryTime = 4.f;
+		Movement->SprintRestartStamina = 0.5f;
+	}
+
+	/*Make and perform a move like ReplicateMoveToServer, it stays in the saved moves as if it was sent*/
+	static void RecordMove(UFPSCharacterMovementComponent* Movement, FNetworkPredictionData_Client_Character& ClientData)
+	{
+		ACharacter* Character = Movement->GetCharacterOwner();
+		ClientData.CurrentTimeStamp += DeltaTime;
+
+		FSavedMovePtr Move = ClientData.CreateSavedMove();
+		Move->SetMoveFor(Character, DeltaTime, FVector::ZeroVector, ClientData);
+		Movement->PerformMovement(DeltaTime);
+		Move->PostUpdate(Character, FSavedMove_Character::PostUpdate_Record);
+		ClientData.SavedMoves.Push(Move);
+	}
+}
+
+/**
+ * The server and the owning client of a character in one world, the client predicts full stamina while the server ran out.
+ * The correction of the first move reaches the client the way ClientAdjustPosition and ClientAdjustMoveState arrive,
+ * the replay of the other moves has to end with the stamina the server has after running them.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSSprintStaminaCorrectionTest, "FPS.Movement.Network.StaminaCorrection",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSSprintStaminaCorrectionTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSSprintStaminaTest;
+
+	FFPSMovementTestWorld TestWorld;
+	AFPSCharacterBase* ServerCharacter = TestWorld.SpawnCharacter(FVector(0.f, 0.f, 1000.f));
+	AFPSCharacterBase* ClientCharacter = TestWorld.SpawnCharacter(FVector(1000.f, 0.f, 1000.f));
+	if (!TestNotNull(TEXT("Server character"), ServerCharacter) || !TestNotNull(TEXT("Client character"), ClientCharacter))
+	{
+		return false;
+	}
+
+	UFPSCharacterMovementComponent* Server = ServerCharacter->GetFPSMovementComponent();
+	UFPSCharacterMovementComponent* Client = ClientCharacter->GetFPSMovementComponent();
+	SetUpStamina(Server);
+	SetUpStamina(Client);
+
+	/*Ran out a second and a half ago on the server, recovering after the cool down*/
+	Server->StaminaClock = 10.f;
+	Server->StaminaMarkTime = 8.5f;
+	Server->StaminaAtMark = 0.f;
+	Server->bStaminaDraining = false;
+	Server->bStaminaExhausted = true;
+
+	ClientCharacter->Role = ROLE_AutonomousProxy;
+	FNetworkPredictionData_Client_Character* ClientData = Client->GetPredictionData_Client_Character();
+	for (int32 i = 0; i < NumMoves; ++i)
+	{
+		RecordMove(Client, *ClientData);
+	}
+
+	/*The server corrects the first move and runs the others*/
+	const float AckedTimeStamp = ClientData->SavedMoves[0]->TimeStamp;
+	Server->PerformMovement(DeltaTime);
+	const FFPSMoveStateCorrection State = Server->MakeMoveStateCorrection();
+	for (int32 i = 1; i < NumMoves; ++i)
+	{
+		Server->PerformMovement(DeltaTime);
+	}
+
+	TestTrue(TEXT("The client predicted more stamina"), Client->GetSprintStaminaFraction() > Server->GetSprintStaminaFraction());
+
+	Client->ClientAdjustPosition_Implementation(AckedTimeStamp, ClientCharacter->GetActorLocation(), Client->Velocity, nullptr, NAME_None, false, false, Client->PackNetworkMovementMode());
+	Client->ClientAdjustMoveState(AckedTimeStamp, State);
+	Client->ClientUpdatePositionAfterServerUpdate();
+
+	TestEqual(TEXT("The replay ends with the stamina of the server"), Client->GetSprintStaminaFraction(), Server->GetSprintStaminaFraction(), KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("The replay ends exhausted like the server"), (bool)Client->bStaminaExhausted, (bool)Server->bStaminaExhausted);
+	TestEqual(TEXT("The acknowledged move is gone"), ClientData->SavedMoves.Num(), NumMoves - 1);
+
+	/*The replayed moves keep the stamina they started with, a correction without the stance of the server replays to the same place*/
+	ClientData->bUpdatePosition = true;
+	Client->ClientUpdatePositionAfterServerUpdate();
+	TestEqual(TEXT("The saved moves have the corrected stamina"), Client->GetSprintStaminaFraction(), Server->GetSprintStaminaFraction(), KINDA_SMALL_NUMBER);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,57 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Player/FPSCharacterBase.h"
+#include "Player/FPSCharacterMovementComponent.h"
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSMovementProfile.h"
+#include "Player/FPSTransitionScenario.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * The predicted stance transitions of the default character end at the same height on a client and a server ticking at different rates,
+ * so the quantized height in the move data never differs and the server never corrects the client for it.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFPSTransitionTickRateTest, "FPS.Movement.Stance.TransitionTickRate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FFPSTransitionTickRateTest::RunTest(const FString& Parameters)
+{
+	using namespace FPSCrouchKernel;
+	using namespace FPSTransitionScenario;
+
+	const FStanceMetrics& Metrics = FFPSMovementProfile::Get(AFPSCharacterBase::StaticClass())->StanceMetrics;
+	if (!TestTrue(TEXT("The default character has a crouch and a prone transition"), Metrics.CrouchInterpSpeed > 0.f && Metrics.ProneInterpSpeed > 0.f))
+	{
+		return false;
+	}
+
+	/*One step of the quantized capsule height, see UFPSCharacterMovementComponent::QuantizeCapsuleHeight*/
+	const float DriftError = (Metrics.StandingHalfHeight - Metrics.PronedHalfHeight) / 255.f;
+	const float CorrectionError = GetDefault<UFPSCharacterMovementComponent>()->MaxClientCapsuleHeightError;
+
+	const int32 NumScenarios = 200;
+	const int32 Rates[][2] = { { 144, 30 }, { 120, 60 }, { 60, 60 }, { 240, 20 } };
+	for (const int32* Rate : Rates)
+	{
+		FResult Result = { 0.f, 0, 0, 0 };
+		FRandom Random = { (uint32)(Rate[0] * 1000 + Rate[1]) };
+		FScenario Scenario;
+		for (int32 ScenarioIndex = 0; ScenarioIndex < NumScenarios; ++ScenarioIndex)
+		{
+			MakeScenario(Metrics, Rate[0], Random, Scenario);
+			RunScenario(EStepMode::Timeline, Metrics, Scenario, Rate[0], Rate[1], DriftError, CorrectionError, Result);
+		}
+
+		const FString Name = FString::Printf(TEXT("Client %d Hz, server %d Hz"), Rate[0], Rate[1]);
+		TestEqual(Name + TEXT(" never drifts by a quantization step"), Result.NumDrifts, 0);
+		TestEqual(Name + TEXT(" never corrects the height"), Result.NumCorrections, 0);
+		TestTrue(Name + FString::Printf(TEXT(" largest error %f is within the timeline tolerance"), Result.MaxError), Result.MaxError <= TimelineTolerance);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -9,6 +9,7 @@
 class UCameraComponent;
 class UCapsuleComponent;
 class UFPSHitBoxesManager;
+class UFPSCharacterMovementComponent;
 
 UCLASS()
 class FPSGAME_API AFPSCharacterBase : public ACharacter
@@ -29,12 +30,22 @@ private:
 	UPROPERTY(Category = Character, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	UFPSHitBoxesManager* HitBoxManager;
 
+	/*GetCharacterMovement() as the FPS movement component, null if the movement component was replaced with another class*/
+	UPROPERTY(Transient, DuplicateTransient)
+	UFPSCharacterMovementComponent* FPSMovementComponent;
+
 protected:
 	/* Called when the game starts or when spawned*/
 	virtual void BeginPlay() override;
 	virtual void PostInitializeComponents() override;
 
 public:
+	/*Returns the camera the player looks through*/
+	FORCEINLINE UCameraComponent* GetCameraComponent() const { return CameraComponent; }
+
+	/*Returns the movement component without a Cast, null if it isn't a UFPSCharacterMovementComponent*/
+	FORCEINLINE UFPSCharacterMovementComponent* GetFPSMovementComponent() const { return FPSMovementComponent; }
+
 	/*The default Eye height of the player, saved so we can set it when standing up after crouching*/
 	float DefaultEyeHeight;
 
@@ -42,6 +53,18 @@ public:
 	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_IsSprinting, Category = Character)
 	uint32 bIsSprinting : 1;
 
+	/*Set by character movement while prone, including the transitions into and out of it*/
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_IsProne, Category = Character)
+	uint32 bIsProne : 1;
+
+	/*Eye height when fully prone*/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Camera)
+	float PronedEyeHeight;
+
+	/*bIsCrouched, bIsSprinting and the stance progress for simulated proxies, replicated instead of them if bReplicateProxyStance is set on the movement component, see FPSProxyStance*/
+	UPROPERTY(ReplicatedUsing = OnRep_ProxyStance)
+	uint8 ProxyStance;
+
 	/** Handle Crouching replicated from server */
 	virtual void OnRep_IsCrouched() override;
 
@@ -49,6 +72,17 @@ public:
 	UFUNCTION()
 	virtual void OnRep_IsSprinting();
 
+	/** Handle prone replicated from server */
+	UFUNCTION()
+	virtual void OnRep_IsProne();
+
+	/*Unpack the stance and progress replicated from the server*/
+	UFUNCTION()
+	virtual void OnRep_ProxyStance();
+
+	/*Replicate ProxyStance or bIsCrouched and bIsSprinting depending on bReplicateProxyStance*/
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 public:	
 	/*Called every frame*/
 	virtual void Tick(float DeltaTime) override;
@@ -82,6 +116,9 @@ public:
 	void StartSprint();
 	void StopSprint();
 
+	/*PRONE, the request is processed on the next update of the CharacterMovementComponent*/
+	void ToggleProne();
+
 	/*override RecalculateBaseEyeHeight also manually set the camera height manually since it doesn't seem to be updateing
 	 *the base eye height might only be used when a camera component is not available.
 	 */
@@ -96,4 +133,8 @@ public:
 
 	/** @return true if this character is currently able to crouch (and is not currently crouched) */
 	virtual bool CanCrouch() override;
+
+protected:
+	/*Can't jump while prone, the jump gets the character up instead*/
+	virtual bool CanJumpInternal_Implementation() const override;
 };
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "WorldCollision.h"
+#include "Player/FPSCrouchKernel.h"
+#include "Player/FPSCurveSampler.h"
 #include "FPSCharacterMovementComponent.generated.h"
 
  /*Bit masks used by GetCompressedFlags() to encode movement information.
@@ -13,7 +16,9 @@
  *							FLAG_Reserved_2 = 0x08,	// Reserved for future use
  *							Remaining bit masks are available for custom flags.
  *							FLAG_Custom_0 = 0x10, // Sprinting
- *							FLAG_Custom_1 = 0x20
+ *							FLAG_Custom_1 = 0x20, // Wants to prone
+ *							FLAG_Custom_2 = 0x40, // UnCrouch deferred by the async overlap check
+ *							FLAG_Custom_3 = 0x80, // Vault started
  */
 
 //=============================================================================
@@ -37,35 +42,385 @@ enum EMovementTransition
 {
 	None,
 	Stand_to_Crouch,
-	Crouch_to_Stand
+	Crouch_to_Stand,
+	Crouch_to_Prone,
+	Prone_to_Crouch,
+	Stand_to_Prone
 };
 
+/** Custom movement modes, used with MOVE_Custom. */
+UENUM(BlueprintType)
+enum EFPSCustomMovementMode
+{
+	CMOVE_None UMETA(Hidden),
+	/*Walking on the ground with the prone capsule, see PhysProne*/
+	CMOVE_Prone,
+	/*Moving over a ledge from VaultStartLocation to VaultEndLocation, see PhysVault*/
+	CMOVE_Vault
+};
+
+/**
+ * Sprint, crouch and prone input recorded when it fires instead of only being sampled once per move, see bUseInputEdges.
+ * An edge is the wants after an input that changed them, the edges of a move are applied in order before the move is performed.
+ */
+namespace FPSInputEdge
+{
+	static const uint8 SprintBit = 0x01;
+	static const uint8 CrouchBit = 0x02;
+	static const uint8 ProneBit = 0x04;
+	static const uint8 WantsMask = SprintBit | CrouchBit | ProneBit;
+	static const int32 NumWantsBits = 3;
+
+	/*Edges kept between two moves and carried by one move, combined moves included. The count is sent in NumCountBits*/
+	static const int32 MaxEdges = 8;
+	static const int32 NumCountBits = 3;
+
+	FORCEINLINE uint8 Pack(bool bSprint, bool bCrouch, bool bProne)
+	{
+		return (bSprint ? SprintBit : 0) | (bCrouch ? CrouchBit : 0) | (bProne ? ProneBit : 0);
+	}
+
+	/*The wants in the compressed flags of a move, see FSavedMove_Character_FPS::GetCompressedFlags*/
+	FORCEINLINE uint8 FromCompressedFlags(uint8 Flags)
+	{
+		return Pack((Flags & FSavedMove_Character::FLAG_Custom_0) != 0, (Flags & FSavedMove_Character::FLAG_WantsToCrouch) != 0, (Flags & FSavedMove_Character::FLAG_Custom_1) != 0);
+	}
+}
+
+struct FFPSInputEdge
+{
+	/*The wants after the input, see FPSInputEdge*/
+	uint8 Wants;
+};
+
+typedef TArray<FFPSInputEdge, TInlineAllocator<FPSInputEdge::MaxEdges>> FFPSInputEdgeArray;
+
+/*Running totals of the input edges and the moves sent by an owning client, see fps.Movement.InputEdgeReport*/
+struct FFPSInputEdgeCounters
+{
+	FFPSInputEdgeCounters()
+		: NumRecorded(0)
+		, NumLost(0)
+		, NumSent(0)
+		, NumServerMoves(0)
+		, NumMovesWithEdges(0)
+		, NumCombinedWithEdges(0)
+		, NumCorrections(0)
+	{
+	}
+
+	uint32 NumRecorded;
+	uint32 NumLost;
+	uint32 NumSent;
+
+	/*ServerMove RPCs of any kind, and the moves among them sent with input edges*/
+	uint32 NumServerMoves;
+	uint32 NumMovesWithEdges;
+
+	/*Moves with input edges combined with the pending move*/
+	uint32 NumCombinedWithEdges;
+
+	/*Position corrections received from the server*/
+	uint32 NumCorrections;
+};
+
+/**
+ * Extra move data sent to the server in the ServerMove of the move, it is bit packed and the engine ServerMove is sent instead when there is nothing the server can't derive.
+ * The capsule height at the start of a move during a crouch or prone transition, quantized between the prone and standing height,
+ * and the input edges of the move, the compressed flags only have the wants at the start of a move with edges.
+ * The server only compares the height with its own to decide if the client has to be corrected, see MaxClientCapsuleHeightError.
+ */
+USTRUCT()
+struct FFPSNetMoveData
+{
+	GENERATED_BODY()
+
+	FFPSNetMoveData()
+		: TimeStamp(0.f)
+		, QuantizedCapsuleHeight(0)
+		, bHasCapsuleHeight(false)
+	{
+	}
+
+	/*Client time stamp of the move this belongs to, not sent, the server takes it from the ServerMove*/
+	float TimeStamp;
+
+	/*0 is the prone half height and 255 the standing half height, only valid if bHasCapsuleHeight*/
+	uint8 QuantizedCapsuleHeight;
+
+	bool bHasCapsuleHeight;
+
+	/*Input edges of the move in order, see bUseInputEdges*/
+	FFPSInputEdgeArray InputEdges;
+
+	/*returns true if there is anything to send*/
+	bool HasData() const { return bHasCapsuleHeight || InputEdges.Num() > 0; }
+
+	/*returns the number of bits this takes on the wire*/
+	int32 GetNumBits() const
+	{
+		return 1 + (bHasCapsuleHeight ? 8 : 0) + 1 + (InputEdges.Num() > 0 ? FPSInputEdge::NumCountBits + InputEdges.Num() * FPSInputEdge::NumWantsBits : 0);
+	}
+
+	/*returns false if the input edges can't come from a client, more than MaxEdges, unknown bits or an edge that doesn't change the wants starting from the compressed flags of the move*/
+	bool IsValid(uint8 CompressedFlags) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FFPSNetMoveData> : public TStructOpsTypeTraitsBase2<FFPSNetMoveData>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ * The stance transition and sprint stamina of the server sent to the owning client with a correction, the client replays its moves from them instead of its own.
+ * The timeline and the stamina are sent as the time since they started so they don't depend on the clocks of either side.
+ */
+USTRUCT()
+struct FFPSMoveStateCorrection
+{
+	GENERATED_BODY()
+
+	FFPSMoveStateCorrection()
+		: CapsuleHeight(0.f)
+		, Transition(None)
+		, TransitionElapsed(0.f)
+		, TransitionDirection(0.f)
+		, StaminaAtMark(0.f)
+		, StaminaElapsed(0.f)
+		, bStaminaDraining(false)
+		, bStaminaExhausted(false)
+	{
+	}
+
+	UPROPERTY()
+	float CapsuleHeight;
+
+	UPROPERTY()
+	TEnumAsByte<EMovementTransition> Transition;
+
+	UPROPERTY()
+	float TransitionElapsed;
+
+	UPROPERTY()
+	float TransitionDirection;
+
+	/*Stamina at the last sprint start or stop and the time since*/
+	UPROPERTY()
+	float StaminaAtMark;
+
+	UPROPERTY()
+	float StaminaElapsed;
+
+	UPROPERTY()
+	uint8 bStaminaDraining : 1;
+
+	UPROPERTY()
+	uint8 bStaminaExhausted : 1;
+};
+
+/**
+ * bIsCrouched, bIsSprinting and the stance progress packed into one byte replicated to simulated proxies, see bReplicateProxyStance.
+ * The progress only changes during a transition, so the byte is only sent on a state change or while transitioning.
+ */
+namespace FPSProxyStance
+{
+	static const uint8 CrouchedBit = 0x80;
+	static const uint8 SprintingBit = 0x40;
+
+	/*Progress 0 is the proned capsule and ProgressMask the standing one, the crouched one is in between*/
+	static const uint8 ProgressMask = 0x3F;
+
+	FORCEINLINE uint8 Pack(bool bCrouched, bool bSprinting, float Progress)
+	{
+		return (bCrouched ? CrouchedBit : 0) | (bSprinting ? SprintingBit : 0) | (uint8)FMath::RoundToInt(FMath::Clamp(Progress, 0.f, 1.f) * ProgressMask);
+	}
+
+	FORCEINLINE float UnpackProgress(uint8 Stance)
+	{
+		return (Stance & ProgressMask) / (float)ProgressMask;
+	}
+}
+
+/*How often the server replicates a character, picked from what it's doing when bAdaptiveNetUpdateFrequency is set*/
+enum class EFPSNetUpdateRate : uint8
+{
+	/*Stationary on the ground in any stance, IdleNetUpdateFrequency*/
+	Idle,
+	/*NetUpdateFrequency of the character class*/
+	Default,
+	/*Sprinting, vaulting or in a stance transition, ActiveNetUpdateFrequency*/
+	Active
+};
+
+/**
+ * A blocked uncrouch, remembered until the character moves more than UnCrouchClearanceTolerance or its floor or one of the blockers changes.
+ * Only used when bCrouchMaintainsBaseLocation, the skipped tests are sent to the server like the ones skipped by bAsyncUnCrouchCheck.
+ * Getting up from prone to crouched uses the same cache with the crouched half height.
+ */
+struct FFPSUnCrouchClearance
+{
+	FFPSUnCrouchClearance() : HalfHeight(0.f), Location(FVector::ZeroVector), bValid(false) {}
+
+	/*Unscaled half height that didn't fit*/
+	float HalfHeight;
+
+	/*Pawn location when the uncrouch was blocked*/
+	FVector Location;
+
+	TWeakObjectPtr<UPrimitiveComponent> Floor;
+	FTransform FloorTransform;
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>, TInlineAllocator<4>> Blockers;
+	TArray<FTransform, TInlineAllocator<4>> BlockerTransforms;
+
+	bool bValid;
+};
+
+/**
+ * Result of the last ledge probe, reused until the character moves more than VaultProbeTolerance, its capsule changes or the wall moves.
+ */
+struct FFPSLedgeCache
+{
+	FFPSLedgeCache() : Location(FVector::ZeroVector), HalfHeight(0.f), bCanVault(false), bValid(false) {}
+
+	/*Pawn location when probed*/
+	FVector Location;
+
+	/*Scaled capsule half height the probe was made with*/
+	float HalfHeight;
+
+	/*The primitive walked into and its transform when probed*/
+	TWeakObjectPtr<UPrimitiveComponent> Wall;
+	FTransform WallTransform;
+
+	/*Where the vault ends, only valid if bCanVault*/
+	FVector EndLocation;
+
+	bool bCanVault;
+	bool bValid;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FFPSUnCrouchBlockedSignature, bool, bBlocked);
+
 class FSavedMove_Character_FPS : public FSavedMove_Character
 {
 public:
 	typedef FSavedMove_Character Super;
+	FSavedMove_Character_FPS() : bInitialPositionSet(false), OwnerMovement(nullptr) {}
+
 	virtual void Clear() override;
 	virtual uint8 GetCompressedFlags() const override;
 	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const override;
 	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character & ClientData) override;
+	virtual void SetInitialPosition(ACharacter* C) override;
 	virtual void PrepMoveFor(ACharacter* Character) override;
+	virtual void PostUpdate(ACharacter* C, EPostUpdateMode PostUpdateMode) override;
+	virtual bool IsImportantMove(const FSavedMovePtr& LastAckedMove) const override;
 
 	uint8 bSavedWantsToSprint : 1;
+	uint8 bSavedWantsToProne : 1;
+	uint8 bSavedUnCrouchDeferred : 1;
+	uint8 bSavedVaultStarted : 1;
+
+	/*Vault state of the component at the start of the move*/
+	float SavedVaultElapsed;
+	FVector SavedVaultStartLocation;
+	FVector SavedVaultEndLocation;
+
+	/*Sprint stamina state of the component at the start of the move*/
+	float SavedStaminaClock;
+	float SavedStaminaMarkTime;
+	float SavedStaminaAtMark;
+	uint8 bSavedStaminaDraining : 1;
+	uint8 bSavedStaminaExhausted : 1;
 	float SavedCapsuleHeight;
 	TEnumAsByte<EMovementTransition> SavedTransition;
+
+	/*TransitionClock and TransitionTimeline at the start of the move*/
+	float SavedTransitionClock;
+	float SavedTransitionStartTime;
+	float SavedTransitionDirection;
+
+	/*SavedCapsuleHeight as it is sent to the server in FFPSNetMoveData*/
+	uint8 SavedQuantizedCapsuleHeight;
+
+	/*Input edges during the move, the saved wants are the ones at the start of the move when there are any*/
+	FFPSInputEdgeArray SavedInputEdges;
+
+	/*Sprint, crouch and prone wants at the start of the move packed like an input edge*/
+	uint8 GetStartInputWants() const { return FPSInputEdge::Pack(bSavedWantsToSprint, bWantsToCrouch, bSavedWantsToProne); }
+
+	/*Wants at the end of the input edges of the move*/
+	uint8 GetEndInputWants() const { return SavedInputEdges.Num() > 0 ? SavedInputEdges.Last().Wants : GetStartInputWants(); }
+
+	/*Set by SetInitialPosition, it's only called again when the move is combined with the pending move*/
+	uint8 bInitialPositionSet : 1;
+
+	/*The movement component of the prediction data the move came from, set when it's allocated and kept through Clear()*/
+	class UFPSCharacterMovementComponent* OwnerMovement;
+
+private:
+	/*OwnerMovement, or the movement component of the character for a move that wasn't allocated by FNetworkPredictionData_Client_Character_FPS*/
+	class UFPSCharacterMovementComponent* GetFPSMovement(ACharacter* Character) const;
+
+	/*Record the clocks, stamina and transition of the component as the start of the move*/
+	void SaveStanceState(class UFPSCharacterMovementComponent* FPSMov);
 };
 
 class FNetworkPredictionData_Client_Character_FPS : public FNetworkPredictionData_Client_Character
 {
 public:
-	FNetworkPredictionData_Client_Character_FPS(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {};
+	FNetworkPredictionData_Client_Character_FPS(const UCharacterMovementComponent& ClientMovement);
 	typedef FNetworkPredictionData_Client_Character Super;
+
+	/*Only called when FreeMoves is empty, the moves freed by the engine are reused from there*/
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+	/*Number of moves allocated, it stops growing once FreeMoves holds enough moves for the moves in flight*/
+	int32 NumAllocatedMoves;
+
+private:
+	/*Given to every move handed out so they don't have to Cast the movement component of the character*/
+	class UFPSCharacterMovementComponent* OwnerMovement;
 };
 
 class UCurveFloat;
 class UCapsuleComponent;
 class AFPSCharacterBase;
+class FFPSCrouchTransitionManager;
+struct FFPSMovementProfile;
+
+/**
+ * The state GetMaxSpeed and GetMaxAcceleration depend on, taken once at the end of UpdateCharacterStateBeforeMovement
+ * instead of going through the virtual state queries every time they are called during the move.
+ * It's dropped at the end of the move and whenever that state can change during it, the movement mode changing or a replicated stance,
+ * until then the queries are made as usual.
+ */
+struct FFPSMovementSnapshot
+{
+	FFPSMovementSnapshot()
+		: MaxSpeed(0.f)
+		, SprintCurve(nullptr)
+		, bIsSprinting(false)
+		, bValid(false)
+	{
+	}
+
+	/*GetMaxSpeed for the movement mode and stance*/
+	float MaxSpeed;
+
+	/*SprintAccelerationCurve while sprinting, null otherwise*/
+	const UCurveFloat* SprintCurve;
+
+	uint8 bIsSprinting : 1;
+	uint8 bValid : 1;
+};
 
 UCLASS()
 class UFPSCharacterMovementComponent : public UCharacterMovementComponent
@@ -82,6 +437,12 @@ public:
 	/* return the Max Speed for the current state. */
 	virtual float GetMaxSpeed() const override;
 
+	/** @return Maximum deceleration for the current state when braking (ie when there is no acceleration). */
+	virtual float GetMaxBrakingDeceleration() const override;
+
+	/*Prone counts as being on the ground, it's walking with a different capsule and speed*/
+	virtual bool IsMovingOnGround() const override;
+
 	/** @return Maximum acceleration for the current state. */
 	virtual float GetMaxAcceleration() const override;
 
@@ -90,6 +451,8 @@ public:
 	 */
 	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
 
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+
 	/** Get prediction data for a client game. Should not be used if not running as a client. Allocates the data on demand and can be overridden to allocate a custom override if desired. Result must be a FNetworkPredictionData_Client_Character. */
 	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
 
@@ -103,16 +466,136 @@ public:
 
 	virtual void SetUpdatedComponent(USceneComponent* NewUpdatedComponent) override;
 	virtual void PostLoad() override;
+	virtual void BeginPlay() override;
+	virtual void OnUnregister() override;
 
 	AFPSCharacterBase* GetFPSOwner() { return FPSCharacterOwner; }
 
+	/*Called when bIsCrouched is replicated to a simulated proxy, starts the transition so the proxy isn't updated while idle*/
+	void OnProxyCrouchReplicated();
+
+	/*Called when bIsSprinting is replicated to a simulated proxy, changes the smoothing to suit the speed*/
+	void OnProxySprintReplicated();
+
+	/*Called when bIsProne is replicated to a simulated proxy, goes straight to the prone or crouched capsule*/
+	void OnProxyProneReplicated();
+
+	/*Called when the ProxyStance of the character is replicated to a simulated proxy, moves a running transition to the replicated progress*/
+	void OnProxyStanceProgressReplicated(float Progress);
+
+	/*Pack the stance into ProxyStance on the character, the server does this after every state update when bReplicateProxyStance is set*/
+	void UpdateProxyStance();
+
+	/*Capsule and eye height metrics of the owner, from the class defaults and the crouch and prone settings of this component, only valid if HasValidData()*/
+	const FFPSMovementProfile& GetMovementProfile();
+
+	/*The state of the current move, only valid between UpdateCharacterStateBeforeMovement and a change of the state or the end of the move*/
+	FORCEINLINE const FFPSMovementSnapshot& GetMovementSnapshot() const { return MovementSnapshot; }
+
+	/*Take the snapshot from the current state*/
+	void UpdateMovementSnapshot();
+
+	/*Go back to querying the state until the next snapshot, call this after changing the sprint or stance outside of the movement update*/
+	FORCEINLINE void InvalidateMovementSnapshot() { MovementSnapshot.bValid = false; }
+
+	/**
+	 * true while moves are replayed after a correction, only the last replayed frame is seen so the camera, mesh offset
+	 * and overlap events are updated once when the replay is done instead of on every replayed transition frame.
+	 */
+	FORCEINLINE bool ShouldDeferCosmeticUpdates() const { return bClientUpdating; }
+
+	/*Remember that the camera height has to be updated when the replay is done*/
+	void DeferEyeHeightUpdate();
+
+	/*Remember the last capsule adjustment of the replay for the mesh offset, this also updates the camera height*/
+	void DeferCapsuleAdjusted(float HalfHeightAdjust, float ScaledHalfHeightAdjust);
+
+	/*Replay the camera, mesh and overlap updates skipped during the replay*/
+	void FlushCosmeticUpdates();
+
+	/*Replays the unacknowledged moves after a correction, then applies the cosmetic updates of the final state once*/
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+
+	/*Applies the input edges of the move before performing it, see bUseInputEdges*/
+	virtual void PerformMovement(float DeltaTime) override;
+
 protected:
 	/**FPS Character movement component belongs to */
 	UPROPERTY(Transient, DuplicateTransient)
 	AFPSCharacterBase* FPSCharacterOwner = nullptr;
 
+	/*Cached profile of the owner class, fetched again when the profiles are invalidated or the crouch and prone settings change*/
+	TSharedPtr<const FFPSMovementProfile> MovementProfile;
+
+	FFPSMovementSnapshot MovementSnapshot;
+
+	/*Cosmetic updates skipped during a replay, see ShouldDeferCosmeticUpdates()*/
+	float PendingHalfHeightAdjust;
+	float PendingScaledHalfHeightAdjust;
+	uint8 bPendingEyeHeightUpdate : 1;
+	uint8 bPendingCapsuleAdjusted : 1;
+	uint8 bPendingOverlapUpdate : 1;
+
+	/*GetMaxSpeed from the current state without the snapshot*/
+	float CalcMaxSpeed() const;
+
 	virtual bool IsMovingForward();
 
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+
+	/*Set up the floor and base like walking when entering prone, the engine clears them for every custom mode*/
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+	/**
+	 * Prone movement, this is walking with the prone capsule: the same floor checks, step ups and walking off ledges but with MaxWalkSpeedProne.
+	 * The capsule stays upright so the engine floor and step logic works unchanged on slopes, it's as short as it can be (a sphere at the default PronedHalfHeight).
+	 */
+	virtual void PhysProne(float deltaTime, int32 Iterations);
+
+	/*Process a move received from the client on the server, compares the FFPSNetMoveData received with the move to the state of the server*/
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+
+	/*Sends the moves with their FFPSNetMoveData when there is any, see ServerMoveWithData*/
+	virtual void CallServerMove(const class FSavedMove_Character* NewMove, const class FSavedMove_Character* OldMove) override;
+
+	/*Also corrects the client when the capsule height of its transition is too far from the one of the server*/
+	virtual bool ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+	/*Sends the stance of the server along with a correction, see ClientAdjustMoveState*/
+	virtual void SendClientAdjustment() override;
+
+	/*Takes the stance of the server when it came with this correction*/
+	virtual void OnClientCorrectionReceived(class FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+
+	/*Fill in the extra data of a move, the height is only sent if it's different from the last acknowledged move. returns false if there is nothing to send*/
+	bool MakeNetMoveData(const FSavedMove_Character_FPS& Move, const FSavedMove_Character_FPS* LastAckedMove, FFPSNetMoveData& OutMoveData);
+
+	/*Keep the move data received with a ServerMove for MoveAutonomous*/
+	void ReceiveNetMoveData(const FFPSNetMoveData& MoveData, float TimeStamp);
+
+	/*ServerMove with the FFPSNetMoveData of the move*/
+	UFUNCTION(unreliable, server, WithValidation)
+	void ServerMoveWithData(const FFPSNetMoveData& MoveData, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+
+	/*ServerMoveOld with the FFPSNetMoveData of the old move, so the input edges of an important move that was lost are resent*/
+	UFUNCTION(unreliable, server, WithValidation)
+	void ServerMoveOldWithData(const FFPSNetMoveData& MoveData, float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags);
+
+	/*ServerMoveDual, or ServerMoveDualHybridRootMotion if bHybridRootMotion, with the FFPSNetMoveData of both moves*/
+	UFUNCTION(unreliable, server, WithValidation)
+	void ServerMoveDualWithData(bool bHybridRootMotion, const FFPSNetMoveData& PendingMoveData, const FFPSNetMoveData& MoveData, float TimeStamp0, FVector_NetQuantize10 InAccel0, uint8 PendingFlags, uint32 View0, float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 NewFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+
+	/*Move data received with the ServerMove being processed, oldest first*/
+	TArray<FFPSNetMoveData, TInlineAllocator<2>> PendingNetMoveData;
+
+	/*Set when a move arrived with a capsule height further than MaxClientCapsuleHeightError from the server, the next error check corrects the client*/
+	uint8 bClientMoveStateMismatch : 1;
+
+	/*Last stance received from the server and the correction it belongs to, the replay starts from it if it came with the last correction*/
+	FFPSMoveStateCorrection MoveStateCorrection;
+	float MoveStateCorrectionTimeStamp;
+	float LastCorrectionTimeStamp;
+
 	/**
 	 * Event triggered at the end of a movement update. If scoped movement updates are enabled (bEnableScopedMovementUpdates), this is within such a scope.
 	 * If that is not desired, bind to the CharacterOwner's OnMovementUpdated event instead, as that is triggered after the scoped movement update.
@@ -128,6 +611,88 @@ public:
 	/*used for crouch eye height calculations*/
 	float InternalCapsuleHeight;
 
+	/**
+	 * The predicted transition as the transition clock time it started and its direction, the height is computed from the clock
+	 * so the client and the server end up at the same height however their moves were split. See FPSCrouchKernel.
+	 */
+	FPSCrouchKernel::FTransitionTimeline TransitionTimeline;
+
+	/*Sum of the delta times of the moves like StaminaClock, starts over at 0 whenever there is no transition*/
+	float TransitionClock;
+
+	/*Input edges of the move about to be performed, PerformMovement applies them and clears them*/
+	FFPSInputEdgeArray MoveInputEdges;
+
+	/*Input edges and moves of the owning client so far, see fps.Movement.InputEdgeReport*/
+	FFPSInputEdgeCounters InputEdgeCounters;
+
+	/*Move the input edges recorded since the last move into the new move, the wants go back to where they were before the first edge*/
+	void TakeInputEdges(FSavedMove_Character_FPS& Move);
+
+	/*Set the sprint, crouch and prone wants from an input edge*/
+	void ApplyInputWants(uint8 Wants);
+
+	/*The stance and stamina of the server sent to the owning client with the correction of the move at TimeStamp*/
+	UFUNCTION(unreliable, client)
+	void ClientAdjustMoveState(float TimeStamp, const FFPSMoveStateCorrection& State);
+
+	/*The stance and stamina of the server for the current state*/
+	FFPSMoveStateCorrection MakeMoveStateCorrection() const;
+
+	/*Set when the stance of the server arrived with a correction, the first replayed move starts from it*/
+	uint8 bApplyMoveStateCorrection : 1;
+
+	/*Set during a replay that started from the stance of the server, the replayed moves record the stance they start with instead of going back to the saved one*/
+	uint8 bMoveStateCorrected : 1;
+
+	/*Take the stance of the server at the start of the move being replayed*/
+	void ApplyMoveStateCorrection();
+
+	/*Quantize a capsule half height between the prone (0) and standing (255) half height for sending it over the network*/
+	uint8 QuantizeCapsuleHeight(float HalfHeight);
+	float DequantizeCapsuleHeight(uint8 QuantizedHalfHeight);
+
+	/*The client is corrected when the capsule height at the start of a move during a transition is further than this from the one of the server, the server keeps its own height*/
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly, meta = (ClampMin = "0", UIMin = "0"))
+	float MaxClientCapsuleHeightError;
+
+	/**
+	 * Let the movement set NetUpdateFrequency of the character on the server from what it's doing, see EFPSNetUpdateRate.
+	 * A sprint or stance change is sent right away with ForceNetUpdate so a character at the idle rate doesn't start late on the proxies.
+	 * fps.Movement.AdaptiveNetUpdate turns it off to compare.
+	 */
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly)
+	uint8 bAdaptiveNetUpdateFrequency : 1;
+
+	/*NetUpdateFrequency while stationary on the ground and not sprinting, vaulting or transitioning*/
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly, meta = (ClampMin = "1", UIMin = "1", EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float IdleNetUpdateFrequency;
+
+	/*NetUpdateFrequency while sprinting, vaulting or in a stance transition*/
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly, meta = (ClampMin = "1", UIMin = "1", EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float ActiveNetUpdateFrequency;
+
+	/*Rate the character is replicated at, only changed on the server*/
+	FORCEINLINE EFPSNetUpdateRate GetNetUpdateRate() const { return NetUpdateRate; }
+
+	/**
+	 * Record sprint, crouch and prone input on the owning client as edges, in order, instead of only sampling the wants once per move.
+	 * The edges since the last move are carried by the next one and sent in FFPSNetMoveData, the client and the server run the state update
+	 * for each of them before the move, so input changing back within a frame isn't lost and a move with input changes can still be combined
+	 * with the pending move. A move with edges is important so it's resent with the next one. fps.Movement.InputEdges turns it off to compare.
+	 */
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly)
+	uint8 bUseInputEdges : 1;
+
+	/*Sprint, crouch and prone wants packed like an input edge, see FPSInputEdge*/
+	uint8 GetInputWants() const;
+
+	/*Called after input changed the wants, records an edge on the owning client if they're different from PreviousWants. See FFPSInputEdgeScope*/
+	void RecordInputEdge(uint8 PreviousWants);
+
+	/*Pick the net update rate from the current state and send sprint and stance changes right away, the server does this after every state update*/
+	void UpdateNetUpdateRate();
+
 public:
 	/* does the character want to sprint, set to true from StartSpriting.
 	 * set to true in StartSprint and false in StopSprint.
@@ -135,16 +700,59 @@ public:
 	 */
 	uint8 bWantsToSprint : 1;
 
-	//#TODO add a cool down timer
-	/*Max sprint time before cool down sets in, -1 for unlimited NOT USED FOR NOW*/
+	/*Seconds of sprinting on full stamina before the cool down sets in, -1 for unlimited*/
 	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Sprint)
 	float MaxSprintTime;
 
+	/*Seconds after running out of stamina before it starts to recover*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Sprint, meta = (ClampMin = "0", UIMin = "0"))
+	float SprintCooldownTime;
+
+	/*Seconds for the stamina to recover from empty to full*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Sprint, meta = (ClampMin = "0", UIMin = "0"))
+	float SprintRecoveryTime;
+
+	/*Fraction of the stamina that has to be back before sprinting again after running out*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Sprint, meta = (ClampMin = "0", ClampMax = "1", UIMin = "0", UIMax = "1"))
+	float SprintRestartStamina;
+
+	/*returns true if the character is able to sprint now, bCanSprint and enough stamina left*/
+	UFUNCTION(BlueprintCallable, Category = Sprint)
+	bool CanSprint() const;
+
+	/*Remaining sprint stamina from 0 to 1, always 1 if MaxSprintTime is unlimited*/
+	UFUNCTION(BlueprintCallable, Category = Sprint)
+	float GetSprintStaminaFraction() const;
+
+	/**
+	 * The stamina is kept as its value at the last change (sprint start or stop, running out) and the stamina clock at that change,
+	 * the current value is computed from the clock so nothing is updated every frame.
+	 * The clock is the sum of the delta times of the moves, the same on the client and the server, and starts over at 0 whenever
+	 * the stamina is full. The stance transitions have their own clock, see TransitionClock.
+	 */
+	float StaminaClock;
+	float StaminaMarkTime;
+	float StaminaAtMark;
+	uint8 bStaminaDraining : 1;
+	uint8 bStaminaExhausted : 1;
+
+protected:
+	/*Stamina in seconds of sprinting at this stamina clock time*/
+	float GetSprintStamina(float Time) const;
+
+	/*Start draining or recovering from the stamina at the current clock*/
+	void MarkSprintStamina(bool bDraining);
+
+	/*Advance the stamina and the transition clock by a move, each starts over on its own when nothing depends on it*/
+	void AdvanceMovementClocks(float DeltaSeconds);
+
+public:
+
 	/*set the max speed to the normal Walking walking speed multiplied by this amount when sprinting*/
 	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
 	float MaxSprintSpeed;
 
-	/** The maximum ground speed when walking and crouched. */
+	/** The maximum ground speed when prone. */
 	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
 	float MaxWalkSpeedProne;
 
@@ -158,12 +766,31 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Sprint")
 	UCurveFloat* SprintAccelerationCurve;
 
+	/*How the SprintAccelerationCurve is evaluated, the curve is baked at BeginPlay*/
+	UPROPERTY(EditDefaultsOnly, Category = "Sprint")
+	EFPSCurveSampleMode SprintCurveSampleMode;
+
+	/*Largest allowed difference between the baked SprintAccelerationCurve and the curve, the next more accurate mode is used if it's over*/
+	UPROPERTY(EditDefaultsOnly, Category = "Sprint", meta = (ClampMin = "0", UIMin = "0"))
+	float SprintCurveMaxError;
+
+	/*Simulated proxies use this NetworkSimulatedSmoothLocationTime while sprinting, 0 to keep the same smoothing*/
+	UPROPERTY(Category = "Character Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float ProxySprintSmoothLocationTime;
+
+	/*Bake the SprintAccelerationCurve again, call this if the curve is changed during play*/
+	void BakeSprintAccelerationCurve();
+
 	/** If true, this Pawn is capable of sprinting. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementProperties)
 	uint8 bCanSprint : 1;
 
 	virtual bool IsSprinting() const;
 
+protected:
+	/*SprintAccelerationCurve baked over the 0-1 speed range*/
+	FFPSCurveSampler SprintCurveSampler;
+
 public:
 	/*This is set to true along side bWantsToCrouch or when bIsCrouched is replicated to the SimulatedProxy
 	 *Set to false when crouching is completed and doesn't need to call Crouch or Uncrouch everytick.
@@ -173,7 +800,186 @@ public:
 	/*The Time taken to crouch, the change in height doesn't matter since its calculated*/
 	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Crouch, meta = (ClampMin = "0.1"))
 	float CrouchTime;
+
+	/**
+	 * While an uncrouch is blocked, test the standing capsule with async overlaps that are read on the next update,
+	 * the synchronous tests in ExpandCapsule only run again once the async test finds room.
+	 * Only used when bCrouchMaintainsBaseLocation, the server follows the decision of the client (FLAG_Custom_2) so both stand up on the same move.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay)
+	uint8 bAsyncUnCrouchCheck : 1;
+
+	/*Remember a blocked uncrouch and skip the capsule tests until the character or what blocked it moves, off by default*/
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay)
+	uint8 bUseUnCrouchClearanceCache : 1;
+
+	/*How far the character can move before a remembered blocked uncrouch is tested again*/
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay, meta = (ClampMin = "0.1", UIMin = "0.1", EditCondition = "bUseUnCrouchClearanceCache"))
+	float UnCrouchClearanceTolerance;
+
+	/*Called with true when standing up is blocked and with false once the character stood up or doesn't want to stand anymore*/
+	UPROPERTY(BlueprintAssignable, Category = Crouch)
+	FFPSUnCrouchBlockedSignature OnUnCrouchBlockedChanged;
+
+	/*returns true if the last try to stand up was blocked*/
+	UFUNCTION(BlueprintCallable, Category = Crouch)
+	bool IsUnCrouchBlocked() const { return bUnCrouchBlocked; }
+
+	/*true if UnCrouch waited for the async overlap during this move*/
+	uint8 bUnCrouchDeferred : 1;
+
+	/*Deferral of the move being replayed on the client or received from the client on the server*/
+	uint8 bUnCrouchDeferredByMove : 1;
+
+	/*Simulated proxies further than this from every local camera skip the crouch transition and go to the final height, 0 to never skip*/
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float ProxyTransitionSnapDistance;
+
+	/*Simulated proxies further than this from every local camera or behind all of them update their transition at ProxyTransitionReducedRateInterval, 0 to always update every frame*/
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float ProxyTransitionReducedRateDistance;
+
+	/*Seconds between the transition updates of reduced rate simulated proxies*/
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float ProxyTransitionReducedRateInterval;
+
+	/**
+	 * Replicate ProxyStance to simulated proxies instead of bIsCrouched and bIsSprinting, one byte with the crouch progress,
+	 * so a proxy follows the transition of the server instead of only starting its own when the crouch state changes.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = Crouch, AdvancedDisplay)
+	uint8 bReplicateProxyStance : 1;
 	
+	/*does the character want to be prone, set by ToggleProne on the character and sent to the server as FLAG_Custom_1*/
+	uint8 bWantsToProne : 1;
+
+	/*Unscaled half height of the capsule when prone, the capsule radius is used if it's smaller than that*/
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = Prone, meta = (ClampMin = "0", UIMin = "0"))
+	float PronedHalfHeight;
+
+	/*The Time taken to go between crouched and prone, going prone from standing takes CrouchTime on top of this*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Prone, meta = (ClampMin = "0.1"))
+	float ProneTime;
+
+	/*returns true if in the prone movement mode*/
+	UFUNCTION(BlueprintCallable, Category = Prone)
+	bool IsProne() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Prone; }
+
+	/*returns true if the character can go prone now, only on the ground*/
+	virtual bool CanProneInCurrentState() const;
+
+	/*Lower the capsule height towards the prone height, the capsule is shrunk once it's there*/
+	virtual void Prone(float DeltaTime);
+
+	/*Grow the capsule to the crouched height and raise the height to it, stays prone if the crouched capsule doesn't fit*/
+	virtual void UnProne(float DeltaTime);
+
+	/*Eye height for a capsule half height anywhere between prone and standing*/
+	float GetStanceEyeHeight(float HalfHeight);
+
+	/**
+	 * Set InternalCapsuleHeight and the eye height from TransitionTimeline at the end of the move, shared by Crouch, UnCrouch, Prone and UnProne.
+	 * Prone goes at the crouch speed above the crouched height and the prone speed below it, the timeline is started again from the current height
+	 * at the start of the move when the height isn't on it.
+	 * @param	bCrouch		Crouch and UnCrouch, the whole height goes at the crouch speed, it's clamped to the current capsule radius
+	 *						and the eye height is only set during the stand and crouch transition
+	 * @return	true once the target is reached
+	 */
+	bool UpdateTransitionHeight(float TargetHalfHeight, float DeltaTime, bool bCrouch);
+
+	/** If true, this Pawn is capable of vaulting over ledges by jumping while walking forward into them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Vault)
+	uint8 bCanVault : 1;
+
+	/*Lowest ledge above the feet that is vaulted instead of stepped up or jumped*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Vault, meta = (ClampMin = "0", UIMin = "0"))
+	float MinVaultHeight;
+
+	/*Highest ledge above the feet that can be vaulted*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Vault, meta = (ClampMin = "0", UIMin = "0"))
+	float MaxVaultHeight;
+
+	/*Seconds the vault takes from the start to standing on the ledge*/
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = Vault, meta = (ClampMin = "0.05", UIMin = "0.05"))
+	float VaultTime;
+
+	/*Height from the start (0) to the ledge (1) over the time of the vault (0-1), eased out over the first half if none is set.
+	 *The character moves over the ledge in the second half, the curve should be at 1 by then*/
+	UPROPERTY(EditDefaultsOnly, Category = Vault)
+	UCurveFloat* VaultHeightCurve;
+
+	/*How the VaultHeightCurve is evaluated, the curve is baked at BeginPlay with SprintCurveMaxError*/
+	UPROPERTY(EditDefaultsOnly, Category = Vault)
+	EFPSCurveSampleMode VaultCurveSampleMode;
+
+	/*Seconds between the ledge probes while walking forward into a wall, the probes of the characters are staggered over this*/
+	UPROPERTY(EditDefaultsOnly, Category = Vault, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0"))
+	float VaultProbeInterval;
+
+	/*How far the character can move along a wall before the ledge is probed again*/
+	UPROPERTY(EditDefaultsOnly, Category = Vault, AdvancedDisplay, meta = (ClampMin = "0.1", UIMin = "0.1"))
+	float VaultProbeTolerance;
+
+	/*returns true if the last ledge probe found a ledge to vault over from here, for prompts*/
+	UFUNCTION(BlueprintCallable, Category = Vault)
+	bool CanVault() const;
+
+	/*returns true while vaulting*/
+	UFUNCTION(BlueprintCallable, Category = Vault)
+	bool IsVaulting() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Vault; }
+
+	/*Bake the VaultHeightCurve again, call this if the curve is changed during play*/
+	void BakeVaultHeightCurve();
+
+	/*Vaults over the ledge in front instead of jumping when there is one*/
+	virtual bool DoJump(bool bReplayingMoves) override;
+
+	/*Vault state, the elapsed time is advanced by PhysVault and saved with the moves*/
+	float VaultElapsed;
+	FVector VaultStartLocation;
+	FVector VaultEndLocation;
+
+	/*true if a vault was started since the last saved move*/
+	uint8 bVaultStarted : 1;
+
+	/*Vault start of the move being replayed on the client or received from the client on the server*/
+	uint8 bVaultStartedByMove : 1;
+
+	/*Number of ledge probe queries made, for the benchmark*/
+	int32 NumLedgeQueries;
+
+protected:
+	/*Walls walked into are remembered for the ledge probe*/
+	virtual void HandleImpact(const FHitResult& Hit, float TimeSlice = 0.f, const FVector& MoveDelta = FVector::ZeroVector) override;
+
+	virtual void PhysVault(float deltaTime, int32 Iterations);
+
+	/*returns true if there is a ledge to vault over past the wall, from the cache if it still applies*/
+	bool FindLedge(const FHitResult& WallHit, FVector& OutEndLocation);
+
+	/*Sweep down onto the top of the wall and test the capsule there, two queries at most*/
+	bool ProbeLedge(const FHitResult& WallHit, FVector& OutEndLocation);
+
+	/*returns true if the cached probe was made from here*/
+	bool IsLedgeCached() const;
+
+	/*Switch to the vault mode towards the end location*/
+	void StartVault(const FVector& EndLocation);
+
+	/*Last wall walked into, valid until the next UpdateCharacterStateBeforeMovement*/
+	FHitResult VaultWallHit;
+	uint8 bHasVaultWallHit : 1;
+
+	/*Counts down to the next background ledge probe*/
+	float VaultProbeTimer;
+
+	FFPSLedgeCache LedgeCache;
+
+	/*VaultHeightCurve baked over the 0-1 vault time*/
+	FFPSCurveSampler VaultCurveSampler;
+
+public:
+
 	/**
 	 * Checks if new capsule size fits (no encroachment), and call CharacterOwner->OnStartCrouch() if successful.
 	 * In general you should set bWantsToCrouch instead to have the crouch persist during movement, or just use the crouch functions on the owning Character.
@@ -186,4 +992,86 @@ public:
 	 * @param	bClientSimulation	true when called when bIsCrouched is replicated to non owned clients, to update collision cylinder and offset.
 	 */
 	virtual void UnCrouch(bool bClientSimulation = false, float DeltaTime = 0.0f);
+
+protected:
+	/*returns true if UnCrouch or UnProne should keep the capsule this move without testing the larger one, see bAsyncUnCrouchCheck*/
+	bool ShouldDeferUnCrouch(float TargetHalfHeight);
+
+	/*Set the blocked state and broadcast OnUnCrouchBlockedChanged if it changed, replays don't broadcast*/
+	void SetUnCrouchBlocked(bool bBlocked);
+
+	/*Remember the blocked uncrouch at the current location, finds the blockers of the target capsule*/
+	void RecordUnCrouchClearance(float TargetHalfHeight);
+
+	/*returns true if the remembered blocked uncrouch still applies*/
+	bool IsUnCrouchClearanceCached() const;
+
+	FFPSUnCrouchClearance UnCrouchClearance;
+	uint8 bUnCrouchBlocked : 1;
+
+	/*returns true if the decisions the client makes during a move (uncrouch deferral, vault start) are taken from the move instead of tested here*/
+	bool IsDecisionFromMove() const;
+
+	/*Start the async overlaps of the target capsule, they are read by ShouldDeferUnCrouch on the next update*/
+	void RequestUnCrouchOverlap(float TargetHalfHeight);
+
+	/*Overlap at the expanded location and, on the ground, the one moved down to the floor that ExpandCapsule also tries*/
+	FTraceHandle UnCrouchOverlapHandles[2];
+
+	/*Unscaled half height the pending overlaps test*/
+	float UnCrouchOverlapHalfHeight;
+
+protected:
+	friend class FFPSCrouchTransitionManager;
+
+	/*NetworkSimulatedSmoothLocationTime when not sprinting*/
+	float ProxyDefaultSmoothLocationTime;
+
+	/*NetUpdateFrequency and MinNetUpdateFrequency of the character at BeginPlay, used for EFPSNetUpdateRate::Default*/
+	float DefaultNetUpdateFrequency;
+	float DefaultMinNetUpdateFrequency;
+
+	EFPSNetUpdateRate NetUpdateRate;
+
+	/*Crouched, sprinting and prone the last time UpdateNetUpdateRate ran, a change is sent with ForceNetUpdate*/
+	uint8 LastNetUpdateStance;
+
+	/*Input edges recorded since the last move, a ring buffer oldest first from RecordedInputEdgeHead, the oldest is dropped when it's full*/
+	FFPSInputEdge RecordedInputEdges[FPSInputEdge::MaxEdges];
+	int32 RecordedInputEdgeHead;
+	int32 NumRecordedInputEdges;
+
+	/*The wants before the oldest recorded edge*/
+	uint8 RecordedInputStartWants;
+
+	/*Index into the FFPSCrouchTransitionManager of this world while the simulated proxy is transitioning, INDEX_NONE otherwise*/
+	int32 ProxyTransitionIndex;
+
+	/*Called by the transition manager when the simulated proxy starts a transition, sets the capsule size to the default size*/
+	virtual void BeginProxyTransition(bool bCrouch);
+
+	/*Called by the transition manager when the simulated proxy reached the final height, shrink the capsule if crouched*/
+	virtual void FinishProxyTransition(float FinalHalfHeight, float FinalEyeHeight);
+};
+
+/*Records an input edge for the sprint, crouch and prone wants changed during its lifetime, see UFPSCharacterMovementComponent::bUseInputEdges*/
+struct FFPSInputEdgeScope
+{
+	FFPSInputEdgeScope(UFPSCharacterMovementComponent* InMovement)
+		: Movement(InMovement)
+		, PreviousWants(InMovement ? InMovement->GetInputWants() : 0)
+	{
+	}
+
+	~FFPSInputEdgeScope()
+	{
+		if (Movement)
+		{
+			Movement->RecordInputEdge(PreviousWants);
+		}
+	}
+
+private:
+	UFPSCharacterMovementComponent* Movement;
+	uint8 PreviousWants;
 };
\ No newline at end of file
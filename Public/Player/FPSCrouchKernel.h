@@ -0,0 +1,281 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+/**
+ * The crouch and prone capsule math of the movement component and the character without any engine types.
+ * Only plain structs and floats, nothing is allocated and nothing outside of this header is used, so the same code
+ * the game runs can be built and timed on its own. Step advances a transition by one frame, StepBatch does the same for the crouch
+ * transitions of many simulated proxies from packed arrays, written without branches so it vectorizes.
+ * fps.Movement.CrouchKernelBenchmark compares the two in the engine and Benchmarks/FPSCrouchKernelBenchmark.cpp with Google Benchmark without it.
+ *
+ * The predicted transitions of the autonomous proxy and the server use a timeline instead, the height is a function of the time since the transition started
+ * so it doesn't depend on how the time was split into frames and moves. The stance time is how far along the stand, crouch, prone path
+ * a height is in seconds, 0 standing and the crouch time plus the prone time when prone. Going down it's Time - StartTime and going up StartTime - Time.
+ * FPS.Movement.Stance.TransitionTickRate tests that the timeline ends at the same height at different tick rates, BM_TransitionTickRate
+ * in Benchmarks/FPSCrouchKernelBenchmark.cpp counts how often the two drift apart.
+ */
+namespace FPSCrouchKernel
+{
+	/*Same as SMALL_NUMBER, a distance to the target with a smaller square is done*/
+	static const float DoneDistanceSquared = 1.e-8f;
+
+	/*A height this close to where the timeline puts it is on the timeline, far below what can be seen or sent to the server*/
+	static const float TimelineTolerance = 0.01f;
+
+	/*Stance heights of a character class, see FFPSMovementProfile for where they come from*/
+	struct FStanceMetrics
+	{
+		float StandingHalfHeight;
+		float CrouchedHalfHeight;
+		float PronedHalfHeight;
+
+		/*The capsule never gets shorter than its radius*/
+		float MinHalfHeight;
+
+		float CrouchedEyeHeight;
+		float PronedEyeHeight;
+
+		/*Change in half height per second above and below the crouched height*/
+		float CrouchInterpSpeed;
+		float ProneInterpSpeed;
+
+		/*Change in eye height per unit of half height above the crouched height*/
+		float EyeHeightSlope;
+
+		/*1 / (CrouchedHalfHeight - PronedHalfHeight), 0 if the heights are the same*/
+		float InvProneHeightRange;
+	};
+
+	/*A capsule half height during a transition and the eye height that goes with it*/
+	struct FStanceState
+	{
+		float HalfHeight;
+		float EyeHeight;
+	};
+
+	/*How much shorter a capsule is than another, what ACharacter::OnStartCrouch gets*/
+	struct FCapsuleAdjust
+	{
+		float HalfHeightAdjust;
+		float ScaledHalfHeightAdjust;
+	};
+
+	/*A transition in closed form, the start time is rebased whenever the transition is interrupted or turns around*/
+	struct FTransitionTimeline
+	{
+		/*Time the stance time was 0 at*/
+		float StartTime;
+
+		/*1 going down towards prone, -1 going up towards standing, 0 if there is no transition*/
+		float Direction;
+	};
+
+	/**
+	 * Crouch transitions of Count characters as packed arrays, all indexed the same way.
+	 * Heights and EyeHeights are updated in place, the rest is only read.
+	 */
+	struct FTransitionBatch
+	{
+		float* Heights;
+		float* EyeHeights;
+		const float* TargetHeights;
+		const float* MinHeights;
+		const float* InterpSpeeds;
+		const float* CrouchedHalfHeights;
+		const float* CrouchedEyeHeights;
+		const float* EyeHeightSlopes;
+		const float* DeltaTimes;
+		int Count;
+	};
+
+	inline float Min(float A, float B) { return A < B ? A : B; }
+	inline float Max(float A, float B) { return A > B ? A : B; }
+	inline float Clamp(float X, float Low, float High) { return X < Low ? Low : (X < High ? X : High); }
+
+	/*Same as FMath::FInterpConstantTo*/
+	inline float InterpConstantTo(float Current, float Target, float DeltaTime, float InterpSpeed)
+	{
+		const float Dist = Target - Current;
+		if (Dist * Dist < DoneDistanceSquared)
+		{
+			return Target;
+		}
+
+		const float Step = InterpSpeed * DeltaTime;
+		return Current + Clamp(Dist, -Step, Step);
+	}
+
+	/*Eye height of the part of the transition between standing and crouched, it's linear to the capsule height*/
+	inline float GetLinearEyeHeight(float HalfHeight, float CrouchedHalfHeight, float CrouchedEyeHeight, float EyeHeightSlope)
+	{
+		return CrouchedEyeHeight + (HalfHeight - CrouchedHalfHeight) * EyeHeightSlope;
+	}
+
+	/*Eye height for any capsule height between standing and prone*/
+	inline float GetEyeHeight(const FStanceMetrics& Metrics, float HalfHeight)
+	{
+		if (HalfHeight >= Metrics.CrouchedHalfHeight)
+		{
+			return GetLinearEyeHeight(HalfHeight, Metrics.CrouchedHalfHeight, Metrics.CrouchedEyeHeight, Metrics.EyeHeightSlope);
+		}
+
+		const float NormalisedAlpha = (HalfHeight - Metrics.PronedHalfHeight) * Metrics.InvProneHeightRange;
+		return Metrics.PronedEyeHeight + NormalisedAlpha * (Metrics.CrouchedEyeHeight - Metrics.PronedEyeHeight);
+	}
+
+	/**
+	 * Move the capsule height towards the target for one frame and update the eye height.
+	 * The stand and crouch part of the height goes at the crouch speed and the rest at the prone speed, a frame crossing the crouched height stops on it.
+	 * @return	true if the target has been reached
+	 */
+	inline bool Step(const FStanceMetrics& Metrics, FStanceState& State, float TargetHalfHeight, float DeltaTime)
+	{
+		const float CrouchedHalfHeight = Metrics.CrouchedHalfHeight;
+		const bool bAboveCrouched = State.HalfHeight > CrouchedHalfHeight || (State.HalfHeight == CrouchedHalfHeight && TargetHalfHeight > CrouchedHalfHeight);
+		const float StepTarget = bAboveCrouched ? Max(TargetHalfHeight, CrouchedHalfHeight) : Min(TargetHalfHeight, CrouchedHalfHeight);
+		const float InterpSpeed = bAboveCrouched ? Metrics.CrouchInterpSpeed : Metrics.ProneInterpSpeed;
+
+		State.HalfHeight = Max(Metrics.MinHalfHeight, InterpConstantTo(State.HalfHeight, StepTarget, DeltaTime, InterpSpeed));
+		State.EyeHeight = GetEyeHeight(Metrics, State.HalfHeight);
+		return State.HalfHeight == TargetHalfHeight;
+	}
+
+	/*Step the crouch transitions of the whole batch, the same as InterpConstantTo and GetLinearEyeHeight on each of them*/
+	inline void StepBatch(const FTransitionBatch& Batch)
+	{
+		float* __restrict Height = Batch.Heights;
+		float* __restrict EyeHeight = Batch.EyeHeights;
+		const float* __restrict TargetHeight = Batch.TargetHeights;
+		const float* __restrict MinHeight = Batch.MinHeights;
+		const float* __restrict InterpSpeed = Batch.InterpSpeeds;
+		const float* __restrict CrouchedHalfHeight = Batch.CrouchedHalfHeights;
+		const float* __restrict CrouchedEyeHeight = Batch.CrouchedEyeHeights;
+		const float* __restrict EyeHeightSlope = Batch.EyeHeightSlopes;
+		const float* __restrict DeltaTime = Batch.DeltaTimes;
+
+		for (int i = 0; i < Batch.Count; ++i)
+		{
+			const float Dist = TargetHeight[i] - Height[i];
+			const float Step = InterpSpeed[i] * DeltaTime[i];
+			const float NewHeight = (Dist * Dist < DoneDistanceSquared) ? TargetHeight[i] : Height[i] + Clamp(Dist, -Step, Step);
+
+			Height[i] = Max(MinHeight[i], NewHeight);
+			EyeHeight[i] = GetLinearEyeHeight(Height[i], CrouchedHalfHeight[i], CrouchedEyeHeight[i], EyeHeightSlope[i]);
+		}
+	}
+
+	/*What Crouch and UnCrouch step with, the whole height goes at the crouch speed and the capsule never gets shorter than its current radius*/
+	inline FStanceMetrics GetCrouchMetrics(const FStanceMetrics& Metrics, float CapsuleRadius)
+	{
+		FStanceMetrics CrouchMetrics = Metrics;
+		CrouchMetrics.MinHalfHeight = Max(0.f, CapsuleRadius);
+		CrouchMetrics.ProneInterpSpeed = Metrics.CrouchInterpSpeed;
+		return CrouchMetrics;
+	}
+
+	/*Seconds from standing to crouched, 0 if it's instant*/
+	inline float GetCrouchDuration(const FStanceMetrics& Metrics)
+	{
+		return Metrics.CrouchInterpSpeed > 0.f ? (Metrics.StandingHalfHeight - Metrics.CrouchedHalfHeight) / Metrics.CrouchInterpSpeed : 0.f;
+	}
+
+	/*Seconds from standing to the half height, the crouch part at the crouch speed and the rest at the prone speed*/
+	inline float GetStanceTime(const FStanceMetrics& Metrics, float HalfHeight)
+	{
+		if (HalfHeight >= Metrics.CrouchedHalfHeight)
+		{
+			return Metrics.CrouchInterpSpeed > 0.f ? (Metrics.StandingHalfHeight - HalfHeight) / Metrics.CrouchInterpSpeed : 0.f;
+		}
+
+		const float ProneTime = Metrics.ProneInterpSpeed > 0.f ? (Metrics.CrouchedHalfHeight - HalfHeight) / Metrics.ProneInterpSpeed : 0.f;
+		return GetCrouchDuration(Metrics) + ProneTime;
+	}
+
+	/*The half height at a stance time, the inverse of GetStanceTime*/
+	inline float GetHalfHeightAtStanceTime(const FStanceMetrics& Metrics, float StanceTime)
+	{
+		const float CrouchDuration = GetCrouchDuration(Metrics);
+		const float HalfHeight = (StanceTime <= CrouchDuration)
+			? Metrics.StandingHalfHeight - Max(0.f, StanceTime) * Metrics.CrouchInterpSpeed
+			: Max(Metrics.PronedHalfHeight, Metrics.CrouchedHalfHeight - (StanceTime - CrouchDuration) * Metrics.ProneInterpSpeed);
+		return Max(Metrics.MinHalfHeight, HalfHeight);
+	}
+
+	/*A timeline from the half height towards the target starting at this time*/
+	inline FTransitionTimeline StartTimeline(const FStanceMetrics& Metrics, float HalfHeight, float TargetHalfHeight, float Time)
+	{
+		const float Direction = HalfHeight > TargetHalfHeight ? 1.f : -1.f;
+		return { Time - Direction * GetStanceTime(Metrics, HalfHeight), Direction };
+	}
+
+	/*returns true if the timeline is heading to the target and has the half height at this time, otherwise it has to be started again from the height*/
+	inline bool IsOnTimeline(const FStanceMetrics& Metrics, const FTransitionTimeline& Timeline, float HalfHeight, float TargetHalfHeight, float Time)
+	{
+		if (Timeline.Direction == 0.f || (Timeline.Direction > 0.f) != (HalfHeight > TargetHalfHeight))
+		{
+			return false;
+		}
+
+		const float TimelineHalfHeight = GetHalfHeightAtStanceTime(Metrics, Timeline.Direction * (Time - Timeline.StartTime));
+		const float Error = TimelineHalfHeight - HalfHeight;
+		return Error <= TimelineTolerance && Error >= -TimelineTolerance;
+	}
+
+	/**
+	 * The height and eye height of the timeline at this time, stopping at the target.
+	 * @return	true if the target has been reached
+	 */
+	inline bool Evaluate(const FStanceMetrics& Metrics, const FTransitionTimeline& Timeline, float TargetHalfHeight, float Time, FStanceState& OutState)
+	{
+		const float TargetStanceTime = GetStanceTime(Metrics, TargetHalfHeight);
+		const float StanceTime = Timeline.Direction * (Time - Timeline.StartTime);
+		const bool bReachedTarget = Timeline.Direction > 0.f ? StanceTime >= TargetStanceTime : StanceTime <= TargetStanceTime;
+
+		OutState.HalfHeight = bReachedTarget ? Max(Metrics.MinHalfHeight, TargetHalfHeight) : GetHalfHeightAtStanceTime(Metrics, StanceTime);
+		OutState.EyeHeight = GetEyeHeight(Metrics, OutState.HalfHeight);
+		return bReachedTarget;
+	}
+
+	/**
+	 * Advance a predicted transition by a move ending at Time, the timeline is started again if the height isn't on it at the start of the move.
+	 * @param	bOutStarted		set to true if the timeline was started again
+	 * @return	true if the target has been reached, the timeline is cleared then
+	 */
+	inline bool StepTimeline(const FStanceMetrics& Metrics, FTransitionTimeline& Timeline, FStanceState& State, float TargetHalfHeight, float Time, float DeltaTime, bool& bOutStarted)
+	{
+		const float MoveStartTime = Time - DeltaTime;
+		bOutStarted = !IsOnTimeline(Metrics, Timeline, State.HalfHeight, TargetHalfHeight, MoveStartTime);
+		if (bOutStarted)
+		{
+			Timeline = StartTimeline(Metrics, State.HalfHeight, TargetHalfHeight, MoveStartTime);
+		}
+
+		const bool bReachedTarget = Evaluate(Metrics, Timeline, TargetHalfHeight, Time, State);
+		if (bReachedTarget)
+		{
+			Timeline.Direction = 0.f;
+		}
+
+		return bReachedTarget;
+	}
+
+	/*How much shorter the capsule is than the reference height, before and after the component scale*/
+	inline FCapsuleAdjust GetCapsuleAdjust(float ReferenceHalfHeight, float HalfHeight, float ComponentScale)
+	{
+		const float HalfHeightAdjust = ReferenceHalfHeight - HalfHeight;
+		return { HalfHeightAdjust, HalfHeightAdjust * ComponentScale };
+	}
+
+	/*Relative Z of the camera, it's moved down with the capsule when the base location is kept during the transition*/
+	inline float GetCameraZ(float EyeHeight, float ScaledHalfHeightAdjust, bool bCrouchMaintainsBaseLocation)
+	{
+		return bCrouchMaintainsBaseLocation ? EyeHeight - ScaledHalfHeightAdjust : EyeHeight;
+	}
+
+	/*Relative Z of the mesh or the base translation, it's moved up by the amount the capsule has shrunk*/
+	inline float GetMeshZ(float DefaultMeshZ, float HalfHeightAdjust)
+	{
+		return DefaultMeshZ + HalfHeightAdjust;
+	}
+}
@@ -0,0 +1,108 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+
+class UWorld;
+class AActor;
+class UFPSCharacterMovementComponent;
+
+/**
+ * Advances the crouch/stand transitions of every simulated proxy in a world in one pass per frame.
+ * The transition state is kept in contiguous arrays so the per frame interpolation only touches floats,
+ * the owning actors are only written to when a transition finishes or when the character is being viewed through.
+ * The autonomous proxy and the server still run the transition inside the movement update since it needs to be predicted.
+ *
+ * Transitions are updated by how far they are from the local cameras (fps.Movement.ProxyTransitionLOD),
+ * near ones every frame, ones past ProxyTransitionReducedRateDistance or behind every camera every ProxyTransitionReducedRateInterval
+ * and ones past ProxyTransitionSnapDistance go straight to the final height. The distances are set on the movement component.
+ */
+class FFPSCrouchTransitionManager : public FTickableGameObject
+{
+public:
+	FFPSCrouchTransitionManager(UWorld* InWorld);
+	virtual ~FFPSCrouchTransitionManager();
+
+	/*returns the manager for this world, one is created the first time it's needed*/
+	static FFPSCrouchTransitionManager* Get(UWorld* World);
+
+	/*Start a transition for the simulated proxy or change the direction of the current one, bCrouch is where we are heading to*/
+	void AddTransition(UFPSCharacterMovementComponent* MovementComponent, bool bCrouch);
+
+	/*Move a running transition to this height, it carries on towards its target from there*/
+	void SetTransitionHeight(UFPSCharacterMovementComponent* MovementComponent, float Height);
+
+	/*Stop updating the transition, the character is left where it is*/
+	void RemoveTransition(UFPSCharacterMovementComponent* MovementComponent);
+
+	/*Use these views instead of the local cameras, for benchmarks and tests without a viewport. Empty arrays go back to the cameras*/
+	void SetViewOverride(const TArray<FVector>& Locations, const TArray<FVector>& Directions);
+
+	/*number of transitions currently being updated*/
+	int32 Num() const { return Components.Num(); }
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Components.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return World.Get(); }
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+private:
+	/*Location and direction of the cameras of the local players*/
+	struct FViewInfo
+	{
+		TArray<const AActor*, TInlineAllocator<4>> Targets;
+		TArray<FVector, TInlineAllocator<4>> Locations;
+		TArray<FVector, TInlineAllocator<4>> Directions;
+	};
+
+	void GatherViews(FViewInfo& OutViews) const;
+
+	/*Squared distance to the closest camera, bOutBehind is true if it's behind every camera*/
+	static float GetViewDistanceSquared(const FViewInfo& Views, const FVector& Location, bool& bOutBehind);
+
+	void FinishTransition(int32 Index);
+	void RemoveAtSwap(int32 Index);
+
+	static void OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources);
+
+	TWeakObjectPtr<UWorld> World;
+
+	/*set with SetViewOverride, used instead of the local cameras when not empty*/
+	TArray<FVector> OverrideViewLocations;
+	TArray<FVector> OverrideViewDirections;
+
+	/*All of these are indexed the same way, the movement component keeps its index in ProxyTransitionIndex*/
+	TArray<TWeakObjectPtr<UFPSCharacterMovementComponent>> Components;
+
+	/*only used to compare against the view targets, never dereferenced*/
+	TArray<const AActor*> Owners;
+
+	/*same as InternalCapsuleHeight on the movement component*/
+	TArray<float> Heights;
+	TArray<float> TargetHeights;
+	TArray<float> MinHeights;
+	TArray<float> InterpSpeeds;
+
+	/*eye height is linear to the capsule height, EyeHeight = CrouchedEyeHeight + (Height - CrouchedHalfHeight) * EyeHeightSlope*/
+	TArray<float> EyeHeights;
+	TArray<float> CrouchedHalfHeights;
+	TArray<float> CrouchedEyeHeights;
+	TArray<float> EyeHeightSlopes;
+
+	/*true if heading towards the crouched height*/
+	TArray<bool> bCrouching;
+
+	/*time not yet applied to a reduced rate transition, and the time it's advanced by this frame*/
+	TArray<float> PendingDeltaTimes;
+	TArray<float> StepTimes;
+
+	/*distance thresholds copied from the movement component, 0 disables the tier*/
+	TArray<float> SnapDistancesSquared;
+	TArray<float> ReducedRateDistancesSquared;
+	TArray<float> ReducedRateIntervals;
+};
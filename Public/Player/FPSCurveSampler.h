@@ -0,0 +1,97 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FPSCurveSampler.generated.h"
+
+class UCurveFloat;
+
+/** How a curve with a 0-1 domain is evaluated during movement. */
+UENUM(BlueprintType)
+enum class EFPSCurveSampleMode : uint8
+{
+	/*Evaluate the source curve every time, a key search per evaluation*/
+	Curve,
+	/*Uniformly sampled table over 0-1 with linear interpolation*/
+	LookupTable,
+	/*Piecewise cubic fit over 0-1 evaluated without branches, smoother than the table with fewer values*/
+	Polynomial
+};
+
+/**
+ * A curve baked once over the 0-1 domain so it can be evaluated without a key search or allocations.
+ * Inputs outside of 0-1 are passed to the source curve so its extrapolation is kept, the result is the same as UCurveFloat::GetFloatValue.
+ * Bake() measures the error against the source curve and falls back to a more accurate mode if the error is too large.
+ */
+struct FFPSCurveSampler
+{
+	/*Number of intervals in the lookup table*/
+	static const int32 NumTableIntervals = 64;
+
+	/*Number of cubic segments in the polynomial fit*/
+	static const int32 NumSegments = 8;
+
+	FFPSCurveSampler();
+
+	/**
+	 * Bake the curve in the requested mode.
+	 * @param	MaxError	largest allowed difference from the source curve, if it's exceeded the next more accurate mode is used
+	 * @return	the mode that was baked, Curve if the source curve has to be evaluated directly
+	 */
+	EFPSCurveSampleMode Bake(const UCurveFloat* Curve, EFPSCurveSampleMode RequestedMode, float MaxError);
+
+	/*Forget the baked curve*/
+	void Reset();
+
+	/*returns true if the curve has been baked into a table or polynomial*/
+	FORCEINLINE bool IsBakedFrom(const UCurveFloat* Curve) const { return SourceCurve == Curve && Mode != EFPSCurveSampleMode::Curve; }
+
+	/*Largest error against the source curve found while baking*/
+	FORCEINLINE float GetMaxError() const { return MaxError; }
+
+	/*Evaluate the baked curve, only valid if IsBakedFrom() is true*/
+	FORCEINLINE float Evaluate(float Time) const
+	{
+		if (Time < 0.f || Time > 1.f)
+		{
+			return EvaluateSource(Time);
+		}
+		return (Mode == EFPSCurveSampleMode::Polynomial) ? EvaluatePolynomial(Time) : EvaluateTable(Time);
+	}
+
+	/*The table and the polynomial clamp to 0-1, Evaluate() handles the inputs outside of it*/
+
+	FORCEINLINE float EvaluateTable(float Time) const
+	{
+		const float Position = FMath::Clamp(Time, 0.f, 1.f) * NumTableIntervals;
+		const int32 Index = FMath::Min(FMath::TruncToInt(Position), NumTableIntervals - 1);
+		const float Alpha = Position - Index;
+		return Table[Index] + (Table[Index + 1] - Table[Index]) * Alpha;
+	}
+
+	FORCEINLINE float EvaluatePolynomial(float Time) const
+	{
+		const float Position = FMath::Clamp(Time, 0.f, 1.f) * NumSegments;
+		const int32 Segment = FMath::Min(FMath::TruncToInt(Position), NumSegments - 1);
+		const float U = Position - Segment;
+		const float* C = Coefficients[Segment];
+		return ((C[3] * U + C[2]) * U + C[1]) * U + C[0];
+	}
+
+private:
+	/*Evaluate the source curve, used outside of the baked 0-1 domain*/
+	float EvaluateSource(float Time) const;
+
+	/*Largest difference against the source curve, sampled at a higher resolution than the table*/
+	float MeasureError(const UCurveFloat* Curve, EFPSCurveSampleMode TestMode) const;
+
+	float Table[NumTableIntervals + 1];
+
+	/*c0 + c1*u + c2*u^2 + c3*u^3 for each segment, u is 0-1 within the segment*/
+	float Coefficients[NumSegments][4];
+
+	const UCurveFloat* SourceCurve;
+	EFPSCurveSampleMode Mode;
+	float MaxError;
+};
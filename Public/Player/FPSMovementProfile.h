@@ -0,0 +1,111 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Player/FPSCrouchKernel.h"
+
+class UClass;
+class ACharacter;
+
+/**
+ * Class default capsule and eye height metrics of a character class, used by the crouch and prone transitions.
+ * Built once from the class default object the first time the class is used instead of going through the CDO every frame.
+ * A character whose eye heights or whose movement component's CrouchedHalfHeight, PronedHalfHeight, CrouchTime or ProneTime were changed at runtime
+ * gets its own profile built from its values instead, see FMovementSettings. The profiles are rebuilt after a hot reload or when the defaults are edited in the editor.
+ */
+struct FFPSMovementProfile
+{
+	/*The values of the character and its movement component a profile is built from, they can be changed on an instance at runtime*/
+	struct FMovementSettings
+	{
+		float CrouchedHalfHeight;
+		float PronedHalfHeight;
+		float CrouchTime;
+		float ProneTime;
+		float DefaultEyeHeight;
+		float CrouchedEyeHeight;
+		float PronedEyeHeight;
+
+		/*Takes the values of the character and its movement component, the ones a plain ACharacter or UCharacterMovementComponent doesn't have are 0*/
+		static FMovementSettings Get(const ACharacter* Character);
+
+		bool operator==(const FMovementSettings& Other) const
+		{
+			return CrouchedHalfHeight == Other.CrouchedHalfHeight && PronedHalfHeight == Other.PronedHalfHeight
+				&& CrouchTime == Other.CrouchTime && ProneTime == Other.ProneTime && DefaultEyeHeight == Other.DefaultEyeHeight
+				&& CrouchedEyeHeight == Other.CrouchedEyeHeight && PronedEyeHeight == Other.PronedEyeHeight;
+		}
+
+		bool operator!=(const FMovementSettings& Other) const { return !(*this == Other); }
+	};
+
+	/*Unscaled half height of the default (standing) capsule*/
+	float StandingHalfHeight;
+
+	/*Unscaled half height of the crouched capsule, CrouchedHalfHeight of the default movement component*/
+	float CrouchedHalfHeight;
+
+	/*Unscaled half height of the prone capsule, PronedHalfHeight of the default movement component but never less than the radius*/
+	float PronedHalfHeight;
+
+	/*Unscaled radius of the default capsule*/
+	float CapsuleRadius;
+
+	/*Relative Z location of the default mesh, only valid if bHasMesh*/
+	float DefaultMeshZ;
+
+	/*BaseTranslationOffset.Z of the default character, used when there is no mesh*/
+	float DefaultBaseTranslationZ;
+
+	/*Eye height when standing, DefaultEyeHeight of the character or the camera location of the class default object*/
+	float DefaultEyeHeight;
+
+	/*Eye height when fully crouched*/
+	float CrouchedEyeHeight;
+
+	/*Eye height when fully prone*/
+	float PronedEyeHeight;
+
+	/*Change in half height per second during a crouch transition, (StandingHalfHeight - CrouchedHalfHeight) / CrouchTime*/
+	float CrouchInterpSpeed;
+
+	/*1 / (StandingHalfHeight - CrouchedHalfHeight), 0 if the heights are the same*/
+	float InvCrouchHeightRange;
+
+	/*Change in eye height per unit of half height, (DefaultEyeHeight - CrouchedEyeHeight) * InvCrouchHeightRange*/
+	float EyeHeightSlope;
+
+	/*Change in half height per second during a prone transition, (CrouchedHalfHeight - PronedHalfHeight) / ProneTime*/
+	float ProneInterpSpeed;
+
+	/*1 / (CrouchedHalfHeight - PronedHalfHeight), 0 if the heights are the same*/
+	float InvProneHeightRange;
+
+	/*1 / (StandingHalfHeight - PronedHalfHeight), the range a capsule height is quantized over for the network*/
+	float InvCapsuleHeightRange;
+
+	/*The heights and speeds above as the crouch kernel takes them*/
+	FPSCrouchKernel::FStanceMetrics StanceMetrics;
+
+	/*The movement values this was built from*/
+	FMovementSettings Settings;
+
+	/*The default character has a mesh*/
+	bool bHasMesh;
+
+	/*The cache generation this was built in, see GetGeneration()*/
+	uint32 Generation;
+
+	/*Returns the profile of the character class, it's built the first time the class is used*/
+	static TSharedRef<const FFPSMovementProfile> Get(const UClass* CharacterClass);
+
+	/*Returns the profile of the class if it was built from the same settings, otherwise a new one that is not cached*/
+	static TSharedRef<const FFPSMovementProfile> Get(const UClass* CharacterClass, const FMovementSettings& Settings);
+
+	/*Incremented every time the profiles are invalidated, holders of a profile should fetch it again when it changes*/
+	static uint32 GetGeneration();
+
+	/*Throw away all of the profiles, they are rebuilt the next time they are needed*/
+	static void InvalidateAll();
+};
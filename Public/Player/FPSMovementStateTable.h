@@ -0,0 +1,74 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The sprint and stance decisions of UpdateCharacterStateBeforeMovement as lookup tables.
+ * The state of a character is packed into a key of input bits and the action is read from a table built once from a
+ * priority ordered list of rules, so the update is one lookup and a switch however many states there are.
+ * A new state adds an input bit and rules, not branches. FPS.Movement.StateTable.MatchesIfChains checks every key against the if chain the tables replaced.
+ */
+namespace FPSMovementStateTable
+{
+	/*Bits of the stance key*/
+	enum EStanceInput : uint8
+	{
+		Stance_WantsProne = 0x01,		// bWantsToProne && CanProneInCurrentState()
+		Stance_IsProne = 0x02,			// bIsProne on the character
+		Stance_InProneMode = 0x04,		// IsProne(), the movement mode is CMOVE_Prone
+		Stance_Transitioning = 0x08,	// CurrentTransition != None
+		Stance_CanCrouch = 0x10,		// CanCrouchInCurrentState()
+		Stance_WantsCrouch = 0x20,		// bWantsToCrouch
+		Stance_IsCrouching = 0x40,		// IsCrouching()
+		Stance_WantsSprint = 0x80		// bWantsToSprint
+	};
+
+	enum class EStanceAction : uint8
+	{
+		None,
+		Prone,
+		/*Already prone, only the movement mode has to be set again after landing*/
+		EnterProneMode,
+		UnProne,
+		Crouch,
+		UnCrouch
+	};
+
+	/*Bits of the sprint key*/
+	enum ESprintInput : uint8
+	{
+		Sprint_IsSprinting = 0x01,
+		Sprint_WantsSprint = 0x02,
+		Sprint_OnGround = 0x04,
+		Sprint_MovingForward = 0x08,
+		Sprint_CanSprint = 0x10,
+		Sprint_WantsLowStance = 0x20,	// bWantsToCrouch || bWantsToProne
+		Sprint_IdleStance = 0x40		// not crouching, prone or transitioning
+	};
+
+	enum class ESprintAction : uint8
+	{
+		None,
+		Stop,
+		/*Stop and forget the sprint input, crouching or going prone cancels the sprint*/
+		StopAndClearWants,
+		/*Sprinting wins over the low stance inputs, the sprint starts once the character is standing*/
+		ClearLowStance,
+		ClearLowStanceAndStart
+	};
+
+	static const int32 NumStanceKeys = 256;
+	static const int32 NumSprintKeys = 128;
+
+	extern const EStanceAction* StanceActions;
+	extern const ESprintAction* SprintActions;
+
+	FORCEINLINE EStanceAction GetStanceAction(uint32 Key) { return StanceActions[Key & (NumStanceKeys - 1)]; }
+	FORCEINLINE ESprintAction GetSprintAction(uint32 Key) { return SprintActions[Key & (NumSprintKeys - 1)]; }
+
+	/*returns the action of the first matching rule, this is what the tables are built from*/
+	EStanceAction EvaluateStanceRules(uint32 Key);
+	ESprintAction EvaluateSprintRules(uint32 Key);
+}
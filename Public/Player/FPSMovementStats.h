@@ -0,0 +1,137 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Engine/EngineTypes.h"
+
+class UFPSCharacterMovementComponent;
+
+/**
+ * Movement stats, use "stat FPSMovement" to show them.
+ * The cycle counters are per phase, the whole movement update of a character is also split by the net role it runs as.
+ */
+DECLARE_STATS_GROUP(TEXT("FPSMovement"), STATGROUP_FPSMovement, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Authority"), STAT_FPSMovement_UpdateAuthority, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Autonomous Proxy"), STAT_FPSMovement_UpdateAutonomous, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Simulated Proxy"), STAT_FPSMovement_UpdateSimulated, STATGROUP_FPSMovement, );
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateCharacterStateBeforeMovement"), STAT_FPSMovement_UpdateState, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crouch"), STAT_FPSMovement_Crouch, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UnCrouch"), STAT_FPSMovement_UnCrouch, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prone"), STAT_FPSMovement_Prone, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UnProne"), STAT_FPSMovement_UnProne, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PhysProne"), STAT_FPSMovement_PhysProne, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PhysVault"), STAT_FPSMovement_PhysVault, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ledge Probe"), STAT_FPSMovement_LedgeProbe, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ShrinkCapsule"), STAT_FPSMovement_ShrinkCapsule, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ExpandCapsule"), STAT_FPSMovement_ExpandCapsule, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnMovementUpdated Proxy"), STAT_FPSMovement_ProxyUpdate, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Proxy Transitions"), STAT_FPSMovement_ProxyTransitions, STATGROUP_FPSMovement, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Correction Replay"), STAT_FPSMovement_CorrectionReplay, STATGROUP_FPSMovement, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Crouch Calls"), STAT_FPSMovement_CrouchCalls, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("UnCrouch Calls"), STAT_FPSMovement_UnCrouchCalls, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ShrinkCapsule Calls"), STAT_FPSMovement_ShrinkCapsuleCalls, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ExpandCapsule Calls"), STAT_FPSMovement_ExpandCapsuleCalls, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxy Updates"), STAT_FPSMovement_ProxyUpdates, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxy Updates Skipped"), STAT_FPSMovement_ProxyUpdatesSkipped, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shrink Overlap Queries"), STAT_FPSMovement_ShrinkQueries, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Expand Overlap Queries"), STAT_FPSMovement_ExpandQueries, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Async Expand Overlap Queries"), STAT_FPSMovement_AsyncExpandQueries, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("UnCrouch Deferred"), STAT_FPSMovement_UnCrouchDeferred, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("UnCrouch Clearance Cache Hits"), STAT_FPSMovement_UnCrouchClearanceHits, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("UnCrouch Clearance Cache Misses"), STAT_FPSMovement_UnCrouchClearanceMisses, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ledge Probe Queries"), STAT_FPSMovement_LedgeQueries, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ledge Cache Hits"), STAT_FPSMovement_LedgeCacheHits, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ledge Cache Misses"), STAT_FPSMovement_LedgeCacheMisses, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Vaults Started"), STAT_FPSMovement_VaultsStarted, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Move Data Sent"), STAT_FPSMovement_NetMoveDataSent, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Move Data Bits Sent"), STAT_FPSMovement_NetMoveDataBits, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Move Data Height Mismatches"), STAT_FPSMovement_NetMoveDataRejected, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Update Rate Changes"), STAT_FPSMovement_NetUpdateRateChanges, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net Updates Forced"), STAT_FPSMovement_NetUpdatesForced, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Edges Recorded"), STAT_FPSMovement_InputEdgesRecorded, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Edges Lost"), STAT_FPSMovement_InputEdgesLost, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Edges Sent"), STAT_FPSMovement_InputEdgesSent, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Edge Moves Combined"), STAT_FPSMovement_InputEdgeMovesCombined, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Combined Transition Moves"), STAT_FPSMovement_CombinedTransitionMoves, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transition Timeline Starts"), STAT_FPSMovement_TransitionTimelineStarts, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Client Corrections"), STAT_FPSMovement_ClientCorrections, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Stance Corrections Applied"), STAT_FPSMovement_MoveStateCorrections, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Replayed Moves"), STAT_FPSMovement_ReplayedMoves, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Cosmetic Updates Deferred"), STAT_FPSMovement_CosmeticUpdatesDeferred, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Saved Moves Allocated"), STAT_FPSMovement_SavedMovesAllocated, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxy Transitions Skipped"), STAT_FPSMovement_ProxyTransitionsSkipped, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxy Transitions Snapped"), STAT_FPSMovement_ProxyTransitionsSnapped, STATGROUP_FPSMovement, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxy Stance Changes"), STAT_FPSMovement_ProxyStanceChanges, STATGROUP_FPSMovement, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Proxy Transitions Active"), STAT_FPSMovement_ProxyTransitionsActive, STATGROUP_FPSMovement, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Proxy Stance Height Error"), STAT_FPSMovement_ProxyStanceHeightError, STATGROUP_FPSMovement, );
+
+/*returns the cycle stat for the movement update of a character with this role*/
+FORCEINLINE TStatId GetFPSMovementRoleStatId(ENetRole Role)
+{
+	switch (Role)
+	{
+	case ROLE_AutonomousProxy:
+		return GET_STATID(STAT_FPSMovement_UpdateAutonomous);
+	case ROLE_SimulatedProxy:
+		return GET_STATID(STAT_FPSMovement_UpdateSimulated);
+	default:
+		return GET_STATID(STAT_FPSMovement_UpdateAuthority);
+	}
+}
+
+/**
+ * Records the movement cost of every character each frame and writes the costliest ones to a csv file,
+ * so hot spots can be found on a dedicated server without attaching a profiler.
+ * Enabled with fps.Movement.ProfileCharacters 1, the file is written to Saved/Profiling/FPSMovement-<date>.csv
+ * with the columns Frame,Rank,Character,Role,Microseconds,Updates.
+ */
+class FFPSMovementCharacterProfiler
+{
+public:
+	/*returns true if the characters are being recorded*/
+	static FORCEINLINE bool IsEnabled() { return bEnabled; }
+
+	/*Add the time spent on a movement update of this character to the current frame*/
+	static void AddCycles(const UFPSCharacterMovementComponent* MovementComponent, uint32 Cycles);
+
+	/*Opens or closes the csv file when fps.Movement.ProfileCharacters changes*/
+	static void OnConsoleVariablesChanged();
+
+	/*Writes the costliest characters of the frame*/
+	static void OnEndFrame();
+
+	/*The csv file being written, empty when the profiler is off*/
+	static const FString& GetFilename();
+
+private:
+	static bool bEnabled;
+};
+
+/** Adds the time spent in the scope to the character when the character profiler is enabled, also counts it to the stat of the role. */
+struct FFPSMovementCharacterScope
+{
+	FFPSMovementCharacterScope(const UFPSCharacterMovementComponent* InMovementComponent, ENetRole Role)
+		: RoleCycleCounter(GetFPSMovementRoleStatId(Role))
+		, MovementComponent(FFPSMovementCharacterProfiler::IsEnabled() ? InMovementComponent : nullptr)
+		, StartCycles(MovementComponent ? FPlatformTime::Cycles() : 0)
+	{
+	}
+
+	~FFPSMovementCharacterScope()
+	{
+		if (MovementComponent)
+		{
+			FFPSMovementCharacterProfiler::AddCycles(MovementComponent, FPlatformTime::Cycles() - StartCycles);
+		}
+	}
+
+private:
+	FScopeCycleCounter RoleCycleCounter;
+	const UFPSCharacterMovementComponent* MovementComponent;
+	uint32 StartCycles;
+};
@@ -0,0 +1,60 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The forward test of the sprint without a square root, usable for one character or many at once.
+ * Sprinting is allowed while the 2D acceleration is within 45 degrees of the control yaw, dot(Forward, Accel) >= 0.7071 * |Accel|,
+ * tested as Dot >= 0 && Dot^2 >= 0.7071^2 * |Accel|^2. The batch gives the same results as the single version.
+ */
+namespace FPSSprintKernel
+{
+	/*Cosine of the half angle of the cone*/
+	static const float ForwardConeCos = 0.7071f;
+	static const float ForwardConeCosSquared = ForwardConeCos * ForwardConeCos;
+
+	/*Accelerations with a smaller squared size count as zero, same as GetSafeNormal2D*/
+	static const float MinAccelerationSizeSquared = SMALL_NUMBER;
+
+	/*Bits of the state flags passed to EvaluateBatch*/
+	enum EStateFlags : uint8
+	{
+		State_OnGround = 0x01,
+		State_CanSprint = 0x02,
+		State_Crouching = 0x04
+	};
+
+	/*returns true if the acceleration is in the forward cone of the unit forward vector*/
+	FORCEINLINE bool IsInForwardCone(float ForwardX, float ForwardY, float AccelX, float AccelY)
+	{
+		const float Dot = ForwardX * AccelX + ForwardY * AccelY;
+		const float SizeSquared = AccelX * AccelX + AccelY * AccelY;
+		return SizeSquared >= MinAccelerationSizeSquared && Dot >= 0.f && Dot * Dot >= ForwardConeCosSquared * SizeSquared;
+	}
+
+	/*returns true if the acceleration is in the forward cone of the yaw in degrees*/
+	FORCEINLINE bool IsInForwardCone(float Yaw, float AccelX, float AccelY)
+	{
+		float ForwardX, ForwardY;
+		FMath::SinCos(&ForwardY, &ForwardX, FMath::DegreesToRadians(Yaw));
+		return IsInForwardCone(ForwardX, ForwardY, AccelX, AccelY);
+	}
+
+	/*returns true if the state flags allow sprinting, on the ground, able to sprint and not crouching*/
+	FORCEINLINE bool IsSprintState(uint8 Flags)
+	{
+		return (Flags & (State_OnGround | State_CanSprint | State_Crouching)) == (State_OnGround | State_CanSprint);
+	}
+
+	/**
+	 * Evaluate the sprint test for Count characters from packed arrays, the forward cone is tested 4 at a time.
+	 * Nothing in the game calls it, every movement component tests its own character in UpdateCharacterStateBeforeMovement.
+	 * It's kept as a benchmarked kernel, see fps.Movement.SprintKernelBenchmark.
+	 * @param	Yaws		control yaw of each character in degrees
+	 * @param	Flags		EStateFlags of each character
+	 * @param	OutResults	1 if the character can sprint, 0 otherwise
+	 */
+	void EvaluateBatch(const float* Yaws, const float* AccelX, const float* AccelY, const uint8* Flags, uint8* OutResults, int32 Count);
+}
@@ -0,0 +1,155 @@
+// Copyright 2019 Dulan Wettasinghe. All Rights Reserved.
+
+#pragma once
+
+#include "Player/FPSCrouchKernel.h"
+
+/**
+ * Random stance inputs run through FPSCrouchKernel on a client and on a server ticking at different rates, without any engine types
+ * so FPS.Movement.Stance.TransitionTickRate and BM_TransitionTickRate in Benchmarks/FPSCrouchKernelBenchmark.cpp run the same scenarios.
+ * The client steps every frame, the server steps the client frames combined up to its own rate and never across an input change like CanCombineWith,
+ * and the server height after every server move is compared with the client height at the same time.
+ */
+namespace FPSTransitionScenario
+{
+	static const float ScenarioTime = 4.f;
+	static const int NumInputsPerScenario = 4;
+
+	/*Enough for a scenario at 256 Hz, higher client rates are cut short*/
+	static const int MaxFrames = 1024;
+
+	/*The same generator as FRandomStream, so the scenarios don't depend on what the standard library or the engine provides*/
+	struct FRandom
+	{
+		unsigned int Seed;
+
+		float FRand()
+		{
+			Seed = Seed * 196314165u + 907633515u;
+			return (float)(Seed >> 8) * (1.f / 16777216.f);
+		}
+
+		int RandRange(int Min, int Max)
+		{
+			const int Range = Max - Min + 1;
+			const int Offset = (int)(FRand() * (float)Range);
+			return Min + (Offset < Range ? Offset : Range - 1);
+		}
+	};
+
+	/*Frame stepped like the simulated proxies, or on a timeline like the predicted transitions*/
+	enum class EStepMode
+	{
+		Frame,
+		Timeline
+	};
+
+	struct FScenario
+	{
+		int NumFrames;
+		float FrameTargets[MaxFrames];
+
+		/*Frames the stance input changed on*/
+		bool InputFrames[MaxFrames];
+	};
+
+	struct FResult
+	{
+		float MaxError;
+
+		/*Server moves whose height differs from the client by a quantization step*/
+		int NumDrifts;
+
+		/*Server moves whose height differs from the client by more than the correction error*/
+		int NumCorrections;
+
+		int NumServerMoves;
+	};
+
+	/*Crouch and UnCrouch go at the crouch speed all the way, Prone and UnProne split it at the crouched height, see UpdateTransitionHeight*/
+	inline bool IsCrouchTransition(const FPSCrouchKernel::FStanceMetrics& Metrics, float HalfHeight, float TargetHalfHeight)
+	{
+		return TargetHalfHeight == Metrics.StandingHalfHeight || (TargetHalfHeight == Metrics.CrouchedHalfHeight && HalfHeight > Metrics.CrouchedHalfHeight);
+	}
+
+	/*One move ending at Clock with the metrics UFPSCharacterMovementComponent::UpdateTransitionHeight picks for the transition*/
+	inline void StepMove(EStepMode Mode, const FPSCrouchKernel::FStanceMetrics& Metrics, const FPSCrouchKernel::FStanceMetrics& CrouchMetrics,
+		FPSCrouchKernel::FStanceState& State, FPSCrouchKernel::FTransitionTimeline& Timeline, float TargetHalfHeight, float Clock, float DeltaTime)
+	{
+		const FPSCrouchKernel::FStanceMetrics& MoveMetrics = IsCrouchTransition(Metrics, State.HalfHeight, TargetHalfHeight) ? CrouchMetrics : Metrics;
+		if (Mode == EStepMode::Frame)
+		{
+			FPSCrouchKernel::Step(MoveMetrics, State, TargetHalfHeight, DeltaTime);
+		}
+		else
+		{
+			bool bStartedTimeline = false;
+			FPSCrouchKernel::StepTimeline(MoveMetrics, Timeline, State, TargetHalfHeight, Clock, DeltaTime, bStartedTimeline);
+		}
+	}
+
+	/*A new stance at random frames, often before the last transition has finished*/
+	inline void MakeScenario(const FPSCrouchKernel::FStanceMetrics& Metrics, int ClientRate, FRandom& Random, FScenario& OutScenario)
+	{
+		const float StanceHeights[] = { Metrics.StandingHalfHeight, Metrics.CrouchedHalfHeight, Metrics.PronedHalfHeight };
+		const int NumFrames = (int)(ScenarioTime * (float)ClientRate + 0.999f);
+		OutScenario.NumFrames = NumFrames < MaxFrames ? NumFrames : MaxFrames;
+
+		int Stance = 0;
+		for (int Frame = 0; Frame < OutScenario.NumFrames; ++Frame)
+		{
+			OutScenario.InputFrames[Frame] = Frame == 0 || Random.FRand() < (float)NumInputsPerScenario / (float)OutScenario.NumFrames;
+			if (OutScenario.InputFrames[Frame])
+			{
+				Stance = (Stance + Random.RandRange(1, 2)) % 3;
+			}
+			OutScenario.FrameTargets[Frame] = StanceHeights[Stance];
+		}
+	}
+
+	/*Run the scenario on the client and the server from standing and add the difference after every server move to the result*/
+	inline void RunScenario(EStepMode Mode, const FPSCrouchKernel::FStanceMetrics& Metrics, const FScenario& Scenario, int ClientRate, int ServerRate,
+		float DriftError, float CorrectionError, FResult& Result)
+	{
+		using namespace FPSCrouchKernel;
+
+		const FStanceMetrics CrouchMetrics = GetCrouchMetrics(Metrics, Metrics.MinHalfHeight);
+		const float ClientDeltaTime = 1.f / (float)ClientRate;
+		const int FramesPerServerMove = (ClientRate + ServerRate / 2) / ServerRate;
+
+		float ClientHeights[MaxFrames];
+		FStanceState Client = { Metrics.StandingHalfHeight, GetEyeHeight(Metrics, Metrics.StandingHalfHeight) };
+		FTransitionTimeline ClientTimeline = { 0.f, 0.f };
+		float ClientClock = 0.f;
+		for (int Frame = 0; Frame < Scenario.NumFrames; ++Frame)
+		{
+			ClientClock += ClientDeltaTime;
+			StepMove(Mode, Metrics, CrouchMetrics, Client, ClientTimeline, Scenario.FrameTargets[Frame], ClientClock, ClientDeltaTime);
+			ClientHeights[Frame] = Client.HalfHeight;
+		}
+
+		FStanceState Server = { Metrics.StandingHalfHeight, GetEyeHeight(Metrics, Metrics.StandingHalfHeight) };
+		FTransitionTimeline ServerTimeline = { 0.f, 0.f };
+		float ServerClock = 0.f;
+		for (int FirstFrame = 0; FirstFrame < Scenario.NumFrames;)
+		{
+			int EndFrame = FirstFrame + 1;
+			float DeltaTime = ClientDeltaTime;
+			while (EndFrame < Scenario.NumFrames && EndFrame - FirstFrame < FramesPerServerMove && !Scenario.InputFrames[EndFrame])
+			{
+				DeltaTime += ClientDeltaTime;
+				++EndFrame;
+			}
+
+			ServerClock += DeltaTime;
+			StepMove(Mode, Metrics, CrouchMetrics, Server, ServerTimeline, Scenario.FrameTargets[FirstFrame], ServerClock, DeltaTime);
+
+			const float Error = Server.HalfHeight > ClientHeights[EndFrame - 1] ? Server.HalfHeight - ClientHeights[EndFrame - 1] : ClientHeights[EndFrame - 1] - Server.HalfHeight;
+			Result.MaxError = Max(Result.MaxError, Error);
+			Result.NumDrifts += (Error > DriftError) ? 1 : 0;
+			Result.NumCorrections += (Error > CorrectionError) ? 1 : 0;
+			++Result.NumServerMoves;
+			FirstFrame = EndFrame;
+		}
+	}
+}